@@ -0,0 +1 @@
+../../../src/ptr_bitmap.cpp
\ No newline at end of file
@@ -355,6 +355,17 @@ set (PDEBUG_CLIENT4 Client, PCSTR args)
 		print_set_values ();
 		return S_OK;
 	}
+	// replay or keep a set of patches
+	if (strncmp(args, "/save ", 6) == 0)
+	{
+		save_set_values (args + 6);
+		return S_OK;
+	}
+	else if (strncmp(args, "/load ", 6) == 0)
+	{
+		load_set_values (args + 6);
+		return S_OK;
+	}
 
 	// Get input
 	int argc = 0;
@@ -502,6 +513,20 @@ max_indirection_level(PDEBUG_CLIENT4 Client, PCSTR args)
     return S_OK;
 }
 
+HRESULT CALLBACK
+bitmap_budget(PDEBUG_CLIENT4 Client, PCSTR args)
+{
+	size_t mb;
+    if (!args || strlen(args)==0)
+    	mb = 0;
+    else
+    	mb = (size_t) GetExpression(args);
+
+    set_bit_vec_budget(mb);
+
+    return S_OK;
+}
+
 HRESULT CALLBACK
 info_local(PDEBUG_CLIENT4 Client, PCSTR args)
 {
@@ -11,6 +11,9 @@
 #include <stdio.h>
 #include <vector>
 #include <map>
+#include <set>
+#include <string>
+#include <algorithm>
 
 #include "ref.h"
 #include "segment.h"
@@ -61,6 +64,10 @@ static ULONG g_total_threads = 0;
 static std::vector<stack_symbols*> g_all_stack_symbols;
 static std::vector<frames_t*> g_all_stack_frames;
 
+static std::vector<struct vtable_range> g_vtable_index;
+static std::set<std::string> g_vtable_names;
+static bool g_vtable_index_ready = false;
+
 static struct addr_type_pair* addr_type_map = NULL;
 static unsigned int addr_type_map_sz = 0;
 static unsigned int addr_type_map_buf_sz = 0;
@@ -275,6 +282,73 @@ bool known_stack_sym(const struct object_reference* ref, address_t* sym_addr, si
 		return false;
 }
 
+// Stack symbols are cached by their frames and globals are resolved on demand
+void symbolize_refs(const std::vector<struct object_reference*>& refs)
+{
+}
+
+static bool vtable_range_less(const struct vtable_range& a, const struct vtable_range& b)
+{
+	return a.low < b.low;
+}
+
+/*
+ * Symbols "<module>!<class>::`vftable'" of all modules, a class with
+ * multiple bases has one for each, e.g. "<class>::`vftable'{for `<base>'}"
+ */
+const std::vector<struct vtable_range>& get_vtable_index(void)
+{
+	const char* vtbl_postfix = "::`vftable'";
+	ULONG64 handle;
+
+	if (g_vtable_index_ready)
+		return g_vtable_index;
+
+	g_vtable_index.clear();
+	g_vtable_names.clear();
+	if (gDebugSymbols3->StartSymbolMatch("*!*::`vftable'*", &handle) == S_OK)
+	{
+		while (1)
+		{
+			char sym_name[NAME_BUF_SZ];
+			ULONG64 vtbl_addr;
+			DEBUG_MODULE_AND_ID id;
+			ULONG64 displacement;
+			ULONG num_entry;
+			DEBUG_SYMBOL_ENTRY sym_entry;
+			struct vtable_range vtable;
+			char* name;
+			char* cursor;
+
+			HRESULT hr = gDebugSymbols3->GetNextSymbolMatch(handle, sym_name, NAME_BUF_SZ, NULL, &vtbl_addr);
+			if (hr != S_OK && hr != S_FALSE)
+				break;
+			sym_name[NAME_BUF_SZ - 1] = '\0';
+			// class name is w/o module prefix and vftable suffix
+			name = strchr(sym_name, '!');
+			name = name ? name + 1 : sym_name;
+			cursor = strstr(name, vtbl_postfix);
+			if (!cursor || vtbl_addr == 0)
+				continue;
+			*cursor = '\0';
+			vtable.low = vtbl_addr;
+			vtable.high = vtable.low + (g_ptr_bit >> 3);
+			if (gDebugSymbols3->GetSymbolEntriesByOffset(vtbl_addr, 0, &id, &displacement, 1, &num_entry) == S_OK
+				&& displacement == 0
+				&& gDebugSymbols3->GetSymbolEntryInformation(&id, &sym_entry) == S_OK
+				&& sym_entry.Size > 0)
+				vtable.high = vtable.low + sym_entry.Size;
+			// a class has the same name in all modules
+			vtable.name = g_vtable_names.insert(std::string(name)).first->c_str();
+			g_vtable_index.push_back(vtable);
+		}
+		gDebugSymbols3->EndSymbolMatch(handle);
+	}
+	std::sort(g_vtable_index.begin(), g_vtable_index.end(), vtable_range_less);
+	g_vtable_index_ready = true;
+	return g_vtable_index;
+}
+
 /*
  *  search C++ vtables of the type of the input expression
  */
@@ -312,7 +386,7 @@ bool get_vtable_from_exp(const char*exp, struct CA_LIST*vtables, char* type_name
 				hr = gDebugSymbols3->GetNextSymbolMatch (handle, sym_name, NAME_BUF_SZ, 0, &vtbl_addr);
 				if (hr == S_OK || hr == S_FALSE)
 				{
-					struct object_range* vtbl = new struct object_range;
+					struct object_range* vtbl = (struct object_range*) malloc(sizeof(struct object_range));
 					vtbl->low = vtbl_addr;
 					vtbl->high = vtbl->low + 1;
 					ca_list_push_front(vtables, vtbl);
@@ -358,6 +432,9 @@ bool update_memory_segments_and_heaps()
 		// drop cache
 		release_cached_stack_symbols();
 		release_frame_info_cache();
+		g_vtable_index.clear();
+		g_vtable_names.clear();
+		g_vtable_index_ready = false;
 		g_total_threads = 0;
 	}
 
@@ -548,6 +625,9 @@ bool update_memory_segments_and_heaps()
 	// thread is restored at top level
 	dprintf("\tThere are %ld threads\n", num_threads);
 
+	// constant time lookup of address
+	build_segment_index();
+
 	// dry run to mark heap segments
 	if (!CA_HEAP->init_heap() || !test_segments(true) || !alloc_bit_vec())
 		goto Fail;
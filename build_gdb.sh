@@ -54,7 +54,15 @@ PWD=$(pwd)
 # if you prefer the gdb with debug symbol use commented line to build
 # $PWD/../configure -disable-binutils --with-python --disable-ld --disable-gold --disable-gas --disable-sim --disable-gprof CXXFLAGS='-g' CFLAGS='-g' --prefix=/usr
 
+# read zstd compressed core files if libzstd is installed
+zstd_flags=()
+if pkg-config --exists libzstd 2>/dev/null
+then
+    echo "building with libzstd"
+    zstd_flags=(CA_ZSTD_CFLAGS="-DHAVE_LIBZSTD $(pkg-config --cflags libzstd)" CA_ZSTD_LIBS="$(pkg-config --libs libzstd)")
+fi
+
 $PWD/../configure --with-python --prefix=/usr
-bear -- make -j8
-sudo make install # do not remove the build folder && rm -rf $build_folder
+bear -- make -j8 "${zstd_flags[@]}"
+sudo make install "${zstd_flags[@]}" # do not remove the build folder && rm -rf $build_folder
 echo "if you want to remove the build folder, please run \"rm -rf $build_folder\""
@@ -14,10 +14,18 @@
 #endif
 
 #include <sys/param.h>
+#include <sys/uio.h>
+#include <map>
+#include <set>
+#include <vector>
+#include <algorithm>
 #include <sstream>
 #include "dis-asm.h"
 #include "readline/readline.h"
 #include "build-id.h"
+#include "observable.h"
+#include "thread_pool.h"
+#include "compressed_core.h"
 
 #ifndef PN_XNUM
 #define PN_XNUM 0xffff
@@ -39,15 +47,335 @@ static bool g_quit = false;
 /*
  * Exposed helper
  */
+static bool live_cache_read(address_t addr, void* buffer, size_t sz);
+static void frame_table_invalidate(void);
+static void section_syms_invalidate(void);
+static const struct vtable_range* lookup_vtable(address_t vptr);
+
 bool
 inferior_memory_read (address_t addr, void* buffer, size_t sz)
 {
+	if (!g_debug_core && live_cache_read(addr, buffer, sz))
+		return true;
 	if (target_read_memory(addr, (gdb_byte *)buffer, sz) == 0)
 		return true;
 	else
 		return false;
 }
 
+/*
+ * Live process memory cache
+ *	A ptrace read costs a round trip to the kernel for every word.
+ *	Instead, target's memory is fetched in bulk with process_vm_readv
+ *	and served from the cache until the target resumes or the debugger
+ *	changes its memory. A command that keeps missing the cache, e.g. a
+ *	scan of the whole heap, has writable segments read in bulk.
+ */
+#define LIVE_BLOCK_SIZE     (64*1024ul)
+#define LIVE_READ_AHEAD     16	/* blocks fetched on a cache miss */
+#define LIVE_BATCH_SIZE     (64*1024*1024ul)
+#define LIVE_BATCH_IOVS     64
+#define LIVE_PREFETCH_MAX   (1024*1024*1024ul)
+#define LIVE_PREFETCH_MISSES 16	/* cache misses before bulk read */
+
+struct live_cache_range
+{
+	address_t vaddr;
+	size_t    size;
+	char*     data;
+};
+
+static std::map<address_t, struct live_cache_range> g_live_cache;
+static std::set<address_t> g_live_bad_blocks;
+static const struct live_cache_range* g_live_last_range = NULL;
+static int  g_live_cache_pid = 0;
+static bool g_live_prefetched = false;
+static unsigned int g_live_misses = 0;
+static bool g_live_cache_disabled = false;
+static bool g_live_observers_attached = false;
+
+static void
+live_cache_invalidate(void)
+{
+	for (auto& itr : g_live_cache)
+		free(itr.second.data);
+	g_live_cache.clear();
+	g_live_bad_blocks.clear();
+	g_live_last_range = NULL;
+	g_live_prefetched = false;
+	g_live_misses = 0;
+}
+
+static void prefetch_live_memory(void);
+
+static void
+live_cache_target_resumed(ptid_t ptid)
+{
+	live_cache_invalidate();
+}
+
+static void
+live_cache_memory_changed(struct inferior *inf, CORE_ADDR addr, ssize_t len, const bfd_byte *data)
+{
+	live_cache_invalidate();
+}
+
+static void
+live_cache_inferior_exit(struct inferior *inf)
+{
+	live_cache_invalidate();
+}
+
+static bool
+live_cache_usable(void)
+{
+	if (g_live_cache_disabled || !g_segment_count || !target_has_execution())
+		return false;
+	if (!g_live_observers_attached)
+	{
+		gdb::observers::target_resumed.attach(live_cache_target_resumed, "core_analyzer");
+		gdb::observers::memory_changed.attach(live_cache_memory_changed, "core_analyzer");
+		gdb::observers::inferior_exit.attach(live_cache_inferior_exit, "core_analyzer");
+		g_live_observers_attached = true;
+	}
+	if (g_live_cache_pid != inferior_ptid.pid())
+	{
+		live_cache_invalidate();
+		g_live_cache_pid = inferior_ptid.pid();
+	}
+	return true;
+}
+
+static void
+live_cache_insert(address_t vaddr, size_t size, char* data)
+{
+	struct live_cache_range range;
+	range.vaddr = vaddr;
+	range.size = size;
+	range.data = data;
+	g_live_cache[vaddr] = range;
+}
+
+/* Return the cached range containing [addr, addr+sz) */
+static const struct live_cache_range*
+live_cache_find(address_t addr, size_t sz)
+{
+	auto itr = g_live_cache.upper_bound(addr);
+	if (itr == g_live_cache.begin())
+		return NULL;
+	--itr;
+	if (addr + sz <= itr->second.vaddr + itr->second.size)
+		return &itr->second;
+	return NULL;
+}
+
+static bool
+live_cache_overlap(address_t addr, size_t sz)
+{
+	auto itr = g_live_cache.lower_bound(addr);
+	if (itr != g_live_cache.end() && itr->second.vaddr < addr + sz)
+		return true;
+	if (itr != g_live_cache.begin())
+	{
+		--itr;
+		if (itr->second.vaddr + itr->second.size > addr)
+			return true;
+	}
+	return false;
+}
+
+/* Fetch blocks around addr on a cache miss */
+static const struct live_cache_range*
+live_cache_fetch(address_t addr, size_t sz)
+{
+	struct ca_segment* segment = get_segment(addr, 1);
+	address_t start = addr & ~(LIVE_BLOCK_SIZE - 1);
+	address_t end = start + LIVE_BLOCK_SIZE * LIVE_READ_AHEAD;
+	struct iovec local, remote;
+	ssize_t nread;
+	char* data;
+
+	if (!segment || !segment->m_read || g_live_bad_blocks.count(start))
+		return NULL;
+	/* stay in the segment and don't overlap cached ranges */
+	if (start < segment->m_vaddr)
+		start = segment->m_vaddr;
+	if (end > segment->m_vaddr + segment->m_vsize)
+		end = segment->m_vaddr + segment->m_vsize;
+	auto itr = g_live_cache.upper_bound(addr);
+	if (itr != g_live_cache.end() && itr->second.vaddr < end)
+		end = itr->second.vaddr;
+	if (itr != g_live_cache.begin())
+	{
+		--itr;
+		if (itr->second.vaddr + itr->second.size > start)
+			start = itr->second.vaddr + itr->second.size;
+	}
+	if (addr < start || addr + sz > end)
+		return NULL;
+
+	data = (char*) malloc(end - start);
+	if (!data)
+		return NULL;
+	local.iov_base = data;
+	local.iov_len = end - start;
+	remote.iov_base = (void*) start;
+	remote.iov_len = end - start;
+	nread = process_vm_readv(g_live_cache_pid, &local, 1, &remote, 1, 0);
+	if (nread < 0 && (errno == ENOSYS || errno == EPERM))
+	{
+		/* kernel or security policy doesn't allow it, stick to ptrace */
+		g_live_cache_disabled = true;
+		free(data);
+		return NULL;
+	}
+	else if (nread <= 0 || start + nread < addr + sz)
+	{
+		g_live_bad_blocks.insert(addr & ~(LIVE_BLOCK_SIZE - 1));
+		free(data);
+		return NULL;
+	}
+	live_cache_insert(start, nread, data);
+	return live_cache_find(addr, sz);
+}
+
+static bool
+live_cache_read(address_t addr, void* buffer, size_t sz)
+{
+	const struct live_cache_range* range = g_live_last_range;
+
+	if (!range || addr < range->vaddr || addr + sz > range->vaddr + range->size)
+	{
+		if (!live_cache_usable())
+			return false;
+		range = live_cache_find(addr, sz);
+		if (!range && !g_live_prefetched && ++g_live_misses >= LIVE_PREFETCH_MISSES)
+		{
+			prefetch_live_memory();
+			range = live_cache_find(addr, sz);
+		}
+		if (!range)
+			range = live_cache_fetch(addr, sz);
+		if (!range)
+			return false;
+		g_live_last_range = range;
+	}
+	memcpy(buffer, range->data + (addr - range->vaddr), sz);
+	return true;
+}
+
+/*
+ * Bulk read writable segments, i.e. heap, stacks and module data, in
+ * parallel. Small segments are batched into one system call.
+ * Workers only call process_vm_readv on buffers of their own batch.
+ */
+struct live_prefetch_batch
+{
+	std::vector<struct iovec> remote;
+	std::vector<char*> data;
+	std::vector<size_t> nread;
+};
+
+static void
+live_prefetch_batch_read(int pid, struct live_prefetch_batch& batch)
+{
+	size_t i, next = 0;
+	std::vector<struct iovec> local(batch.remote.size());
+
+	for (i = 0; i < batch.remote.size(); i++)
+	{
+		batch.data[i] = (char*) malloc(batch.remote[i].iov_len);
+		batch.nread[i] = 0;
+		if (!batch.data[i])
+			batch.remote[i].iov_len = 0;
+		local[i].iov_base = batch.data[i];
+		local[i].iov_len = batch.remote[i].iov_len;
+	}
+	/* a failed read returns the bytes before the bad iovec, skip it and go on */
+	while (next < batch.remote.size())
+	{
+		ssize_t nread = process_vm_readv(pid, &local[next], batch.remote.size() - next,
+							&batch.remote[next], batch.remote.size() - next, 0);
+		if (nread < 0)
+			nread = 0;
+		while (next < batch.remote.size() && (size_t)nread >= local[next].iov_len)
+		{
+			batch.nread[next] = local[next].iov_len;
+			nread -= local[next].iov_len;
+			next++;
+		}
+		if (next < batch.remote.size())
+		{
+			batch.nread[next] = nread;
+			next++;
+		}
+	}
+}
+
+static void
+prefetch_live_memory(void)
+{
+	std::vector<struct live_prefetch_batch> batches;
+	size_t budget = LIVE_PREFETCH_MAX;
+	size_t batch_sz = 0;
+	unsigned int i;
+	int pid;
+
+	if (g_debug_core || !live_cache_usable() || g_live_prefetched)
+		return;
+	g_live_prefetched = true;
+	pid = g_live_cache_pid;
+
+	for (i = 0; i < g_segment_count; i++)
+	{
+		struct ca_segment* segment = &g_segments[i];
+		address_t vaddr = segment->m_vaddr;
+		size_t left = segment->m_vsize;
+
+		if (!segment->m_read || !segment->m_write || left == 0 || left > budget
+			|| live_cache_overlap(vaddr, left))
+			continue;
+		budget -= left;
+		/* big segments are split so that workers share them */
+		while (left > 0)
+		{
+			struct iovec iov;
+			iov.iov_base = (void*) vaddr;
+			iov.iov_len = left > LIVE_BATCH_SIZE ? LIVE_BATCH_SIZE : left;
+			if (batches.empty() || batch_sz + iov.iov_len > LIVE_BATCH_SIZE
+				|| batches.back().remote.size() >= LIVE_BATCH_IOVS)
+			{
+				batches.push_back(live_prefetch_batch());
+				batch_sz = 0;
+			}
+			batches.back().remote.push_back(iov);
+			batch_sz += iov.iov_len;
+			vaddr += iov.iov_len;
+			left -= iov.iov_len;
+		}
+	}
+	for (auto& batch : batches)
+	{
+		batch.data.resize(batch.remote.size());
+		batch.nread.resize(batch.remote.size());
+	}
+
+	CA_THREAD_POOL.parallel_for(batches.size(), [&batches, pid](size_t index) {
+		live_prefetch_batch_read(pid, batches[index]);
+	});
+
+	for (auto& batch : batches)
+	{
+		for (i = 0; i < batch.remote.size(); i++)
+		{
+			if (batch.data[i] && batch.nread[i] > 0)
+				live_cache_insert((address_t)batch.remote[i].iov_base, batch.nread[i], batch.data[i]);
+			else
+				free(batch.data[i]);
+		}
+	}
+}
+
 void ca_switch_to_thread(struct thread_info *info)
 {
     switch_to_thread (info);
@@ -126,6 +454,111 @@ thread_callback (struct thread_info *info, void *data)
 	return 0;
 }
 
+#ifdef HAVE_LIBZSTD
+/*
+ * A skeleton core, i.e. the headers and notes of a core, may come with
+ * the whole core compressed by zstd as <core>.zst. The zcore command
+ * writes the skeleton from the leading frames of <core>.zst.
+ * The target sits above the core target and serves gdb's memory reads
+ * of the core from the compressed copy.
+ */
+static const target_info zcore_target_info = {
+	"zcore",
+	N_("Compressed core memory"),
+	N_("Memory of a core file read from its zstd compressed copy")
+};
+
+class zcore_target final : public target_ops
+{
+public:
+	const target_info &info () const override
+	{ return zcore_target_info; }
+
+	strata stratum () const override { return arch_stratum; }
+
+	enum target_xfer_status xfer_partial (enum target_object object,
+					      const char *annex,
+					      gdb_byte *readbuf,
+					      const gdb_byte *writebuf,
+					      ULONGEST offset, ULONGEST len,
+					      ULONGEST *xfered_len) override;
+};
+
+static zcore_target the_zcore_target;
+static bfd* g_zcore_bfd = NULL;
+
+enum target_xfer_status
+zcore_target::xfer_partial (enum target_object object, const char *annex,
+			    gdb_byte *readbuf, const gdb_byte *writebuf,
+			    ULONGEST offset, ULONGEST len, ULONGEST *xfered_len)
+{
+	if (object == TARGET_OBJECT_MEMORY && readbuf && g_core_compressed
+		&& core_bfd && core_bfd == g_zcore_bfd)
+	{
+		struct ca_segment* segment = get_segment(offset, 1);
+		if (segment && segment->m_faddr && offset < segment->m_vaddr + segment->m_fsize)
+		{
+			char* mapped_addr = segment->m_faddr + (offset - segment->m_vaddr);
+			if (len > segment->m_vaddr + segment->m_fsize - offset)
+				len = segment->m_vaddr + segment->m_fsize - offset;
+			if (pin_core_range(mapped_addr, len))
+			{
+				memcpy(readbuf, mapped_addr, len);
+				unpin_core_range(mapped_addr, len);
+				*xfered_len = len;
+				return TARGET_XFER_OK;
+			}
+		}
+	}
+	return this->beneath ()->xfer_partial (object, annex, readbuf, writebuf,
+					       offset, len, xfered_len);
+}
+#endif
+
+/*
+ * A PT_LOAD of the core file
+ */
+struct core_load
+{
+	address_t vaddr;
+	size_t    memsz;
+	size_t    offset;
+	size_t    filesz;
+};
+
+static bool
+core_load_less(const struct core_load& a, const struct core_load& b)
+{
+	return a.vaddr < b.vaddr;
+}
+
+/*
+ * Point segments to their data in the core image.
+ * Both loads and segments are sorted by address and merged in one pass;
+ * a load matches the segment of the same address and size.
+ */
+static void
+join_core_loads(std::vector<struct core_load>& loads, char* image)
+{
+	unsigned int n = 0;
+	size_t i;
+
+	/* loads of the same address keep their order, the last one wins */
+	std::stable_sort(loads.begin(), loads.end(), core_load_less);
+	for (i = 0; i < loads.size() && n < g_segment_count; i++)
+	{
+		const struct core_load& load = loads[i];
+		while (n < g_segment_count && g_segments[n].m_vaddr < load.vaddr)
+			n++;
+		if (n < g_segment_count && g_segments[n].m_vaddr == load.vaddr
+			&& g_segments[n].m_vsize == load.memsz)
+		{
+			g_segments[n].m_fsize = load.filesz;
+			g_segments[n].m_faddr = image + load.offset;
+		}
+	}
+}
+
 static int
 mmap_core_file(const char* fname)
 {
@@ -133,8 +566,11 @@ mmap_core_file(const char* fname)
 	size_t mFileSize;
 	int mFileDescriptor;
 	char* mpStartAddr;
+	char* image;
+	size_t image_size;
 	int total_phnum;
-	int i, n;
+	int i;
+	std::vector<struct core_load> loads;
 
 	if (!fname)
 		return false;
@@ -151,6 +587,27 @@ mmap_core_file(const char* fname)
 	mpStartAddr = (char*) mmap(0, mFileSize, PROT_READ, MAP_PRIVATE, mFileDescriptor, 0);
 	if(mpStartAddr == MAP_FAILED)
 		return false;
+	image = mpStartAddr;
+	image_size = mFileSize;
+#ifdef HAVE_LIBZSTD
+	/* read memory from the compressed copy <core>.zst if there is one */
+	if (g_zcore_bfd)
+	{
+		current_inferior ()->unpush_target (&the_zcore_target);
+		g_zcore_bfd = NULL;
+	}
+	std::string zname = std::string(fname) + ".zst";
+	if (access(zname.c_str(), R_OK) == 0 && open_compressed_core(zname.c_str()))
+	{
+		image = compressed_core_image(&image_size);
+		current_inferior ()->push_target (&the_zcore_target);
+		g_zcore_bfd = core_bfd;
+		CA_PRINT("Core memory is read from %s\n", zname.c_str());
+	}
+#endif
+
+	/* holes of the core file are skipped by scanners */
+	set_core_file(mFileDescriptor, mpStartAddr, mFileSize);
 
 	/* walk through the mmap-ed core file and fix the corresponding ca_segments */
 	if (g_ptr_bit == 64)
@@ -167,18 +624,10 @@ mmap_core_file(const char* fname)
 		{
 			Elf64_Phdr* phdr = (Elf64_Phdr*) (mpStartAddr + elfhdr->e_phoff + i * elfhdr->e_phentsize);
 			if (phdr->p_type == PT_LOAD && phdr->p_filesz > 0
-				&& phdr->p_offset + phdr->p_filesz <= mFileSize) /* aware of truncated core */
+				&& phdr->p_offset + phdr->p_filesz <= image_size) /* aware of truncated core */
 			{
-				for (n=0; n<g_segment_count; n++)
-				{
-					struct ca_segment* segment = &g_segments[n];
-					if (phdr->p_vaddr == segment->m_vaddr && phdr->p_memsz == segment->m_vsize)
-					{
-						segment->m_fsize = phdr->p_filesz;
-						segment->m_faddr = mpStartAddr + phdr->p_offset;
-						break;
-					}
-				}
+				struct core_load load = {phdr->p_vaddr, phdr->p_memsz, phdr->p_offset, phdr->p_filesz};
+				loads.push_back(load);
 			}
 		}
 	}
@@ -196,21 +645,14 @@ mmap_core_file(const char* fname)
 		{
 			Elf32_Phdr* phdr = (Elf32_Phdr*) (mpStartAddr + elfhdr->e_phoff + i * elfhdr->e_phentsize);
 			if (phdr->p_type == PT_LOAD && phdr->p_filesz > 0
-				&& phdr->p_offset + phdr->p_filesz <= mFileSize) /* aware of truncated core */
+				&& phdr->p_offset + phdr->p_filesz <= image_size) /* aware of truncated core */
 			{
-				for (n=0; n<g_segment_count; n++)
-				{
-					struct ca_segment* segment = &g_segments[n];
-					if (phdr->p_vaddr == segment->m_vaddr && phdr->p_memsz == segment->m_vsize)
-					{
-						segment->m_fsize = phdr->p_filesz;
-						segment->m_faddr = mpStartAddr + phdr->p_offset;
-						break;
-					}
-				}
+				struct core_load load = {phdr->p_vaddr, phdr->p_memsz, phdr->p_offset, phdr->p_filesz};
+				loads.push_back(load);
 			}
 		}
 	}
+	join_core_loads(loads, image);
 
 	return true;
 }
@@ -290,34 +732,90 @@ linux_nat_find_memory_regions(bool create)
 	return true;
 }
 
-static void
-set_segment_module_type(enum storage_type type,
-		address_t low, address_t high, const char* modname)
+/*
+ * A data or text section of a module
+ */
+struct module_section
+{
+	address_t low;
+	address_t high;
+	enum storage_type type;
+	const char* modname;
+};
+
+static bool
+module_section_less(const struct module_section* a, const struct module_section* b)
 {
-	while (low < high)
+	return a->low < b->low;
+}
+
+/*
+ * Set the type of segments overlapped by module sections.
+ * Sections sorted by address are joined with sorted segments; a segment
+ * covered by more than one section takes the last one in the given order.
+ */
+static void
+set_segment_module_type(const std::vector<struct module_section>& sections)
+{
+	std::vector<const struct module_section*> sorted;
+	std::vector<const struct module_section*> owners(g_segment_count, NULL);
+	unsigned int first = 0, n;
+	size_t i;
+
+	sorted.reserve(sections.size());
+	for (i = 0; i < sections.size(); i++)
+		sorted.push_back(&sections[i]);
+	std::sort(sorted.begin(), sorted.end(), module_section_less);
+
+	for (i = 0; i < sorted.size(); i++)
+	{
+		const struct module_section* sect = sorted[i];
+		/* the first segment that ends after the section's start */
+		while (first < g_segment_count
+			&& g_segments[first].m_vaddr + g_segments[first].m_vsize <= sect->low)
+			first++;
+		for (n = first; n < g_segment_count && g_segments[n].m_vaddr < sect->high; n++)
+		{
+			if (!owners[n] || owners[n] < sect)
+				owners[n] = sect;
+		}
+	}
+
+	for (n = 0; n < g_segment_count; n++)
 	{
-		struct ca_segment* segment = get_segment(low, 1);
-		if (segment)
+		if (owners[n])
 		{
-			segment->m_type = type;
-			segment->m_module_name = strdup(modname);
-			low = segment->m_vaddr + segment->m_vsize;
+			struct ca_segment* segment = &g_segments[n];
+			segment->m_type = owners[n]->type;
+			if (segment->m_module_name)
+				free((void*)segment->m_module_name);
+			segment->m_module_name = strdup(owners[n]->modname);
 		}
-		else
-			low += 4096;	 /* system page size */
 	}
 }
 
+static bool
+phdr_less(const Elf_Internal_Phdr* a, const Elf_Internal_Phdr* b)
+{
+	if (a->p_vaddr != b->p_vaddr)
+		return a->p_vaddr < b->p_vaddr;
+	return a->p_memsz > b->p_memsz;
+}
+
 static int
 build_segments(void)
 {
 	unsigned int i;
+	std::vector<struct module_section> sections;
 
 	/*
 	 *  It has been built previously.
 	 */
 	if (g_segments && g_segment_count)
 		release_all_segments();
+	/* thread contexts and modules are about to be rebuilt */
+	frame_table_invalidate();
+	section_syms_invalidate();
 
 	g_ptr_bit = gdbarch_ptr_bit(target_gdbarch());
 	if (g_ptr_bit != 64 && g_ptr_bit != 32)
@@ -334,16 +832,25 @@ build_segments(void)
 	else if (core_bfd && core_bfd->xvec->flavour == bfd_target_elf_flavour)
 	{
 		Elf_Internal_Phdr *phdr = elf_tdata(core_bfd)->phdr;
+		std::vector<Elf_Internal_Phdr*> phdrs;
 		g_debug_core = true;
 		for (i = 0; i < elf_elfheader(core_bfd)->e_phnum; i++, phdr++)
 		{
 			if (phdr->p_vaddr && phdr->p_memsz > 0)
-			{
-				add_one_segment(phdr->p_vaddr, phdr->p_memsz,
-							(phdr->p_flags & PF_R) != 0 ? 1 : 0,
-							(phdr->p_flags & PF_W) != 0 ? 1 : 0,
-							(phdr->p_flags & PF_X) != 0 ? 1 : 0);
-			}
+				phdrs.push_back(phdr);
+		}
+		/*
+		 * Segments are appended in address order, an enclosed one
+		 * after its container, so that none is inserted in the middle
+		 */
+		std::stable_sort(phdrs.begin(), phdrs.end(), phdr_less);
+		for (i = 0; i < phdrs.size(); i++)
+		{
+			phdr = phdrs[i];
+			add_one_segment(phdr->p_vaddr, phdr->p_memsz,
+						(phdr->p_flags & PF_R) != 0 ? 1 : 0,
+						(phdr->p_flags & PF_W) != 0 ? 1 : 0,
+						(phdr->p_flags & PF_X) != 0 ? 1 : 0);
 		}
 		if (mmap_core_file(bfd_get_filename(core_bfd)) == false)
 		{
@@ -382,7 +889,10 @@ build_segments(void)
 						|| strcmp (sectptr->the_bfd_section->name, ".rodata") == 0)
 					type = ENUM_MODULE_TEXT;
 				if (type != ENUM_UNKNOWN)
-					set_segment_module_type(type, sectptr->addr, sectptr->endaddr, so->so_name);
+				{
+					struct module_section sect = {sectptr->addr, sectptr->endaddr, type, so->so_name};
+					sections.push_back(sect);
+				}
 			}
 		}
 	}
@@ -402,9 +912,12 @@ build_segments(void)
 			/* .rodata and .text sections are in the same segment */
 			type = ENUM_MODULE_TEXT;
 		}
-		if (type != ENUM_UNKNOWN)
-			set_segment_module_type(type, p->addr, p->endaddr, bfd_get_filename (pbfd));
+		if (type != ENUM_UNKNOWN) {
+			struct module_section sect = {p->addr, p->endaddr, type, bfd_get_filename (pbfd)};
+			sections.push_back(sect);
+		}
 	}
+	set_segment_module_type(sections);
 
 	/* thread stacks */
 	{
@@ -421,6 +934,9 @@ build_segments(void)
 		registers_changed ();
 	}
 
+	/* index segments by page for constant time lookup */
+	build_segment_index();
+
 	/* alloc buffer for future reference search */
 	alloc_bit_vec();
 
@@ -474,34 +990,221 @@ update_memory_segments_and_heaps(void)
     return init_heap_managers();
 }
 
-int
-get_frame_number(const struct ca_segment* segment, address_t addr, int* offset)
+/*
+ * Frames of a thread, innermost first
+ *	Unwinding a thread is much more expensive than searching its frames,
+ *	and a search may find many references on one stack. Each thread is
+ *	unwound once and kept until the target resumes, its memory is changed
+ *	or segments are rebuilt. Local variables of a frame are collected the
+ *	first time they are asked for.
+ */
+struct frame_var
+{
+	address_t addr;
+	size_t size;
+	unsigned int order;	/* visiting order, innermost block first */
+	struct symbol* sym;
+};
+
+struct frame_table
+{
+	std::vector<address_t> sp;
+	std::vector<address_t> max_sp;	/* running maximum of sp, for binary search */
+	std::vector<address_t> pc;
+	/* local variables of each frame sorted by address, valid if vars_ready */
+	std::vector<std::vector<struct frame_var> > vars;
+	std::vector<size_t> max_var_size;
+	std::vector<bool> vars_ready;
+};
+
+static std::map<struct thread_info*, struct frame_table> g_frame_tables;
+static bool g_cache_observers_attached = false;
+
+static void
+frame_table_invalidate(void)
+{
+	g_frame_tables.clear();
+}
+
+static void
+frame_table_target_resumed(ptid_t ptid)
+{
+	frame_table_invalidate();
+}
+
+static void
+frame_table_memory_changed(struct inferior *inf, CORE_ADDR addr, ssize_t len, const bfd_byte *data)
+{
+	frame_table_invalidate();
+}
+
+static void
+frame_table_inferior_exit(struct inferior *inf)
+{
+	frame_table_invalidate();
+}
+
+/* Cached symbols are gone with their object files */
+static void
+symbol_cache_objfile_changed(struct objfile *objfile)
+{
+	frame_table_invalidate();
+	section_syms_invalidate();
+}
+
+static void
+attach_cache_observers(void)
+{
+	if (g_cache_observers_attached)
+		return;
+	gdb::observers::target_resumed.attach(frame_table_target_resumed, "core_analyzer");
+	gdb::observers::memory_changed.attach(frame_table_memory_changed, "core_analyzer");
+	gdb::observers::inferior_exit.attach(frame_table_inferior_exit, "core_analyzer");
+	gdb::observers::new_objfile.attach(symbol_cache_objfile_changed, "core_analyzer");
+	gdb::observers::free_objfile.attach(symbol_cache_objfile_changed, "core_analyzer");
+	g_cache_observers_attached = true;
+}
+
+static struct frame_table*
+get_frame_table(struct thread_info* tp)
 {
-	int frame;
-	address_t sp;
 	struct frame_info* fp;
-	struct thread_info* tp = (struct thread_info*) segment->m_thread.context;
+	address_t sp;
+	CORE_ADDR pc;
 
-	if (!tp)
-		return -1;
+	attach_cache_observers();
+
+	auto itr = g_frame_tables.find(tp);
+	if (itr != g_frame_tables.end())
+		return &itr->second;
 
+	struct frame_table& table = g_frame_tables[tp];
 	switch_to_thread (tp);
-	/*
-	 * find the frame that addr belongs to
-	 * start from the innermost frame
-	 */
-	frame = -1;
-	*offset = -1;
 	fp = get_current_frame ();
 	while (fp)
 	{
 		sp = get_frame_sp(fp);
-		if (addr < sp)
-			break;
-		frame++;
-		*offset = (int)((long)addr - (long)sp);
+		if (!get_frame_pc_if_available (fp, &pc))
+			pc = 0;
+		table.sp.push_back(sp);
+		table.max_sp.push_back(table.max_sp.empty() ? sp : std::max(table.max_sp.back(), sp));
+		table.pc.push_back(pc);
 		fp = get_prev_frame(fp);
 	}
+	table.vars.resize(table.sp.size());
+	table.max_var_size.resize(table.sp.size(), 0);
+	table.vars_ready.resize(table.sp.size(), false);
+	return &table;
+}
+
+static bool
+frame_var_less(const struct frame_var& a, const struct frame_var& b)
+{
+	if (a.addr != b.addr)
+		return a.addr < b.addr;
+	return a.order < b.order;
+}
+
+/* Collect local variables in scope of the frame, from the innermost block up to the function */
+static void
+build_frame_vars(struct thread_info* tp, struct frame_table* table, int frame_no)
+{
+	struct frame_info* frame;
+	const struct block *block;
+	CORE_ADDR pc;
+	unsigned int order = 0;
+	std::vector<struct frame_var>& vars = table->vars[frame_no];
+	int i;
+
+	table->vars_ready[frame_no] = true;
+	switch_to_thread (tp);
+	frame = get_current_frame ();
+	for (i = 0; i < frame_no && frame; i++)
+		frame = get_prev_frame(frame);
+	if (!frame || !get_frame_pc_if_available (frame, &pc))
+		return;
+
+	for (block = get_frame_block (frame, 0); block; block = BLOCK_SUPERBLOCK (block))
+	{
+		struct block_iterator iter;
+		struct symbol *sym;
+
+		ALL_BLOCK_SYMBOLS (block, iter, sym) {
+			switch (sym->aclass()) {
+			case LOC_LOCAL:
+			case LOC_REGISTER:
+			case LOC_STATIC:
+			case LOC_COMPUTED:
+				try {
+					struct value *val = read_var_value (sym, NULL, frame);
+					struct frame_var var;
+					var.addr = value_address(val);
+					var.size = value_type(val)->length;
+					var.order = order++;
+					var.sym = sym;
+					vars.push_back(var);
+					if (var.size > table->max_var_size[frame_no])
+						table->max_var_size[frame_no] = var.size;
+				} catch (const gdb_exception_error &ex) {
+				}
+				break;
+			default:
+				break;
+			}
+		}
+		if (BLOCK_FUNCTION (block))
+			break;
+	}
+	std::sort(vars.begin(), vars.end(), frame_var_less);
+}
+
+/* The innermost local variable of the frame that has addr */
+static const struct frame_var*
+lookup_frame_var(struct thread_info* tp, int frame_no, address_t addr)
+{
+	struct frame_table* table = get_frame_table(tp);
+	const struct frame_var* best = NULL;
+
+	if (frame_no < 0 || (size_t)frame_no >= table->sp.size())
+		return NULL;
+	if (!table->vars_ready[frame_no])
+		build_frame_vars(tp, table, frame_no);
+
+	const std::vector<struct frame_var>& vars = table->vars[frame_no];
+	size_t max_size = table->max_var_size[frame_no];
+	auto itr = std::upper_bound(vars.begin(), vars.end(), addr,
+			[](address_t a, const struct frame_var& v) { return a < v.addr; });
+	/* variables that may have addr start no lower than addr - max_size */
+	while (itr != vars.begin())
+	{
+		--itr;
+		if (itr->addr + max_size <= addr)
+			break;
+		if (addr < itr->addr + itr->size && (!best || itr->order < best->order))
+			best = &*itr;
+	}
+	return best;
+}
+
+int
+get_frame_number(const struct ca_segment* segment, address_t addr, int* offset)
+{
+	int frame;
+	struct thread_info* tp = (struct thread_info*) segment->m_thread.context;
+
+	*offset = -1;
+	if (!tp)
+		return -1;
+
+	/*
+	 * addr belongs to the frame before the first one whose sp is above
+	 * it, starting from the innermost frame
+	 */
+	const struct frame_table* table = get_frame_table(tp);
+	frame = (int)(std::upper_bound(table->max_sp.begin(), table->max_sp.end(), addr)
+			- table->max_sp.begin()) - 1;
+	if (frame >= 0)
+		*offset = (int)((long)addr - (long)table->sp[frame]);
 
 	return frame;
 }
@@ -610,44 +1313,24 @@ is_heap_object_with_vptr(const struct object_reference* ref,
 			 size_t buf_sz)
 {
 	size_t ptr_sz = g_ptr_bit >> 3;
-	int rs = false;
 	address_t addr = ref->where.heap.addr;
 	address_t val = 0;
-	if (target_read_memory(addr, (gdb_byte *)&val, ptr_sz) == 0 && val)
+
+	/*
+	 * the first data of a C++ object with virtual functions points into
+	 * a "vtable for <class>" symbol
+	 */
+	if (read_memory_wrapper(NULL, addr, &val, ptr_sz) && val)
 	{
-		struct ca_segment* segment = get_segment(val, 0);
-		if (segment && (segment->m_type == ENUM_MODULE_DATA || segment->m_type == ENUM_MODULE_TEXT) )
+		const struct vtable_range* vtable = lookup_vtable(val);
+		if (vtable)
 		{
-			/*
-			 * the first data belongs to a module's data section, it is likely a vptr
-			 * to be sure, check its symbol
-			 */
-			address_t vptr = val;
-			std::string name;
-			std::string filename;
-			int unmapped = 0;
-			int offset = 0;
-			int line = 0;
-
-			if (build_address_symbolic (get_current_arch(), vptr,
-				true /*do_demangle*/, true /* prefer sym over minsym */,
-				&name, &offset,	&filename, &line, &unmapped) == 0)
-			{
-				const char *prefix = "vtable for ";
-				const int prefix_len = strlen(prefix);
-				//if (strncmp(name.c_str(), prefix, prefix_len) == 0)
-				if (name.rfind(prefix, 0) == 0)
-				{
-					rs = true;
-					if (name_buf)
-					{
-						strncpy(name_buf, name.c_str() + prefix_len, buf_sz);
-					}
-				}
-			}
+			if (name_buf)
+				snprintf(name_buf, buf_sz, "%s", vtable->name);
+			return true;
 		}
 	}
-	return rs;
+	return false;
 }
 
 /*
@@ -661,10 +1344,11 @@ struct ca_addr_type_pair
 	unsigned int size;
 };
 
-/* FIXME The map should really be a BST instead of an array */
-static struct ca_addr_type_pair* addr_type_map = NULL;
-static unsigned int addr_type_map_sz = 0;
-static unsigned int addr_type_map_buf_sz = 0;
+/*
+ * Known types keyed by their addresses. No entry is inside another, hence
+ * both starts and ends of entries are in increasing order.
+ */
+static std::map<address_t, struct ca_addr_type_pair> addr_type_map;
 
 /*
  * return false if the address is already in the map, or invalid params
@@ -672,7 +1356,7 @@ static unsigned int addr_type_map_buf_sz = 0;
 static bool
 add_addr_type(address_t addr, struct type* type, struct symbol* sym)
 {
-	int i;
+	struct ca_addr_type_pair pair;
 
 	if (sym)
 		type = sym->type();
@@ -683,41 +1367,26 @@ add_addr_type(address_t addr, struct type* type, struct symbol* sym)
 	if (type->code() == TYPE_CODE_PTR || type->code() == TYPE_CODE_REF)
 		type = TYPE_TARGET_TYPE (type);
 
-	/* check duplicate entry */
-	for (i = addr_type_map_sz - 1; i >= 0; i--)
+	pair.addr = addr;
+	pair.type = type;
+	pair.sym  = sym;
+	pair.size = TYPE_LENGTH(type);
+
+	/* The new type is the sub-type of an existing one */
+	auto itr = addr_type_map.upper_bound(addr);
+	if (itr != addr_type_map.begin())
 	{
-		/* The new type is the sub-type of an existing one */
-		if (addr >= addr_type_map[i].addr &&
-		    addr + TYPE_LENGTH(type) <= addr_type_map[i].addr + addr_type_map[i].size) {
-			return true;
-		}
-		/* The new type is the super-type of an existing one */
-		else if (addr_type_map[i].addr >= addr &&
-		    addr_type_map[i].addr + addr_type_map[i].size <= addr + TYPE_LENGTH(type)) {
-			addr_type_map[i].addr = addr;
-			addr_type_map[i].type = type;
-			addr_type_map[i].sym  = sym;
-			addr_type_map[i].size = TYPE_LENGTH(type);
+		auto prev = std::prev(itr);
+		if (addr + pair.size <= prev->second.addr + prev->second.size)
 			return true;
-		}
-	}
-	/* expand buffer if necessary */
-	if (addr_type_map_sz >= addr_type_map_buf_sz)
-	{
-		if (addr_type_map_buf_sz == 0)
-			addr_type_map_buf_sz = 64;
-		else
-			addr_type_map_buf_sz = addr_type_map_buf_sz * 2;
-		addr_type_map = (struct ca_addr_type_pair *)
-		    realloc(addr_type_map, addr_type_map_buf_sz * sizeof(struct ca_addr_type_pair));
 	}
-	/* append the newly-discovered type */
-	addr_type_map[addr_type_map_sz].addr = addr;
-	addr_type_map[addr_type_map_sz].type = type;
-	addr_type_map[addr_type_map_sz].sym = sym;
-	addr_type_map[addr_type_map_sz].size = TYPE_LENGTH(type);
-	addr_type_map_sz++;
+	/* The new type is the super-type of existing ones */
+	itr = addr_type_map.lower_bound(addr);
+	while (itr != addr_type_map.end() && itr->first < addr + pair.size
+		&& itr->second.addr + itr->second.size <= addr + pair.size)
+		itr = addr_type_map.erase(itr);
 
+	addr_type_map[addr] = pair;
 	return true;
 }
 
@@ -725,14 +1394,13 @@ add_addr_type(address_t addr, struct type* type, struct symbol* sym)
 static struct ca_addr_type_pair*
 lookup_type_by_addr(address_t addr)
 {
-	int i;
-	/* pick up the latest first */
-	for (i=addr_type_map_sz-1; i>=0; i--)
-	{
-		if (addr >= addr_type_map[i].addr
-			&& addr < addr_type_map[i].addr + addr_type_map[i].size)
-			return &addr_type_map[i];
-	}
+	/* only the last entry starting at or below addr may have it */
+	auto itr = addr_type_map.upper_bound(addr);
+	if (itr == addr_type_map.begin())
+		return NULL;
+	--itr;
+	if (addr < itr->second.addr + itr->second.size)
+		return &itr->second;
 	return NULL;
 }
 
@@ -851,7 +1519,7 @@ get_struct_field_type_and_name(struct type *basetype,
 void
 clear_addr_type_map(void)
 {
-	addr_type_map_sz = 0;
+	addr_type_map.clear();
 }
 
 /*
@@ -1214,167 +1882,278 @@ get_thread_id (const struct ca_segment* segment)
 	return info->per_inf_num;
 }
 
-static struct minimal_symbol*
-get_global_minimal_sym(const struct object_reference* ref,
-		       address_t* sym_addr, size_t* sym_sz)
+/*
+ * Minimal symbols of allocated sections sorted by address
+ *	They are collected once, instead of walking all sections of all
+ *	object files for every address. A full symbol is looked up by the
+ *	name of its minimal symbol once as well.
+ */
+struct section_sym
+{
+	address_t addr;
+	size_t size;
+	int prev_sized;		/* the closest one at or before this with a size, -1 if none */
+	bool sym_resolved;
+	struct symbol* sym;	/* full symbol, valid if sym_resolved */
+	struct minimal_symbol* msym;
+};
+
+struct section_syms
+{
+	address_t addr;
+	address_t endaddr;
+	std::vector<struct section_sym> syms;
+};
+
+static std::vector<struct section_syms> g_section_syms;
+static bool g_section_syms_ready = false;
+
+/* Vtables of all modules sorted by address, with interned class names */
+static std::vector<struct vtable_range> g_vtable_index;
+static std::set<std::string> g_vtable_names;
+static bool g_vtable_index_ready = false;
+
+static void
+section_syms_invalidate(void)
+{
+	g_section_syms.clear();
+	g_section_syms_ready = false;
+	g_vtable_index.clear();
+	g_vtable_names.clear();
+	g_vtable_index_ready = false;
+}
+
+static bool
+section_sym_less(const struct section_sym& a, const struct section_sym& b)
+{
+	return a.addr < b.addr;
+}
+
+static bool
+section_syms_less(const struct section_syms& a, const struct section_syms& b)
+{
+	return a.addr < b.addr;
+}
+
+static void
+build_section_syms(void)
 {
 	struct obj_section *osect;
+	size_t i;
 
+	attach_cache_observers();
+	g_section_syms.clear();
 	for (objfile *objfile : current_program_space->objfiles ()) {
+		std::map<const struct obj_section*, size_t> sect_index;
+
+		/*
+		* Only process each object file once, even if there's a
+		* separate debug file.
+		*/
+		if (objfile->separate_debug_objfile_backlink)
+			continue;
+
 		ALL_OBJFILE_OSECTIONS (objfile, osect) {
-			address_t sect_addr;
-			struct bound_minimal_symbol bmsymbol;
+			flagword flags = osect->the_bfd_section->flags;
+			struct section_syms sect;
 
-			/*
-			* Only process each object file once, even if there's a
-			* separate debug file.
-			*/
-			if (objfile->separate_debug_objfile_backlink)
+			/* thread-local sections overlap others at their addresses */
+			if (!(flags & SEC_ALLOC) || (flags & SEC_THREAD_LOCAL))
 				continue;
+			sect.addr = osect->addr();
+			sect.endaddr = osect->endaddr();
+			if (sect.addr >= sect.endaddr)
+				continue;
+			sect_index[osect] = g_section_syms.size();
+			g_section_syms.push_back(sect);
+		}
 
-			sect_addr = overlay_mapped_address (ref->vaddr, osect);
+		for (minimal_symbol *msym : objfile->msymbols ()) {
+			struct section_sym entry;
 
-			if (osect->addr() <= sect_addr &&
-				sect_addr < osect->endaddr()) {
-				bmsymbol = lookup_minimal_symbol_by_pc_section(sect_addr, osect);
-				if (bmsymbol.minsym != NULL && bmsymbol.objfile != NULL) {
-					if (sym_addr != NULL && sym_sz != NULL) {
-						*sym_addr = BMSYMBOL_VALUE_ADDRESS(bmsymbol);
-						*sym_sz   = MSYMBOL_SIZE (bmsymbol.minsym);
-					}
-					return bmsymbol.minsym;
-				}
-				break;
-			}
+			/* absolute symbols are skipped by lookup_minimal_symbol_by_pc_section */
+			if (MSYMBOL_TYPE (msym) == mst_abs)
+				continue;
+			auto itr = sect_index.find(MSYMBOL_OBJ_SECTION (objfile, msym));
+			if (itr == sect_index.end())
+				continue;
+			entry.addr = MSYMBOL_VALUE_ADDRESS (objfile, msym);
+			entry.size = MSYMBOL_SIZE (msym);
+			entry.prev_sized = -1;
+			entry.sym_resolved = false;
+			entry.sym = NULL;
+			entry.msym = msym;
+			g_section_syms[itr->second].syms.push_back(entry);
 		}
 	}
 
-	return NULL;
+	for (auto& sect : g_section_syms) {
+		std::stable_sort(sect.syms.begin(), sect.syms.end(), section_sym_less);
+		for (i = 0; i < sect.syms.size(); i++) {
+			if (sect.syms[i].size)
+				sect.syms[i].prev_sized = i;
+			else if (i > 0)
+				sect.syms[i].prev_sized = sect.syms[i-1].prev_sized;
+		}
+	}
+	std::sort(g_section_syms.begin(), g_section_syms.end(), section_syms_less);
+	g_section_syms_ready = true;
 }
 
-struct symbol*
-get_global_sym(const struct object_reference* ref,
-	       address_t* sym_addr, size_t* sym_sz)
+static bool
+vtable_range_less(const struct vtable_range& a, const struct vtable_range& b)
 {
-	struct symbol* sym = NULL;
+	return a.low < b.low;
+}
 
-	if (ref->storage_type != ENUM_MODULE_DATA && ref->storage_type != ENUM_MODULE_TEXT)
-		return NULL;
+const std::vector<struct vtable_range>&
+get_vtable_index(void)
+{
+	const char *prefix = "vtable for ";
+	const size_t prefix_len = strlen(prefix);
 
-	struct obj_section *osect;
+	if (g_vtable_index_ready)
+		return g_vtable_index;
+
+	attach_cache_observers();
+	g_vtable_index.clear();
+	g_vtable_names.clear();
 	for (objfile *objfile : current_program_space->objfiles ()) {
-		ALL_OBJFILE_OSECTIONS (objfile, osect)
-		{
-			/*
-			* Only process each object file once, even if there's a separate
-			* debug file.
-			*/
-			if (objfile->separate_debug_objfile_backlink)
+		if (objfile->separate_debug_objfile_backlink)
+			continue;
+		for (minimal_symbol *msym : objfile->msymbols ()) {
+			const char* name = msym->natural_name();
+			struct vtable_range vtable;
+
+			if (MSYMBOL_SIZE (msym) == 0 || strncmp(name, prefix, prefix_len) != 0)
 				continue;
+			vtable.low = MSYMBOL_VALUE_ADDRESS (objfile, msym);
+			vtable.high = vtable.low + MSYMBOL_SIZE (msym);
+			/* a class has the same name in all modules */
+			vtable.name = g_vtable_names.insert(std::string(name + prefix_len)).first->c_str();
+			g_vtable_index.push_back(vtable);
+		}
+	}
+	std::sort(g_vtable_index.begin(), g_vtable_index.end(), vtable_range_less);
+	g_vtable_index_ready = true;
+	return g_vtable_index;
+}
+
+/* The vtable that has vptr, NULL if none */
+static const struct vtable_range*
+lookup_vtable(address_t vptr)
+{
+	const std::vector<struct vtable_range>& vtables = get_vtable_index();
+
+	auto itr = std::upper_bound(vtables.begin(), vtables.end(), vptr,
+			[](address_t v, const struct vtable_range& r) { return v < r.low; });
+	if (itr == vtables.begin() || vptr >= (--itr)->high)
+		return NULL;
+	return &*itr;
+}
+
+/*
+ * Same choice as lookup_minimal_symbol_by_pc_section, the closest symbol
+ * with a size if it has addr, otherwise the closest symbol without a size
+ * after it.
+ */
+static struct section_sym*
+lookup_section_sym(address_t addr)
+{
+	if (!g_section_syms_ready)
+		build_section_syms();
+
+	auto sect = std::upper_bound(g_section_syms.begin(), g_section_syms.end(), addr,
+			[](address_t a, const struct section_syms& s) { return a < s.addr; });
+	if (sect == g_section_syms.begin())
+		return NULL;
+	--sect;
+	if (addr >= sect->endaddr)
+		return NULL;
 
-			CORE_ADDR sect_addr = overlay_mapped_address (ref->vaddr, osect);
+	auto itr = std::upper_bound(sect->syms.begin(), sect->syms.end(), addr,
+			[](address_t a, const struct section_sym& s) { return a < s.addr; });
+	if (itr == sect->syms.begin())
+		return NULL;
+	--itr;
+	if (itr->prev_sized >= 0)
+	{
+		struct section_sym* sized = &sect->syms[itr->prev_sized];
+		if (addr < sized->addr + sized->size)
+			return sized;
+	}
+	if (itr->size == 0)
+		return &*itr;
+	return NULL;
+}
 
-			if (osect->addr() <= sect_addr &&
-				sect_addr < osect->endaddr()) {
-				struct bound_minimal_symbol bmsymbol = lookup_minimal_symbol_by_pc_section (sect_addr, osect);
-				if (bmsymbol.minsym != NULL && bmsymbol.objfile != NULL) {
-					const char *msym_name;
-					off_t offset;
+static struct minimal_symbol*
+get_global_minimal_sym(const struct object_reference* ref,
+		       address_t* sym_addr, size_t* sym_sz)
+{
+	struct section_sym* entry = lookup_section_sym(ref->vaddr);
 
-					offset = sect_addr - BMSYMBOL_VALUE_ADDRESS(bmsymbol);
-					msym_name = bmsymbol.minsym->natural_name();
+	if (!entry)
+		return NULL;
+	if (sym_addr != NULL && sym_sz != NULL) {
+		*sym_addr = entry->addr;
+		*sym_sz   = entry->size;
+	}
+	return entry->msym;
+}
 
-					std::string loc_string(msym_name);
+struct symbol*
+get_global_sym(const struct object_reference* ref,
+	       address_t* sym_addr, size_t* sym_sz)
+{
+	struct section_sym* entry;
 
-					gdb_assert (osect->objfile && osect->objfile->original_name);
+	if (ref->storage_type != ENUM_MODULE_DATA && ref->storage_type != ENUM_MODULE_TEXT)
+		return NULL;
 
-					sym = lookup_symbol(loc_string.c_str(), 0, VAR_DOMAIN, 0).symbol;
-					if (sym != NULL) {
-						struct type* type = sym->type();
-						add_addr_type (ref->vaddr - offset, type, sym);
-						if (sym_addr && sym_sz) {
-							*sym_addr = ref->vaddr - offset;
-							*sym_sz   = TYPE_LENGTH(type);
-						}
-					} else if (sym_addr != 0 && sym_sz != 0) {
-						*sym_addr = BMSYMBOL_VALUE_ADDRESS(bmsymbol);
-						*sym_sz   = MSYMBOL_SIZE(bmsymbol.minsym);
-					}
-				}
-				break;
-			}
+	entry = lookup_section_sym(ref->vaddr);
+	if (!entry)
+		return NULL;
+	if (!entry->sym_resolved) {
+		entry->sym = lookup_symbol(entry->msym->natural_name(), 0, VAR_DOMAIN, 0).symbol;
+		entry->sym_resolved = true;
+	}
+	if (entry->sym != NULL) {
+		struct type* type = entry->sym->type();
+		add_addr_type (entry->addr, type, entry->sym);
+		if (sym_addr && sym_sz) {
+			*sym_addr = entry->addr;
+			*sym_sz   = TYPE_LENGTH(type);
 		}
+	} else if (sym_addr != 0 && sym_sz != 0) {
+		*sym_addr = entry->addr;
+		*sym_sz   = entry->size;
 	}
 
-	return sym;
+	return entry->sym;
 }
 
 struct symbol*
 get_stack_sym(const struct object_reference* ref,
 	      address_t* sym_addr, size_t* sym_sz)
 {
-	struct symbol *sym;
-	bool found_local_var = false;
+	const struct frame_var* var;
 	struct ca_segment*segment = get_segment (ref->vaddr, 1);
-	if (ref->where.stack.frame >= 0 && segment && segment->m_type == ENUM_STACK)
-	{
-		struct frame_info* frame;
-		const struct block *block;
-		address_t pc;
-		int i;
-		struct thread_info *tp = (struct thread_info*) segment->m_thread.context;
-
-		/* switch to the thread/frame */
-		switch_to_thread (tp);
-		frame = get_current_frame ();
-		for (i=0; i<ref->where.stack.frame; i++)
-			frame = get_prev_frame(frame);
-
-		/* check local vars */
-		if (get_frame_pc_if_available (frame, &pc) &&
-		    (block = get_frame_block (frame, 0) ) ) {
-			while (block && !found_local_var) {
-				struct block_iterator iter;
-				volatile struct gdb_exception except;
-
-				ALL_BLOCK_SYMBOLS (block, iter, sym) {
-					switch (sym->aclass()) {
-					case LOC_LOCAL:
-					case LOC_REGISTER:
-					case LOC_STATIC:
-					case LOC_COMPUTED:
-						try {
-							struct value *val = read_var_value (sym, NULL, frame);
-							address_t val_addr = value_address(val);
-							struct type * type = value_type(val);
-							size_t val_size = type->length;
-							if (ref->vaddr >= val_addr && ref->vaddr < val_addr + val_size)
-							{
-								found_local_var = true;
-								if (sym_addr && sym_sz)
-								{
-									*sym_addr = val_addr;
-									*sym_sz = val_size;
-								}
-							}
-						} catch (const gdb_exception_error &ex) {
-						}
-						break;
-					default:
-						break;
-					}
-					if (found_local_var)
-						break;
-				}
 
-				/* move up to super block until reach function scope */
-				if (BLOCK_FUNCTION (block))
-					break;
-				block = BLOCK_SUPERBLOCK (block);
-			}
-		}
+	if (ref->where.stack.frame < 0 || !segment || segment->m_type != ENUM_STACK
+		|| !segment->m_thread.context)
+		return NULL;
+
+	var = lookup_frame_var((struct thread_info*) segment->m_thread.context,
+			ref->where.stack.frame, ref->vaddr);
+	if (!var)
+		return NULL;
+	if (sym_addr && sym_sz)
+	{
+		*sym_addr = var->addr;
+		*sym_sz = var->size;
 	}
-	return found_local_var ? sym : NULL;
+	return var->sym;
 }
 
 struct type*
@@ -1447,6 +2226,43 @@ known_heap_block(const struct object_reference* ref)
 	return (type != NULL);
 }
 
+static bool
+symbolize_ref_less(const struct object_reference* a, const struct object_reference* b)
+{
+	if (a->storage_type != b->storage_type)
+		return a->storage_type < b->storage_type;
+	if (a->storage_type == ENUM_STACK)
+	{
+		if (a->where.stack.tid != b->where.stack.tid)
+			return a->where.stack.tid < b->where.stack.tid;
+		if (a->where.stack.frame != b->where.stack.frame)
+			return a->where.stack.frame < b->where.stack.frame;
+	}
+	return a->vaddr < b->vaddr;
+}
+
+/*
+ * Resolve symbols of refs in the order of their addresses, so that
+ * frames of a thread are visited together, and the following prints
+ * are served by the cached symbols
+ */
+void
+symbolize_refs(const std::vector<struct object_reference*>& refs)
+{
+	std::vector<const struct object_reference*> sorted(refs.begin(), refs.end());
+	address_t sym_addr;
+	size_t sym_sz;
+
+	std::sort(sorted.begin(), sorted.end(), symbolize_ref_less);
+	for (auto ref : sorted)
+	{
+		if (ref->storage_type == ENUM_MODULE_DATA || ref->storage_type == ENUM_MODULE_TEXT)
+			get_global_sym(ref, &sym_addr, &sym_sz);
+		else if (ref->storage_type == ENUM_STACK)
+			get_stack_sym(ref, &sym_addr, &sym_sz);
+	}
+}
+
 void
 print_stack_ref(const struct object_reference* ref)
 {
@@ -0,0 +1 @@
+../../../src/simd_scan.h
\ No newline at end of file
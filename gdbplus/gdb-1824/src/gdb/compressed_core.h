@@ -0,0 +1 @@
+../../../../src/compressed_core.h
\ No newline at end of file
@@ -11,6 +11,9 @@
 #include "decode.h"
 
 #include <sys/param.h> // for MAXPATHLEN
+#include <algorithm>
+#include <set>
+#include <string>
 #include "dis-asm.h"
 #include "readline/readline.h"
 
@@ -34,6 +37,11 @@ struct ca_debug_context g_debug_context = {0, 0, 0, NULL};
 
 static int g_rsp_regnum = -1;
 
+// vtables of all modules sorted by address, built on first use
+static std::vector<struct vtable_range> g_vtable_index;
+static std::set<std::string> g_vtable_names;
+static CA_BOOL g_vtable_index_ready = CA_FALSE;
+
 //static CA_BOOL g_quit = CA_FALSE;
 
 /***************************************************************************
@@ -574,6 +582,9 @@ CA_BOOL update_memory_segments_and_heaps()
 		release_all_segments();
 	}
 
+	// modules may have been loaded or unloaded
+	g_vtable_index_ready = CA_FALSE;
+
 	// make sure this function won't change debug context
 	old_chain = make_cleanup_restore_current_debug_context();
 	// Query Target Process's address space
@@ -1289,6 +1300,46 @@ static CA_BOOL known_heap_block(const struct object_reference* ref)
 	return (type != NULL);
 }
 
+// Symbols are looked up one by one when a reference is printed
+void symbolize_refs(const std::vector<struct object_reference*>& refs)
+{
+}
+
+static bool vtable_range_less(const struct vtable_range& a, const struct vtable_range& b)
+{
+	return a.low < b.low;
+}
+
+const std::vector<struct vtable_range>& get_vtable_index(void)
+{
+	const char *prefix = "vtable for ";
+	const size_t prefix_len = strlen(prefix);
+	struct objfile *objfile;
+	struct minimal_symbol *msym;
+
+	if (g_vtable_index_ready)
+		return g_vtable_index;
+
+	g_vtable_index.clear();
+	g_vtable_names.clear();
+	ALL_MSYMBOLS (objfile, msym)
+	{
+		const char* name = SYMBOL_NATURAL_NAME (msym);
+		struct vtable_range vtable;
+
+		if (MSYMBOL_SIZE (msym) == 0 || !name || strncmp(name, prefix, prefix_len) != 0)
+			continue;
+		vtable.low = SYMBOL_VALUE_ADDRESS (msym);
+		vtable.high = vtable.low + MSYMBOL_SIZE (msym);
+		// a class has the same name in all modules
+		vtable.name = g_vtable_names.insert(std::string(name + prefix_len)).first->c_str();
+		g_vtable_index.push_back(vtable);
+	}
+	std::sort(g_vtable_index.begin(), g_vtable_index.end(), vtable_range_less);
+	g_vtable_index_ready = CA_TRUE;
+	return g_vtable_index;
+}
+
 void print_stack_ref(const struct object_reference* ref)
 {
 	struct symbol* sym;
@@ -0,0 +1 @@
+../../../../src/ptr_bitmap.h
\ No newline at end of file
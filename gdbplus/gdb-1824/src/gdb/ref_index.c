@@ -0,0 +1 @@
+../../../../src/ref_index.cpp
\ No newline at end of file
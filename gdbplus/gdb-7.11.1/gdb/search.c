@@ -78,8 +78,8 @@ search_value_by_range(struct ca_segment* segment,
 	size_t ptr_sz = g_ptr_bit >> 3;
 	size_t max_bit_index  = segment->m_fsize / ptr_sz;
 
-	if (!segment->m_bitvec_ready)
-		set_addressable_bit_vec(segment);
+	// an evicted bit vector is rebuilt
+	set_addressable_bit_vec(segment);
 
 	// find next addressable pointer
 	while (*next_bit_index < max_bit_index)
@@ -88,62 +88,39 @@ search_value_by_range(struct ca_segment* segment,
 		// The bit vector of addressable can speed up search significantly
 		if (target_is_ptr)
 		{
-			unsigned int i;
-			unsigned int uint_bit;
-			size_t uint_index = *next_bit_index >> 5;
-			unsigned int bits = segment->m_ptr_bitvec[uint_index];
+			size_t offset;
+			const char* next_ref;
+			address_t val;
 
-			if (bits == 0)
-			{
-				// There are no addressable ptrs in the next chunk of memory (32 ptrs)
-				// Also account for unaligned next_bit_index
-				*next_bit_index = (*next_bit_index & ~(size_t)0x1F) + 32;
-				continue;
-			}
-			// consider the bit inside the uint
-			uint_bit = *next_bit_index & (size_t)0x1F;
-			bits &= ~( (1 << uint_bit) - 1);
-			if (bits == 0)
-			{
-				*next_bit_index = (*next_bit_index & ~(size_t)0x1F) + 32;
-				continue;
-			}
-			// find the non-zero bit
-			bits = bits >> uint_bit;
-			for (i=uint_bit; i<32; i++)
+			*next_bit_index = next_ptr_bit(segment->m_ptr_bitmap, *next_bit_index, max_bit_index);
+			if (*next_bit_index >= max_bit_index)
+				break;
+			// this is a valid ptr, check if it points to target object
+			offset = *next_bit_index * ptr_sz;
+			next_ref = segment->m_faddr + offset;
+			if (ptr_sz == 8)
 			{
-				if (bits & 0x1)
-				{
-					// this is a valid ptr, check if it points to target object
-					size_t offset = *next_bit_index * ptr_sz;
-					const char* next_ref = segment->m_faddr + offset;
-					address_t val;
-					if (ptr_sz == 8)
-					{
 #ifdef sun
-						// sparcv9 core aligns on 4-byte only. sigh..
-						if ((address_t)next_ref & 0x7ul)
-							memcpy(&val, next_ref, 8);
-						else
+				// sparcv9 core aligns on 4-byte only. sigh..
+				if ((address_t)next_ref & 0x7ul)
+					memcpy(&val, next_ref, 8);
+				else
 #endif
-							val = *(address_t*)next_ref;
-					}
-					else
-						val = *(unsigned int*)next_ref;
+					val = *(address_t*)next_ref;
+			}
+			else
+				val = *(unsigned int*)next_ref;
 
-					for (target_index=0; targets[target_index]; target_index++)
-					{
-						if (val >= targets[target_index]->low && val < targets[target_index]->high)
-						{
-							*found_val = val;
-							*found_vaddr = segment->m_vaddr + offset;
-							return true;
-						}
-					}
+			for (target_index=0; targets[target_index]; target_index++)
+			{
+				if (val >= targets[target_index]->low && val < targets[target_index]->high)
+				{
+					*found_val = val;
+					*found_vaddr = segment->m_vaddr + offset;
+					return true;
 				}
-				bits = bits >> 1;
-				(*next_bit_index)++;
 			}
+			(*next_bit_index)++;
 		}
 		else	// we have to scan raw data for arbitrary target
 		{
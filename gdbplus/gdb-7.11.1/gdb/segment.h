@@ -0,0 +1 @@
+../../../src/segment.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../../src/simd_scan.cpp
\ No newline at end of file
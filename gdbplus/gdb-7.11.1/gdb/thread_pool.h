@@ -0,0 +1 @@
+../../../src/thread_pool.h
\ No newline at end of file
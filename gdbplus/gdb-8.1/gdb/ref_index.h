@@ -0,0 +1 @@
+../../../src/ref_index.h
\ No newline at end of file
@@ -13,6 +13,7 @@
 #include "ref.h"
 #include "search.h"
 #include "segment.h"
+#include <vector>
 #include <list>
 
 extern PyTypeObject object_ref_type
@@ -515,7 +516,7 @@ PyObject *gdbpy_cpp_object (PyObject *self, PyObject *args)
 			PyList_SET_ITEM(result, i, (PyObject*)obj_ref);
 			i++;
 
-			free (ref);
+			delete ref;
 		}
 	}
 	else
@@ -595,7 +596,7 @@ PyObject *gdbpy_shared_object (PyObject *self, PyObject *args)
 			PyList_SET_ITEM(result, i, (PyObject*)obj_ref);
 			i++;
 
-			free (ref);
+			delete ref;
 		}
 	}
 	else
@@ -685,7 +686,7 @@ PyObject *gdbpy_objref (PyObject *self, PyObject *args)
 			PyList_SET_ITEM(result, i, (PyObject*)obj_ref);
 			i++;
 
-			free (ref);
+			delete ref;
 		}
 	}
 	else
@@ -697,6 +698,103 @@ PyObject *gdbpy_objref (PyObject *self, PyObject *args)
 	return result;
 }
 
+/*
+ * Implementation of gdb.ref_batch()
+ * Take at least one argument: a list of objects, each of which is an
+ *   address or a tuple of address and size
+ *   2nd argument: search scope
+ * Memory is searched once for all objects.
+ * Returns a list of lists of gdb.Object_ref objects, one for each object
+ */
+PyObject *gdbpy_objref_batch (PyObject *self, PyObject *args)
+{
+	PyObject *result = NULL;
+	PyObject *obj_list;
+	int num_args = PyTuple_Size (args);
+	Py_ssize_t num_objs, i;
+	enum storage_type stype = ENUM_ALL;
+	std::vector<struct object_range> objects;
+
+	// Get the input arguments
+	if (num_args < 1 || num_args > 2)
+	{
+		PyErr_SetString (PyExc_TypeError, _("The function takes at least one argument and two arguments in most: a list of objects and scope."));
+		return NULL;
+	}
+
+	// The 1st argument is a list of objects
+	obj_list = PyTuple_GetItem (args, 0);
+	if (!PyList_Check (obj_list))
+	{
+		PyErr_SetString (PyExc_TypeError, _("Expect a list of object addresses or (address, size) tuples as the first parameter"));
+		return NULL;
+	}
+	num_objs = PyList_Size (obj_list);
+	for (i = 0; i < num_objs; i++)
+	{
+		PyObject *item = PyList_GetItem (obj_list, i);
+		struct object_range range;
+		size_t obj_size = 1;
+
+		if (PyInt_Check (item))
+			range.low = (address_t) PyInt_AsLong (item);
+		else if (PyTuple_Check (item) && PyTuple_Size (item) == 2
+			&& PyInt_Check (PyTuple_GetItem (item, 0))
+			&& PyInt_Check (PyTuple_GetItem (item, 1)))
+		{
+			range.low = (address_t) PyInt_AsLong (PyTuple_GetItem (item, 0));
+			obj_size = (size_t) PyInt_AsLong (PyTuple_GetItem (item, 1));
+		}
+		else
+		{
+			PyErr_SetString (PyExc_TypeError, _("Expect an integer of object address or a tuple of object address and size"));
+			return NULL;
+		}
+		range.high = range.low + obj_size;
+		objects.push_back(range);
+	}
+	// 2nd argument is the searching scope
+	if (num_args == 2)
+	{
+		PyObject *obj = PyTuple_GetItem (args, 1);
+		if (PyInt_Check (obj))
+			stype = (enum storage_type) PyInt_AsLong (obj);
+		else
+		{
+			PyErr_SetString (PyExc_TypeError, _("Expect an integer of search scope for the second parameter"));
+			return NULL;
+		}
+	}
+
+	// Make sure we have built necessary data structures to do searching
+	if (!update_memory_segments_and_heaps())
+	{
+		PyErr_SetString (PyExc_MemoryError, _("Failed to read and initialize process's heap segments."));
+		return NULL;
+	}
+
+	// Search for the references of all objects at once
+	std::vector<std::list<struct object_reference*>> refs_list = search_object_refs_batch (objects, stype);
+	result = PyList_New(refs_list.size());
+	for (i = 0; i < (Py_ssize_t) refs_list.size(); i++)
+	{
+		PyObject *refs = PyList_New(refs_list[i].size());
+		unsigned int k = 0;
+		for (auto ref : refs_list[i])
+		{
+			object_ref* obj_ref = PyObject_New (object_ref, &object_ref_type);
+			obj_ref->ref = *ref;
+			PyList_SET_ITEM(refs, k, (PyObject*)obj_ref);
+			k++;
+
+			delete ref;
+		}
+		PyList_SET_ITEM(result, i, refs);
+	}
+
+	return result;
+}
+
 PyObject *gdbpy_global_and_static_symbols (PyObject *self, PyObject *args)
 {
 	gdbpy_ref<> return_list (PyList_New (0));
@@ -0,0 +1,533 @@
+/*
+ * compressed_core.cpp
+ *		Access a zstd compressed core file without decompressing it
+ *		to disk
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include "segment.h"
+#include "compressed_core.h"
+
+bool g_core_compressed = false;
+
+#ifdef HAVE_LIBZSTD
+
+#include <elf.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <vector>
+#include <zstd.h>
+
+#include "thread_pool.h"
+
+/***************************************************************************
+* Frames are the unit of random access. The frame index comes from the
+* seek table of the zstd seekable format if there is one, otherwise from
+* walking the frame headers, which requires every frame to record its
+* content size (zstd --seekable, pzstd, or zstd -B).
+*
+* Decompressed frames are placed at their offsets in an anonymous mapping
+* of the whole image, which costs no memory until it is written. Resident
+* frames are kept in LRU order, an unpinned frame is released with
+* madvise() once the resident size exceeds the cache limit.
+***************************************************************************/
+#define SEEKABLE_MAGIC         0x8F92EAB1u
+#define SEEK_TABLE_FRAME_MAGIC 0x184D2A5Eu
+#define SEEK_TABLE_FOOTER_SZ   9
+#define SKIPPABLE_FRAME_HDR_SZ 8
+#define MAX_CORE_FRAME_SZ      (256ul*1024*1024)
+#define CORE_CACHE_MAX         (4ul*1024*1024*1024)
+
+enum core_frame_state
+{
+	FRAME_EVICTED,
+	FRAME_LOADING,
+	FRAME_RESIDENT
+};
+
+struct core_frame
+{
+	size_t m_coffset;	// in the compressed file
+	size_t m_csize;
+	size_t m_doffset;	// in the decompressed image
+	size_t m_dsize;
+	enum core_frame_state m_state;
+	unsigned int m_pins;
+	std::list<unsigned int>::iterator m_lru;	// valid if resident
+};
+
+static std::vector<struct core_frame> g_core_frames;
+static std::list<unsigned int> g_core_lru;	// the most recently used first
+static std::mutex g_core_lock;
+static std::condition_variable g_core_cond;
+static size_t g_core_resident = 0;
+
+static int    g_zfile_fd = -1;
+static char*  g_zfile = NULL;
+static size_t g_zfile_size = 0;
+static char*  g_core_image = NULL;
+static size_t g_core_image_size = 0;
+static size_t g_page_size = 4096;
+
+static unsigned int read_le32(const char* p)
+{
+	const unsigned char* u = (const unsigned char*)p;
+	return u[0] | (u[1] << 8) | (u[2] << 16) | ((unsigned int)u[3] << 24);
+}
+
+static bool add_core_frame(size_t coffset, size_t csize, size_t doffset, size_t dsize)
+{
+	struct core_frame frame;
+
+	if (dsize > MAX_CORE_FRAME_SZ)
+	{
+		CA_PRINT("A frame of %ld bytes is too big for random access\n", (long)dsize);
+		return false;
+	}
+	frame.m_coffset = coffset;
+	frame.m_csize = csize;
+	frame.m_doffset = doffset;
+	frame.m_dsize = dsize;
+	frame.m_state = FRAME_EVICTED;
+	frame.m_pins = 0;
+	g_core_frames.push_back(frame);
+	return true;
+}
+
+// The seek table is a skippable frame at the end of the file
+static bool read_seek_table(void)
+{
+	const char* footer;
+	const char* table;
+	unsigned int nframes, i;
+	size_t entry_sz, table_sz, coffset = 0, doffset = 0;
+
+	if (g_zfile_size < SEEK_TABLE_FOOTER_SZ + SKIPPABLE_FRAME_HDR_SZ)
+		return false;
+	footer = g_zfile + g_zfile_size - SEEK_TABLE_FOOTER_SZ;
+	if (read_le32(footer + 5) != SEEKABLE_MAGIC)
+		return false;
+	nframes = read_le32(footer);
+	entry_sz = (footer[4] & 0x80) ? 12 : 8;	// with checksum or not
+	table_sz = nframes * entry_sz + SEEK_TABLE_FOOTER_SZ;
+	if (table_sz + SKIPPABLE_FRAME_HDR_SZ > g_zfile_size)
+		return false;
+	table = g_zfile + g_zfile_size - table_sz;
+	if (read_le32(table - SKIPPABLE_FRAME_HDR_SZ) != SEEK_TABLE_FRAME_MAGIC
+		|| read_le32(table - SKIPPABLE_FRAME_HDR_SZ + 4) != table_sz)
+		return false;
+
+	for (i = 0; i < nframes; i++)
+	{
+		size_t csize = read_le32(table + i * entry_sz);
+		size_t dsize = read_le32(table + i * entry_sz + 4);
+		if (!add_core_frame(coffset, csize, doffset, dsize))
+			return false;
+		coffset += csize;
+		doffset += dsize;
+	}
+	if (coffset > g_zfile_size - table_sz - SKIPPABLE_FRAME_HDR_SZ)
+		return false;
+	g_core_image_size = doffset;
+	return true;
+}
+
+static bool walk_frame_headers(void)
+{
+	size_t coffset = 0, doffset = 0;
+
+	while (coffset < g_zfile_size)
+	{
+		const char* src = g_zfile + coffset;
+		size_t csize = ZSTD_findFrameCompressedSize(src, g_zfile_size - coffset);
+		unsigned long long dsize;
+
+		if (ZSTD_isError(csize))
+		{
+			CA_PRINT("Invalid zstd frame at offset %ld\n", (long)coffset);
+			return false;
+		}
+		if (g_zfile_size - coffset >= 4 && (read_le32(src) & 0xFFFFFFF0u) == ZSTD_MAGIC_SKIPPABLE_START)
+		{
+			coffset += csize;
+			continue;
+		}
+		dsize = ZSTD_getFrameContentSize(src, csize);
+		if (dsize == ZSTD_CONTENTSIZE_UNKNOWN || dsize == ZSTD_CONTENTSIZE_ERROR)
+		{
+			CA_PRINT("zstd frame at offset %ld doesn't record its size\n", (long)coffset);
+			return false;
+		}
+		if (!add_core_frame(coffset, csize, doffset, dsize))
+			return false;
+		coffset += csize;
+		doffset += dsize;
+	}
+	g_core_image_size = doffset;
+	return true;
+}
+
+bool open_compressed_core(const char* fname)
+{
+	struct stat st;
+
+	close_compressed_core();
+	g_zfile_fd = open(fname, O_RDONLY);
+	if (g_zfile_fd == -1)
+		return false;
+	if (fstat(g_zfile_fd, &st) || st.st_size == 0)
+	{
+		close_compressed_core();
+		return false;
+	}
+	g_zfile_size = st.st_size;
+	g_zfile = (char*) mmap(NULL, g_zfile_size, PROT_READ, MAP_PRIVATE, g_zfile_fd, 0);
+	if (g_zfile == MAP_FAILED)
+	{
+		g_zfile = NULL;
+		close_compressed_core();
+		return false;
+	}
+
+	if (!read_seek_table())
+	{
+		g_core_frames.clear();
+		if (!walk_frame_headers())
+		{
+			CA_PRINT("%s is not seekable, please recompress it with \"zstd --seekable\" or pzstd\n", fname);
+			close_compressed_core();
+			return false;
+		}
+	}
+	if (g_core_image_size == 0)
+	{
+		close_compressed_core();
+		return false;
+	}
+
+	g_core_image = (char*) mmap(NULL, g_core_image_size, PROT_READ|PROT_WRITE,
+					MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+	if (g_core_image == MAP_FAILED)
+	{
+		g_core_image = NULL;
+		close_compressed_core();
+		return false;
+	}
+	g_page_size = sysconf(_SC_PAGESIZE);
+	g_core_compressed = true;
+	return true;
+}
+
+void close_compressed_core(void)
+{
+	std::lock_guard<std::mutex> guard(g_core_lock);
+
+	if (g_core_image)
+		munmap(g_core_image, g_core_image_size);
+	if (g_zfile)
+		munmap(g_zfile, g_zfile_size);
+	if (g_zfile_fd != -1)
+		close(g_zfile_fd);
+	g_core_image = NULL;
+	g_core_image_size = 0;
+	g_zfile = NULL;
+	g_zfile_size = 0;
+	g_zfile_fd = -1;
+	g_core_frames.clear();
+	g_core_lru.clear();
+	g_core_resident = 0;
+	g_core_compressed = false;
+}
+
+char* compressed_core_image(size_t* size)
+{
+	*size = g_core_image_size;
+	return g_core_image;
+}
+
+static bool frame_cmp(size_t offset, const struct core_frame& frame)
+{
+	return offset < frame.m_doffset;
+}
+
+// Return the index of the frame containing offset of the image
+static unsigned int find_core_frame(size_t offset)
+{
+	auto itr = std::upper_bound(g_core_frames.begin(), g_core_frames.end(), offset, frame_cmp);
+	return (itr - g_core_frames.begin()) - 1;
+}
+
+// Release the least recently used frames, the caller holds the lock
+static void evict_core_frames(void)
+{
+	auto itr = g_core_lru.end();
+	while (g_core_resident > CORE_CACHE_MAX && itr != g_core_lru.begin())
+	{
+		--itr;
+		struct core_frame& frame = g_core_frames[*itr];
+		if (frame.m_pins)
+			continue;
+		// pages shared with neighbor frames are kept
+		size_t start = ALIGN(frame.m_doffset, g_page_size);
+		size_t end = (frame.m_doffset + frame.m_dsize) & ~(g_page_size - 1);
+		if (end > start)
+			madvise(g_core_image + start, end - start, MADV_DONTNEED);
+		frame.m_state = FRAME_EVICTED;
+		g_core_resident -= frame.m_dsize;
+		itr = g_core_lru.erase(itr);
+	}
+}
+
+static bool pin_core_frame(unsigned int index)
+{
+	struct core_frame& frame = g_core_frames[index];
+	std::unique_lock<std::mutex> guard(g_core_lock);
+	size_t rc;
+
+	while (frame.m_state == FRAME_LOADING)
+		g_core_cond.wait(guard);
+	frame.m_pins++;
+	if (frame.m_state == FRAME_RESIDENT)
+	{
+		g_core_lru.splice(g_core_lru.begin(), g_core_lru, frame.m_lru);
+		return true;
+	}
+
+	// decompress without holding the lock
+	frame.m_state = FRAME_LOADING;
+	guard.unlock();
+	rc = ZSTD_decompress(g_core_image + frame.m_doffset, frame.m_dsize,
+				g_zfile + frame.m_coffset, frame.m_csize);
+	guard.lock();
+	if (ZSTD_isError(rc) || rc != frame.m_dsize)
+	{
+		frame.m_state = FRAME_EVICTED;
+		frame.m_pins--;
+	}
+	else
+	{
+		frame.m_state = FRAME_RESIDENT;
+		g_core_lru.push_front(index);
+		frame.m_lru = g_core_lru.begin();
+		g_core_resident += frame.m_dsize;
+		evict_core_frames();
+	}
+	g_core_cond.notify_all();
+	return frame.m_state == FRAME_RESIDENT;
+}
+
+static void unpin_core_frames(unsigned int first, unsigned int last)
+{
+	std::lock_guard<std::mutex> guard(g_core_lock);
+	for (unsigned int i = first; i <= last; i++)
+		g_core_frames[i].m_pins--;
+}
+
+bool pin_core_range(const char* faddr, size_t sz)
+{
+	size_t offset = faddr - g_core_image;
+	unsigned int first, last, i;
+
+	if (!g_core_image || faddr < g_core_image || sz == 0 || offset + sz > g_core_image_size)
+		return false;
+	first = find_core_frame(offset);
+	last = find_core_frame(offset + sz - 1);
+	for (i = first; i <= last; i++)
+	{
+		if (!pin_core_frame(i))
+		{
+			if (i > first)
+				unpin_core_frames(first, i - 1);
+			return false;
+		}
+	}
+	return true;
+}
+
+void unpin_core_range(const char* faddr, size_t sz)
+{
+	size_t offset = faddr - g_core_image;
+
+	if (!g_core_image || faddr < g_core_image || sz == 0 || offset + sz > g_core_image_size)
+		return;
+	unpin_core_frames(find_core_frame(offset), find_core_frame(offset + sz - 1));
+}
+
+void prefetch_core_range(const char* faddr, size_t sz)
+{
+	size_t offset = faddr - g_core_image;
+	unsigned int first;
+	size_t nframes;
+
+	if (!g_core_image || faddr < g_core_image || sz == 0 || offset + sz > g_core_image_size)
+		return;
+	// more than the cache holds would evict what we just decompressed
+	if (sz > CORE_CACHE_MAX)
+		sz = CORE_CACHE_MAX;
+	first = find_core_frame(offset);
+	nframes = find_core_frame(offset + sz - 1) - first + 1;
+	CA_THREAD_POOL.parallel_for(nframes, [first](size_t i) {
+		if (pin_core_frame(first + i))
+			unpin_core_frames(first + i, first + i);
+	});
+}
+
+/***************************************************************************
+* Skeleton core
+*	gdb reads the ELF headers, section headers and notes from the core
+*	file itself, everything else of the core is read from the image.
+***************************************************************************/
+// Copy [offset, offset+sz) of the image to the same offset of the file
+static bool copy_core_range(int fd, size_t offset, size_t sz)
+{
+	const char* faddr = g_core_image + offset;
+	bool ok;
+
+	if (sz == 0)
+		return true;
+	if (offset > g_core_image_size || sz > g_core_image_size - offset)
+	{
+		CA_PRINT("Offset %ld of the core is out of range\n", (long)(offset + sz));
+		return false;
+	}
+	if (!pin_core_range(faddr, sz))
+		return false;
+	ok = pwrite(fd, faddr, sz, offset) == (ssize_t)sz;
+	unpin_core_range(faddr, sz);
+	return ok;
+}
+
+// Return a copy of [offset, offset+sz) of the image
+static bool read_core_range(size_t offset, size_t sz, std::vector<char>& buf)
+{
+	const char* faddr = g_core_image + offset;
+
+	if (offset > g_core_image_size || sz > g_core_image_size - offset
+		|| !pin_core_range(faddr, sz))
+		return false;
+	buf.assign(faddr, faddr + sz);
+	unpin_core_range(faddr, sz);
+	return true;
+}
+
+template <typename Ehdr, typename Phdr, typename Shdr>
+static bool write_elf_skeleton(int fd)
+{
+	std::vector<char> buf;
+	Ehdr ehdr;
+	size_t phnum, i;
+
+	if (!read_core_range(0, sizeof(ehdr), buf))
+		return false;
+	memcpy(&ehdr, buf.data(), sizeof(ehdr));
+	if (ehdr.e_type != ET_CORE || ehdr.e_phentsize != sizeof(Phdr))
+	{
+		CA_PRINT("The compressed file is not a core file\n");
+		return false;
+	}
+	if (!copy_core_range(fd, 0, sizeof(ehdr)))
+		return false;
+	// the real number of program headers is in the first section header
+	phnum = ehdr.e_phnum;
+	if (ehdr.e_shoff && ehdr.e_shnum > 0)
+	{
+		if (!copy_core_range(fd, ehdr.e_shoff, (size_t)ehdr.e_shnum * ehdr.e_shentsize))
+			return false;
+		if (phnum == PN_XNUM)
+		{
+			Shdr shdr;
+			if (!read_core_range(ehdr.e_shoff, sizeof(shdr), buf))
+				return false;
+			memcpy(&shdr, buf.data(), sizeof(shdr));
+			phnum = shdr.sh_info;
+		}
+	}
+	if (!read_core_range(ehdr.e_phoff, phnum * sizeof(Phdr), buf)
+		|| !copy_core_range(fd, ehdr.e_phoff, phnum * sizeof(Phdr)))
+		return false;
+	for (i = 0; i < phnum; i++)
+	{
+		Phdr phdr;
+		memcpy(&phdr, buf.data() + i * sizeof(Phdr), sizeof(phdr));
+		if (phdr.p_type != PT_LOAD && !copy_core_range(fd, phdr.p_offset, phdr.p_filesz))
+			return false;
+	}
+	return true;
+}
+
+bool write_core_skeleton(const char* fname)
+{
+	std::vector<char> ident;
+	int fd;
+	bool ok;
+
+	if (!g_core_image || !read_core_range(0, EI_NIDENT, ident)
+		|| memcmp(ident.data(), ELFMAG, SELFMAG) != 0)
+	{
+		CA_PRINT("The compressed file is not an ELF file\n");
+		return false;
+	}
+	fd = open(fname, O_WRONLY|O_CREAT|O_EXCL, 0600);
+	if (fd == -1)
+	{
+		CA_PRINT("Failed to create %s\n", fname);
+		return false;
+	}
+	// holes of a sparse file cost no disk space
+	ok = ftruncate(fd, g_core_image_size) == 0;
+	if (ok && ident[EI_CLASS] == ELFCLASS64)
+		ok = write_elf_skeleton<Elf64_Ehdr, Elf64_Phdr, Elf64_Shdr>(fd);
+	else if (ok)
+		ok = write_elf_skeleton<Elf32_Ehdr, Elf32_Phdr, Elf32_Shdr>(fd);
+	close(fd);
+	if (!ok)
+	{
+		CA_PRINT("Failed to write skeleton core %s\n", fname);
+		unlink(fname);
+	}
+	return ok;
+}
+
+#else
+
+bool open_compressed_core(const char*)
+{
+	return false;
+}
+
+void close_compressed_core(void)
+{
+}
+
+char* compressed_core_image(size_t* size)
+{
+	*size = 0;
+	return NULL;
+}
+
+bool write_core_skeleton(const char*)
+{
+	return false;
+}
+
+bool pin_core_range(const char*, size_t)
+{
+	return false;
+}
+
+void unpin_core_range(const char*, size_t)
+{
+}
+
+void prefetch_core_range(const char*, size_t)
+{
+}
+
+#endif
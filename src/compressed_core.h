@@ -0,0 +1,45 @@
+/*
+ * compressed_core.h
+ *		Access a zstd compressed core file without decompressing it
+ *		to disk. Frames are decompressed on demand into an image
+ *		which is addressed the same way as a mmapped core file.
+ *
+ *  Created on: Oct 17, 2026
+ */
+#ifndef COMPRESSED_CORE_H_
+#define COMPRESSED_CORE_H_
+
+#include <stddef.h>
+
+/*
+ * True if segments' m_faddr point into the image of a compressed core.
+ * Data in the image is valid only between pin_core_range() and
+ * unpin_core_range() of the range
+ */
+extern bool g_core_compressed;
+
+// Build the frame index of the file and reserve its image
+extern bool open_compressed_core(const char* fname);
+
+extern void close_compressed_core(void);
+
+// Base address and size of the decompressed image
+extern char* compressed_core_image(size_t* size);
+
+/*
+ * Write a skeleton of the opened compressed core to fname for the debugger
+ * to open, i.e. its ELF headers and notes, taken from the leading frames.
+ * The file has the size of the whole core, data of PT_LOAD segments are
+ * left as holes.
+ */
+extern bool write_core_skeleton(const char* fname);
+
+// Decompress the frames of the range if necessary and keep them in cache
+extern bool pin_core_range(const char* faddr, size_t sz);
+
+extern void unpin_core_range(const char* faddr, size_t sz);
+
+// Decompress the frames of the range in parallel
+extern void prefetch_core_range(const char* faddr, size_t sz);
+
+#endif /* COMPRESSED_CORE_H_ */
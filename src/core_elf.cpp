@@ -319,6 +319,8 @@ static bool BuildSegments(MmapFile& irCore)
 				}
 			}
 		}
+		// constant time lookup of address
+		build_segment_index();
 
 		done = true;
 	}
@@ -455,6 +457,8 @@ static bool BuildSegments_32(MmapFile& irCore)
 				}
 			}
 		}
+		// constant time lookup of address
+		build_segment_index();
 
 		done = true;
 	}
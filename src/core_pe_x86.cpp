@@ -680,6 +680,8 @@ static bool BuildSegments(MmapFile& irCore)
 			}
 		}
 	}
+	// constant time lookup of address
+	build_segment_index();
 
 	return true;
 }
@@ -706,7 +708,8 @@ NewSegment(address_t vaddr, size_t vsize, char* faddr, size_t fsize, int read, i
 	segment->m_read = read;
 	segment->m_write = write;
 	segment->m_exec = exec;
-	segment->m_ptr_bitvec = NULL;
+	segment->m_ptr_bitmap = NULL;
+	segment->m_page_bitvec = NULL;
 	segment->m_module_name = NULL;
 
 	return segment;
@@ -11,6 +11,7 @@
 #include "ref.h"
 #include "segment.h"
 #include "search.h"
+#include "ref_index.h"
 #include "x_type.h"
 #include <vector>
 #include <sstream>
@@ -309,6 +310,9 @@ bool ref_command_impl(char* args)
 
 	int rc;
 	bool threadref = false;
+	char* batch_file = NULL;
+	bool index = false;
+	char* index_arg = NULL;
 	address_t addr = 0;
 	size_t size  = 0;
 	size_t level = 0;
@@ -325,6 +329,21 @@ bool ref_command_impl(char* args)
 			char* option = options[i];
 			if (strcmp(option, "/thread") == 0 || strcmp(option, "/t") == 0)
 				threadref = true;
+			else if (strcmp(option, "/batch") == 0 || strcmp(option, "/b") == 0)
+			{
+				if (i + 1 >= num_options)
+				{
+					CA_PRINT("Missing file name of object addresses\n");
+					return false;
+				}
+				batch_file = options[++i];
+			}
+			else if (strcmp(option, "/index") == 0 || strcmp(option, "/i") == 0)
+			{
+				index = true;
+				if (i + 1 < num_options)
+					index_arg = options[++i];
+			}
 			else if (addr == 0)
 			{
 				addr = ca_eval_address (option);
@@ -360,6 +379,41 @@ bool ref_command_impl(char* args)
 		}
 	}
 
+	if (index)
+	{
+		if (addr || threadref || batch_file)
+		{
+			CA_PRINT("Option /index takes a file name or \"off\" only\n");
+			return false;
+		}
+		if (index_arg && strcmp(index_arg, "off") == 0)
+		{
+			release_ref_index();
+			CA_PRINT("Reference index is dropped\n");
+		}
+		// reuse the index saved by a previous session of the same core
+		else if (index_arg)
+		{
+			if (!load_ref_index(index_arg) && build_ref_index())
+				save_ref_index(index_arg);
+		}
+		else
+			build_ref_index();
+		return true;
+	}
+
+	if (batch_file)
+	{
+		if (addr || threadref)
+		{
+			CA_PRINT("Option /batch takes a file name only\n");
+			return false;
+		}
+		if (!find_object_refs_batch(batch_file))
+			CA_PRINT("No result found\n");
+		return true;
+	}
+
 	if (addr == 0)
 	{
 		CA_PRINT("Missing object address.");
@@ -526,19 +580,32 @@ bool pattern_command_impl(char* args)
 	ENSURE_CA_HEAP();
 
 	address_t lo = 0, hi = 0;
+	bool summary = false;
 	// Parse user input options
-	// argument is in the form of <start> <end>
+	// argument is in the form of [/summary] <start> <end>
 	if (args)
 	{
 		char* options[MAX_NUM_OPTIONS];
+		char* range[2];
 		int num_options = ca_parse_options(args, options);
-		if (num_options != 2)
+		int i, num_range = 0;
+		for (i = 0; i < num_options; i++)
 		{
-			CA_PRINT("Expect arguments: <start> <end>\n");
+			char* option = options[i];
+			if (strcmp(option, "/summary") == 0 || strcmp(option, "/s") == 0)
+				summary = true;
+			else if (num_range < 2)
+				range[num_range++] = option;
+			else
+				num_range++;
+		}
+		if (num_range != 2)
+		{
+			CA_PRINT("Expect arguments: [/summary] <start> <end>\n");
 			return false;
 		}
-		lo = ca_eval_address (options[0]);
-		hi = ca_eval_address (options[1]);
+		lo = ca_eval_address (range[0]);
+		hi = ca_eval_address (range[1]);
 		if (hi <= lo)
 		{
 			CA_PRINT("Invalid memory address range (start >= end)\n");
@@ -551,6 +618,8 @@ bool pattern_command_impl(char* args)
 		return false;
 	}
 
+	if (summary)
+		return summarize_memory_pattern(lo, hi);
 	print_memory_pattern(lo, hi);
 
 	return true;
@@ -980,6 +1049,15 @@ bool biggest_heap_owners_generic(unsigned int num, bool all_reachable_blocks)
 	}
 
 	// Print the result
+	{
+		std::vector<struct object_reference*> owner_refs;
+		for (i = 0; i < num; i++)
+		{
+			if (owners[i].aggr_size)
+				owner_refs.push_back(&owners[i].ref);
+		}
+		symbolize_refs(owner_refs);
+	}
 	for (i = 0; i < num; i++)
 	{
 		struct heap_owner *owner = &owners[i];
@@ -1169,9 +1247,11 @@ calc_aggregate_size(const struct object_reference *ref,
 {
 	address_t addr, cursor, end;
 	size_t ptr_sz = g_ptr_bit >> 3;
+	size_t step;
 	size_t aggr_size = 0;
 	unsigned long aggr_count = 0;
 	struct reachable_block *blk;
+	struct ca_memory_view view;
 	size_t bitmap_sz = ((inuse_blocks.size() + 15) * 2 / 32) * sizeof(unsigned int);
 
 	static unsigned int* qv_bitmap = NULL;	// Bit flags of whether a block is queued/visited
@@ -1255,28 +1335,34 @@ calc_aggregate_size(const struct object_reference *ref,
 	}
 
 	// We now have a range of memory to search
-	cursor = ALIGN(cursor, ptr_sz);
-	while (cursor < end)
+	// unreadable words are skipped, a view resumes after each of them
+	for (cursor = ALIGN(cursor, ptr_sz); cursor < end; cursor += step)
 	{
-		if(!read_memory_wrapper(NULL, cursor, (void*)&addr, ptr_sz))
-			break;
-		blk = find_reachable_block(addr, inuse_blocks);
-		if (blk && !is_queued_or_visited(qv_bitmap, blk - &inuse_blocks[0]))
+		size_t offset;
+		step = ptr_sz;
+		if (!get_memory_view(cursor, ALIGN(end - cursor, ptr_sz), &view))
+			continue;
+		step = view.m_size;
+		for (offset = 0; offset + ptr_sz <= view.m_size; offset += ptr_sz)
 		{
-			if (all_reachable_blocks)
+			addr = view.ptr_at(offset, ptr_sz);
+			blk = find_reachable_block(addr, inuse_blocks);
+			if (blk && !is_queued_or_visited(qv_bitmap, blk - &inuse_blocks[0]))
 			{
-				unsigned long sub_count = 0;
-				aggr_size += heap_aggregate_size(blk, inuse_blocks, qv_bitmap, &sub_count);
-				aggr_count += sub_count;
-			}
-			else
-			{
-				aggr_size += blk->size;
-				aggr_count++;
-				set_visited(qv_bitmap, blk - &inuse_blocks[0]);
+				if (all_reachable_blocks)
+				{
+					unsigned long sub_count = 0;
+					aggr_size += heap_aggregate_size(blk, inuse_blocks, qv_bitmap, &sub_count);
+					aggr_count += sub_count;
+				}
+				else
+				{
+					aggr_size += blk->size;
+					aggr_count++;
+					set_visited(qv_bitmap, blk - &inuse_blocks[0]);
+				}
 			}
 		}
-		cursor += ptr_sz;
 	}
 
 	// can we cache the result?
@@ -1320,7 +1406,9 @@ set_obj_reference(struct object_type *obj_type,
 {
 	address_t addr, cursor, end;
 	size_t ptr_sz = g_ptr_bit >> 3;
+	size_t step;
 	struct reachable_block *blk;
+	struct ca_memory_view view;
 
 	// Input is a pointer to an in-use memory block
 	if (obj_type->storage_type == ENUM_REGISTER || obj_type->storage_type == ENUM_HEAP)
@@ -1345,25 +1433,29 @@ set_obj_reference(struct object_type *obj_type,
 	}
 
 	// We now have a range of memory to search
-	cursor = ALIGN(cursor, ptr_sz);
-	for (; cursor < end; cursor += ptr_sz)
+	// unreadable words are skipped, a view resumes after each of them
+	for (cursor = ALIGN(cursor, ptr_sz); cursor < end; cursor += step)
 	{
-		if(!read_memory_wrapper(NULL, cursor, (void*)&addr, ptr_sz))
-        {
-            continue;
-        }
-		blk = find_reachable_block(addr, inuse_blocks);
-		if (blk)
+		step = ptr_sz;
+		if (!get_memory_view(cursor, ALIGN(end - cursor, ptr_sz), &view))
+			continue;
+		step = view.m_size;
+		for (size_t offset = 0; offset + ptr_sz <= view.m_size; offset += ptr_sz)
 		{
-            int index = (blk - &inuse_blocks[0]);
-            if (index < 0 || index > obj_types.size())
-            {
-                CA_PRINT("Out of array range.");
-                continue;
-            }
-            object_type* ref_obj = &obj_types[index];
-            obj_type->referenced_list.push_back(ref_obj);
-            ref_obj->referenced_by.push_back(obj_type);
+			addr = view.ptr_at(offset, ptr_sz);
+			blk = find_reachable_block(addr, inuse_blocks);
+			if (blk)
+			{
+				int index = (blk - &inuse_blocks[0]);
+				if (index < 0 || index > obj_types.size())
+				{
+					CA_PRINT("Out of array range.");
+					continue;
+				}
+				object_type* ref_obj = &obj_types[index];
+				obj_type->referenced_list.push_back(ref_obj);
+				ref_obj->referenced_by.push_back(obj_type);
+			}
 		}
 	}
 
@@ -1680,6 +1772,8 @@ mark_blocks_referenced_by_globals_locals(std::vector<struct reachable_block>& bl
 {
 	unsigned int seg_index;
 	size_t ptr_sz = g_ptr_bit >> 3;
+	size_t step;
+	struct ca_memory_view view;
 
 	for (seg_index = 0; seg_index < g_segment_count; seg_index++)
 	{
@@ -1713,21 +1807,41 @@ mark_blocks_referenced_by_globals_locals(std::vector<struct reachable_block>& bl
 			}
 
 			next = ALIGN(start, ptr_sz);
-			while (next + ptr_sz <= end)
+			// populated pages are known with the bit vector
+			if (segment->m_page_bitvec && !segment->m_bitvec_ready)
+				set_addressable_bit_vec(segment);
+			// unreadable words are skipped, a view resumes after each of them
+			for (; next + ptr_sz <= end; next += step)
 			{
-				address_t ptr;
-				struct reachable_block* blk;
-
-				if (!read_memory_wrapper(segment, next, &ptr, ptr_sz))
-					break;
-
-				blk = find_reachable_block(ptr, blocks);
-				if (blk)
+				size_t base = next - segment->m_vaddr;
+				size_t offset = 0;
+
+				step = ptr_sz;
+				if (!get_memory_view(next, end - next, &view))
+					continue;
+				step = view.m_size;
+				while (offset + ptr_sz <= view.m_size)
 				{
-					unsigned long index = blk - &blocks[0];
-					set_queued_and_visited(qv_bitmap, index);
+					// skip file holes and pages of zeros wholesale
+					size_t run_end;
+					offset = next_populated_offset(segment, base + offset) - base;
+					run_end = next_unpopulated_offset(segment, base + offset) - base;
+					if (run_end > view.m_size)
+						run_end = view.m_size;
+					for (; offset + ptr_sz <= run_end; offset += ptr_sz)
+					{
+						struct reachable_block* blk;
+
+						blk = find_reachable_block(view.ptr_at(offset, ptr_sz), blocks);
+						if (blk)
+						{
+							unsigned long index = blk - &blocks[0];
+							set_queued_and_visited(qv_bitmap, index);
+						}
+					}
+					if (offset < run_end)
+						break;
 				}
-				next += ptr_sz;
 			}
 		}
 	}
@@ -1816,48 +1930,56 @@ static bool build_block_index_map(struct reachable_block* blk,
 		unsigned int max_sub_blocks, total_sub_blocks;
 		unsigned int* index_buf = NULL;
 		unsigned int i, index;
+		struct ca_memory_view view;
+		size_t offset, step;
 
 		// Queue possible pointers to heap memory contained by this block
 		start = ALIGN(blk->addr, ptr_sz);
 		end   = start + blk->size;
-		cursor = start;
 
 		max_sub_blocks = (end - start) / ptr_sz;
 		total_sub_blocks = 0;
 		index_buf = get_index_map_buffer(max_sub_blocks + 1);	// one for terminator
-		while (cursor < end)
+		// unreadable words are skipped, a view resumes after each of them
+		for (cursor = start; cursor < end; cursor += step)
 		{
-			address_t ptr;
-			struct reachable_block *sub_blk;
-			if (read_memory_wrapper(NULL, cursor, (void*)&ptr, ptr_sz) && ptr)
+			step = ptr_sz;
+			if (!get_memory_view(cursor, end - cursor, &view))
+				continue;
+			step = view.m_size;
+			for (offset = 0; offset + ptr_sz <= view.m_size; offset += ptr_sz)
 			{
-				sub_blk = find_reachable_block(ptr, blocks);
-				if (sub_blk)
+				address_t ptr = view.ptr_at(offset, ptr_sz);
+				struct reachable_block *sub_blk;
+				if (ptr)
 				{
-					bool found_dup = false;
-					// avoid duplicate, which is not uncommon
-					// FIXME, consider non-linear search
-					index = sub_blk - &blocks[0];
-					for (i = 0; i < total_sub_blocks; i++)
+					sub_blk = find_reachable_block(ptr, blocks);
+					if (sub_blk)
 					{
-						if (index_buf[i] == index)
+						bool found_dup = false;
+						// avoid duplicate, which is not uncommon
+						// FIXME, consider non-linear search
+						index = sub_blk - &blocks[0];
+						for (i = 0; i < total_sub_blocks; i++)
 						{
-							found_dup = true;
-							break;
+							if (index_buf[i] == index)
+							{
+								found_dup = true;
+								break;
+							}
 						}
-					}
-					if (!found_dup)
-					{
-						index_buf[total_sub_blocks++] = index;
-						if (total_sub_blocks == UINT_MAX)
+						if (!found_dup)
 						{
-							CA_PRINT("Internal fatal error: number of sub blocks exceeds 4 billion\n");
-							return false;
+							index_buf[total_sub_blocks++] = index;
+							if (total_sub_blocks == UINT_MAX)
+							{
+								CA_PRINT("Internal fatal error: number of sub blocks exceeds 4 billion\n");
+								return false;
+							}
 						}
 					}
 				}
 			}
-			cursor += ptr_sz;
 		}
 		// allocate cache to hold the indexes of this block
 		index_buf[total_sub_blocks++] = UINT_MAX;	// this value serves as terminator
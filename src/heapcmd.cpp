@@ -9,6 +9,8 @@
 #include "segment.h"
 #include "search.h"
 #include "decode.h"
+#include "compressed_core.h"
+#include <unistd.h>
 
 /***************************************************************************
 * gdb commands
@@ -121,6 +123,17 @@ assign_command (const char *args, int from_tty)
 			CA_PRINT("Expect arguments: <address> <value>\n");
 			return;
 		}
+		// replay or keep a set of patches
+		if (strcmp(options[0], "/save") == 0)
+		{
+			save_set_values (options[1]);
+			return;
+		}
+		else if (strcmp(options[0], "/load") == 0)
+		{
+			load_set_values (options[1]);
+			return;
+		}
 		addr = parse_and_eval_address (options[0]);
 		value = parse_and_eval_address (options[1]);
 		set_value (addr, value);
@@ -227,12 +240,22 @@ obj_command (const char *args, int from_tty)
 	const char *expr = NULL;
 	bool search_ref = false;
 	bool obj_stats = false;
+	bool obj_census = false;
+	size_t max_count = 0;
 	for (int i = 0; i < num_options; i++) {
 		char* option = options[i];
 		if (strcmp(option, "/ref") == 0 || strcmp(option, "/r") == 0) {
 			search_ref = true;
 		} else if (strcmp(option, "/stats") == 0 || strcmp(option, "/s") == 0) {
 			obj_stats = true;
+		} else if (strcmp(option, "/census") == 0 || strcmp(option, "/c") == 0) {
+			obj_census = true;
+		} else if (strcmp(option, "/limit") == 0 || strcmp(option, "/l") == 0) {
+			if (i + 1 >= num_options || (max_count = ca_eval_address(options[i + 1])) == 0) {
+				CA_PRINT("option /limit needs the number of objects\n");
+				return;
+			}
+			i++;
 		} else if (option[0] == '/') {
 			CA_PRINT("invalid option\n");
 			return;
@@ -243,10 +266,14 @@ obj_command (const char *args, int from_tty)
 			expr = option;
 		}
 	}
-	if (obj_stats) {
+	if (obj_census) {
+		census_cplusplus_objects();
+	} else if (obj_stats) {
 		display_object_stats();
+	} else if (!expr) {
+		CA_PRINT("Missing type or variable name\n");
 	} else {
-		search_cplusplus_objects_and_references(expr, search_ref, false);
+		search_cplusplus_objects_and_references(expr, search_ref, false, max_count);
 	}
 }
 
@@ -270,6 +297,16 @@ max_indirection_level_command (const char *args, int from_tty)
 	set_max_indirection_level(level);
 }
 
+static void
+bitmap_budget_command (const char *args, int from_tty)
+{
+	size_t mb = 0;
+	if (args)
+		mb = parse_and_eval_address (args);
+
+	set_bit_vec_budget(mb);
+}
+
 #define IS_BLANK(c) ((c)==' ' || (c)=='\t')
 
 static void
@@ -333,6 +370,8 @@ static char ca_help_msg[] = "Commands of core_analyzer " CA_VERSION_STRING "\n"
 	"   unset/unassign -- Undo the pseudo value at address.\n"
 	"   shrobj_level -- Set/Show the indirection level of shared-object search.\n"
 	"   max_indirection_level -- Set/Show the maximum levels of indirection\n"
+	"   zcore   -- Open a zstd compressed core file.\n"
+	"   bitmap_budget -- Set/Show the memory budget (MB) of pointer bitmaps\n"
 	"type 'help <command>' to get more detail and usage info\n";
 
 static void
@@ -341,6 +380,34 @@ display_help_command (const char *args, int from_tty)
     CA_PRINT("%s", ca_help_msg);
 }
 
+/*
+ * Open <core>.zst, the core is a skeleton written from its leading frames
+ * unless it exists already. Memory of the core is read from <core>.zst.
+ */
+static void
+zcore_command (const char *args, int from_tty)
+{
+#ifdef HAVE_LIBZSTD
+	size_t len = args ? strlen(args) : 0;
+
+	if (len <= 4 || strcmp(args + len - 4, ".zst") != 0)
+	{
+		CA_PRINT("Please provide a zstd compressed core file <core>.zst\n");
+		return;
+	}
+	std::string fname(args, len - 4);
+	if (access(fname.c_str(), F_OK) != 0)
+	{
+		if (!open_compressed_core(args) || !write_core_skeleton(fname.c_str()))
+			return;
+		CA_PRINT("Skeleton core %s is written from %s\n", fname.c_str(), args);
+	}
+	core_file_command(fname.c_str(), from_tty);
+#else
+	CA_PRINT("zstd compressed core files are not supported, core_analyzer is built without libzstd\n");
+#endif
+}
+
 static void
 switch_heap_command(const char *args, int from_tty)
 {
@@ -387,13 +454,22 @@ _initialize_heapcmd ()
 		"           Search all references to the object starting at input address\n"
 		"           parameter [size] specifies the object size\n"
 		"           optional parameter [level] limits the levels of indirect reference, which is one by default\n"
-		"           option [/thread] limits search to thread contexts only\n"),
+		"           option [/thread] limits search to thread contexts only\n"
+		"   ref [/batch or /b] <file>\n"
+		"           Search references to all objects listed in the file with one pass of memory\n"
+		"           each line of the file has an object address and optional size\n"
+		"   ref [/index or /i] [file|off]\n"
+		"           Index all pointers of the core file so that later searches are lookups\n"
+		"           the index is loaded from [file] if it is saved for the same core, otherwise built and saved to it\n"),
 		&cmdlist);
 
 	add_cmd("obj", class_info, obj_command, _("Search for objects that matches the type of the input expression.\n"
 		"Usage:\n"
-		"   obj <type|variable>\n"
-		"           Extended function of Windbg \"s -v <Range> <Object>\" command; Search for object and reference to C++ object of the same type as the input expression\n"),
+		"   obj [/limit or /l <n>] <type|variable>\n"
+		"           Extended function of Windbg \"s -v <Range> <Object>\" command; Search for object and reference to C++ object of the same type as the input expression\n"
+		"           option [/limit] stops the search after <n> objects are found\n"
+		"   obj [/census or /c]\n"
+		"           Count in-use heap blocks by the class of their vtable, and list classes by total bytes\n"),
 		//"   obj [/ref or /r] <type|variable>\n"
 		//"           Search references to all instances of the specified class\n"
 		//"   obj [/stats or /s]\n"
@@ -433,7 +509,10 @@ _initialize_heapcmd ()
 	add_cmd("pattern", class_info, pattern_command, _("Reveal memory pattern\n"
 		"Usage:\n"
 		"   pattern <start> <end>\n"
-		"           Display the data pattern within the given address range\n"),
+		"           Display the data pattern within the given address range\n"
+		"   pattern [/summary or /s] <start> <end>\n"
+		"           Count words of the range by pointers to heap/stack/global/text, zeros\n"
+		"           and strings, and display the most referenced heap blocks and types\n"),
 		&cmdlist);
 
 	add_cmd("segment", class_info, segment_command, _("Display memory segment(s)\n"
@@ -456,7 +535,8 @@ _initialize_heapcmd ()
 	// Settings
 	add_cmd("shrobj_level", class_info, shrobj_level_command, _("Set/Show the indirection level of shared-object search"), &cmdlist);
 	add_cmd("max_indirection_level", class_info, max_indirection_level_command, _("Set/Show the maximum indirection level of reference search"), &cmdlist);
-	add_cmd("assign", class_info, assign_command, _("Pretend the memory data is the given value\nassign [addr] [value]"), &cmdlist);
+	add_cmd("bitmap_budget", class_info, bitmap_budget_command, _("Set/Show the memory budget of pointer bitmaps in MB\nbitmap_budget [MB]"), &cmdlist);
+	add_cmd("assign", class_info, assign_command, _("Pretend the memory data is the given value\nassign [addr] [value]\nassign /save <file>\nassign /load <file>"), &cmdlist);
 	add_cmd("unassign", class_info, unassign_command, _("Remove the fake value at the given address\nunassign <addr>"), &cmdlist);
 	add_cmd("include_free", class_info, include_free_command, _("Reference search includes free heap memory blocks"), &cmdlist);
 	add_cmd("ignore_free", class_info, ignore_free_command, _("Reference search excludes free heap memory blocks (default)"), &cmdlist);
@@ -466,6 +546,9 @@ _initialize_heapcmd ()
 	// Misc
 	add_cmd("ca_help", class_info, display_help_command, _("Display core analyzer help"), &cmdlist);
 	add_cmd("switch_heap", class_info, switch_heap_command, _("switch another heap like pt, tc,"), &cmdlist);
+	add_cmd("zcore", class_files, zcore_command, _("Open a zstd compressed core file\nzcore <core>.zst\n"
+		"A skeleton <core> with headers and notes is written from <core>.zst if it doesn't exist,\n"
+		"memory of the core is read from <core>.zst"), &cmdlist);
 
 	add_cmd("dt", class_info, dt_command, _("Display type (windbg style)\n"
 		"Usage:\n"
@@ -0,0 +1,372 @@
+/*
+ * ptr_bitmap.cpp
+ *		Compressed bit vector of pointers in a segment
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <algorithm>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "ptr_bitmap.h"
+
+enum ptr_chunk_type
+{
+	PTR_CHUNK_EMPTY = 0,
+	PTR_CHUNK_ARRAY,	// sorted offsets of set bits
+	PTR_CHUNK_RUNS,		// sorted pairs of the first and last offsets of runs
+	PTR_CHUNK_DENSE		// plain bitmap
+};
+
+struct ptr_chunk
+{
+	unsigned short m_type;
+	unsigned short m_count;	// offsets of an array, or runs
+	void* m_data;
+};
+
+static std::atomic<size_t> g_ptr_bitmap_bytes(0);
+
+#ifdef _MSC_VER
+static inline unsigned int ca_ctz(unsigned int v)
+{
+	unsigned long i;
+	_BitScanForward(&i, v);
+	return i;
+}
+static inline unsigned int ca_ctz(unsigned long long v)
+{
+	unsigned long i;
+	if (_BitScanForward(&i, (unsigned long)v))
+		return i;
+	_BitScanForward(&i, (unsigned long)(v >> 32));
+	return i + 32;
+}
+static inline unsigned int ca_popcount(unsigned int v)
+{
+	return __popcnt(v);
+}
+#else
+static inline unsigned int ca_ctz(unsigned int v)
+{
+	return __builtin_ctz(v);
+}
+static inline unsigned int ca_ctz(unsigned long long v)
+{
+	return __builtin_ctzll(v);
+}
+static inline unsigned int ca_popcount(unsigned int v)
+{
+	return __builtin_popcount(v);
+}
+#endif
+
+// The first set (or clear if invert is true) bit at or after i, nbits if none
+template <typename T>
+static size_t
+next_dense_bit(const T* bits, size_t nbits, size_t i, bool invert)
+{
+	const size_t word_bits = sizeof(T) * 8;
+	while (i < nbits)
+	{
+		T word = invert ? ~bits[i / word_bits] : bits[i / word_bits];
+		word &= ~(T)0 << (i % word_bits);
+		if (word)
+		{
+			i = i - i % word_bits + ca_ctz(word);
+			return i < nbits ? i : nbits;
+		}
+		i = i - i % word_bits + word_bits;
+	}
+	return nbits;
+}
+
+static size_t chunk_bytes(const struct ptr_chunk* chunk, size_t chunk_bits)
+{
+	switch (chunk->m_type)
+	{
+	case PTR_CHUNK_ARRAY:
+		return chunk->m_count * sizeof(unsigned short);
+	case PTR_CHUNK_RUNS:
+		return chunk->m_count * 2 * sizeof(unsigned short);
+	case PTR_CHUNK_DENSE:
+		return chunk_bits >> 3;
+	default:
+		return 0;
+	}
+}
+
+static void release_chunk(struct ptr_chunk* chunk, size_t chunk_bits)
+{
+	if (chunk->m_type != PTR_CHUNK_EMPTY)
+	{
+		g_ptr_bitmap_bytes -= chunk_bytes(chunk, chunk_bits);
+		free(chunk->m_data);
+	}
+	chunk->m_type = PTR_CHUNK_EMPTY;
+	chunk->m_count = 0;
+	chunk->m_data = NULL;
+}
+
+struct ptr_bitmap* new_ptr_bitmap(size_t nbits, size_t chunk_bits)
+{
+	struct ptr_bitmap* bitmap = (struct ptr_bitmap*) malloc(sizeof(struct ptr_bitmap));
+	if (!bitmap)
+		return NULL;
+	bitmap->m_nbits = nbits;
+	bitmap->m_chunk_bits = chunk_bits;
+	bitmap->m_nchunks = (nbits + chunk_bits - 1) / chunk_bits;
+	bitmap->m_chunks = (struct ptr_chunk*) calloc(bitmap->m_nchunks ? bitmap->m_nchunks : 1, sizeof(struct ptr_chunk));
+	if (!bitmap->m_chunks)
+	{
+		free(bitmap);
+		return NULL;
+	}
+	bitmap->m_last_use = 0;
+	bitmap->m_evicted = false;
+	return bitmap;
+}
+
+void clear_ptr_bitmap(struct ptr_bitmap* bitmap)
+{
+	size_t i;
+	for (i = 0; i < bitmap->m_nchunks; i++)
+		release_chunk(&bitmap->m_chunks[i], bitmap->m_chunk_bits);
+}
+
+void free_ptr_bitmap(struct ptr_bitmap* bitmap)
+{
+	if (!bitmap)
+		return;
+	clear_ptr_bitmap(bitmap);
+	free(bitmap->m_chunks);
+	free(bitmap);
+}
+
+void set_ptr_bitmap_chunk(struct ptr_bitmap* bitmap, size_t chunk_index, const unsigned int* bits)
+{
+	struct ptr_chunk* chunk = &bitmap->m_chunks[chunk_index];
+	size_t nbits = bitmap->m_chunk_bits;
+	size_t nwords = nbits >> 5;
+	size_t count = 0, nruns = 0, i;
+	unsigned int carry = 0;
+	unsigned short* data;
+
+	release_chunk(chunk, nbits);
+	// a run starts at a set bit whose previous bit is clear
+	for (i = 0; i < nwords; i++)
+	{
+		unsigned int word = bits[i];
+		count += ca_popcount(word);
+		nruns += ca_popcount(word & ~((word << 1) | carry));
+		carry = word >> 31;
+	}
+	if (count == 0)
+		return;
+
+	// pick the smallest container
+	if (count * sizeof(unsigned short) <= (nbits >> 3) && count <= nruns * 2)
+	{
+		data = (unsigned short*) malloc(count * sizeof(unsigned short));
+		if (!data)
+			return;
+		count = 0;
+		for (i = next_dense_bit(bits, nbits, 0, false); i < nbits; i = next_dense_bit(bits, nbits, i + 1, false))
+			data[count++] = (unsigned short) i;
+		chunk->m_type = PTR_CHUNK_ARRAY;
+		chunk->m_count = (unsigned short) count;
+		chunk->m_data = data;
+	}
+	else if (nruns * 2 * sizeof(unsigned short) < (nbits >> 3))
+	{
+		data = (unsigned short*) malloc(nruns * 2 * sizeof(unsigned short));
+		if (!data)
+			return;
+		nruns = 0;
+		for (i = next_dense_bit(bits, nbits, 0, false); i < nbits; )
+		{
+			size_t end = next_dense_bit(bits, nbits, i, true);
+			data[nruns * 2] = (unsigned short) i;
+			data[nruns * 2 + 1] = (unsigned short) (end - 1);
+			nruns++;
+			i = next_dense_bit(bits, nbits, end, false);
+		}
+		chunk->m_type = PTR_CHUNK_RUNS;
+		chunk->m_count = (unsigned short) nruns;
+		chunk->m_data = data;
+	}
+	else
+	{
+		// dense bits are kept in 64-bit words
+		unsigned long long* words = (unsigned long long*) malloc(nbits >> 3);
+		if (!words)
+			return;
+		for (i = 0; i < nwords; i += 2)
+			words[i >> 1] = bits[i] | ((unsigned long long)bits[i + 1] << 32);
+		chunk->m_type = PTR_CHUNK_DENSE;
+		chunk->m_data = words;
+	}
+	g_ptr_bitmap_bytes += chunk_bytes(chunk, nbits);
+}
+
+// The first set bit at or after offset of the chunk, chunk_bits if none
+static size_t
+next_chunk_bit(const struct ptr_chunk* chunk, size_t chunk_bits, size_t offset)
+{
+	const unsigned short* data = (const unsigned short*) chunk->m_data;
+	const unsigned short* itr;
+
+	switch (chunk->m_type)
+	{
+	case PTR_CHUNK_ARRAY:
+		itr = std::lower_bound(data, data + chunk->m_count, offset);
+		return itr < data + chunk->m_count ? *itr : chunk_bits;
+	case PTR_CHUNK_RUNS:
+	{
+		// the first run whose last bit is not before offset
+		size_t lo = 0, hi = chunk->m_count;
+		while (lo < hi)
+		{
+			size_t mid = (lo + hi) / 2;
+			if (data[mid * 2 + 1] < offset)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		if (lo == chunk->m_count)
+			return chunk_bits;
+		return data[lo * 2] > offset ? data[lo * 2] : offset;
+	}
+	case PTR_CHUNK_DENSE:
+		return next_dense_bit((const unsigned long long*) chunk->m_data, chunk_bits, offset, false);
+	default:
+		return chunk_bits;
+	}
+}
+
+// Collect set bits of the chunk in [offset, limit) into out, up to count
+static size_t
+gather_chunk_bits(const struct ptr_chunk* chunk, size_t chunk_start, size_t offset,
+		size_t limit, size_t* out, size_t count)
+{
+	const unsigned short* data = (const unsigned short*) chunk->m_data;
+	size_t n = 0;
+
+	switch (chunk->m_type)
+	{
+	case PTR_CHUNK_ARRAY:
+	{
+		const unsigned short* itr = std::lower_bound(data, data + chunk->m_count, offset);
+		for (; itr < data + chunk->m_count && *itr < limit && n < count; itr++)
+			out[n++] = chunk_start + *itr;
+		break;
+	}
+	case PTR_CHUNK_RUNS:
+	{
+		size_t lo = 0, hi = chunk->m_count;
+		while (lo < hi)
+		{
+			size_t mid = (lo + hi) / 2;
+			if (data[mid * 2 + 1] < offset)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		for (; lo < chunk->m_count && n < count; lo++)
+		{
+			size_t bit = data[lo * 2] > offset ? data[lo * 2] : offset;
+			for (; bit <= data[lo * 2 + 1] && bit < limit && n < count; bit++)
+				out[n++] = chunk_start + bit;
+			if (bit >= limit)
+				break;
+		}
+		break;
+	}
+	case PTR_CHUNK_DENSE:
+	{
+		// walk set bits a word at a time, clearing the lowest one
+		const unsigned long long* words = (const unsigned long long*) chunk->m_data;
+		size_t w = offset >> 6;
+		unsigned long long word = words[w] & (~0ull << (offset & 0x3f));
+		while (n < count)
+		{
+			while (word)
+			{
+				size_t bit = (w << 6) + ca_ctz(word);
+				if (bit >= limit || n >= count)
+					return n;
+				out[n++] = chunk_start + bit;
+				word &= word - 1;
+			}
+			if (++w >= (limit + 63) >> 6)
+				break;
+			word = words[w];
+		}
+		break;
+	}
+	default:
+		break;
+	}
+	return n;
+}
+
+size_t next_ptr_bit(const struct ptr_bitmap* bitmap, size_t bit_index, size_t max_index)
+{
+	size_t chunk_bits = bitmap->m_chunk_bits;
+	size_t chunk_index = bit_index / chunk_bits;
+
+	if (max_index > bitmap->m_nbits)
+		max_index = bitmap->m_nbits;
+	while (bit_index < max_index)
+	{
+		const struct ptr_chunk* chunk = &bitmap->m_chunks[chunk_index];
+		size_t chunk_start = chunk_index * chunk_bits;
+		size_t offset = next_chunk_bit(chunk, chunk_bits, bit_index - chunk_start);
+		if (offset < chunk_bits)
+			return chunk_start + offset < max_index ? chunk_start + offset : max_index;
+		chunk_index++;
+		bit_index = chunk_index * chunk_bits;
+	}
+	return max_index;
+}
+
+size_t gather_ptr_bits(const struct ptr_bitmap* bitmap, size_t* bit_index, size_t max_index,
+		size_t* out, size_t count)
+{
+	size_t chunk_bits = bitmap->m_chunk_bits;
+	size_t i = *bit_index;
+	size_t n = 0;
+
+	if (max_index > bitmap->m_nbits)
+		max_index = bitmap->m_nbits;
+	while (i < max_index && n < count)
+	{
+		size_t chunk_index = i / chunk_bits;
+		size_t chunk_start = chunk_index * chunk_bits;
+		size_t chunk_end = chunk_start + chunk_bits < max_index ? chunk_start + chunk_bits : max_index;
+
+		n += gather_chunk_bits(&bitmap->m_chunks[chunk_index], chunk_start, i - chunk_start,
+				chunk_end - chunk_start, out + n, count - n);
+		i = chunk_end;
+	}
+	// resume after the last collected bit if out is full
+	*bit_index = n == count ? out[n - 1] + 1 : i;
+	return n;
+}
+
+size_t ptr_bitmap_bytes(const struct ptr_bitmap* bitmap)
+{
+	size_t bytes = 0, i;
+	for (i = 0; i < bitmap->m_nchunks; i++)
+		bytes += chunk_bytes(&bitmap->m_chunks[i], bitmap->m_chunk_bits);
+	return bytes;
+}
+
+size_t ptr_bitmap_total_bytes(void)
+{
+	return g_ptr_bitmap_bytes;
+}
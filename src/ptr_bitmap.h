@@ -0,0 +1,61 @@
+/*
+ * ptr_bitmap.h
+ *		Compressed bit vector of pointers in a segment
+ *
+ *  Created on: Oct 17, 2026
+ */
+#ifndef PTR_BITMAP_H_
+#define PTR_BITMAP_H_
+
+#include <stddef.h>
+
+// Bytes of segment data covered by one container
+#define PTR_BITMAP_CHUNK_SZ (64*1024)
+
+/*
+ * Each chunk of bits has its own container, whichever is the smallest of
+ *   a sorted array of bit offsets, an array of runs, or a dense bitmap.
+ * Containers of different chunks may be set by different threads.
+ */
+struct ptr_chunk;
+
+struct ptr_bitmap
+{
+	size_t m_nbits;
+	size_t m_chunk_bits;	// bits of a chunk, multiple of 64
+	size_t m_nchunks;
+	struct ptr_chunk* m_chunks;
+	// maintained by the owner
+	unsigned long m_last_use;
+	bool m_evicted;
+};
+
+extern struct ptr_bitmap* new_ptr_bitmap(size_t nbits, size_t chunk_bits);
+
+extern void free_ptr_bitmap(struct ptr_bitmap* bitmap);
+
+// Release all containers, all bits are clear afterwards
+extern void clear_ptr_bitmap(struct ptr_bitmap* bitmap);
+
+// Set the container of the chunk from its dense bits
+extern void set_ptr_bitmap_chunk(struct ptr_bitmap* bitmap, size_t chunk_index,
+				const unsigned int* bits);
+
+// Return the first set bit in [bit_index, max_index), max_index if none
+extern size_t next_ptr_bit(const struct ptr_bitmap* bitmap, size_t bit_index, size_t max_index);
+
+/*
+ * Collect up to count set bits in [*bit_index, max_index) into out in
+ * increasing order, and return the number of them. *bit_index is moved
+ * to where the next call should resume.
+ */
+extern size_t gather_ptr_bits(const struct ptr_bitmap* bitmap, size_t* bit_index,
+				size_t max_index, size_t* out, size_t count);
+
+// Memory used by containers of the bitmap
+extern size_t ptr_bitmap_bytes(const struct ptr_bitmap* bitmap);
+
+// Memory used by containers of all bitmaps
+extern size_t ptr_bitmap_total_bytes(void);
+
+#endif /* PTR_BITMAP_H_ */
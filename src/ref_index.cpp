@@ -0,0 +1,605 @@
+/*
+ * ref_index.cpp
+ *		Reverse index of pointers in a core
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <queue>
+#include <thread>
+#ifndef WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "segment.h"
+#include "compressed_core.h"
+#include "thread_pool.h"
+#include "ref_index.h"
+
+/***************************************************************************
+* Edges are sorted by value, then by address. Every REF_INDEX_BLOCK edges
+* make a block, whose first edge is kept in full in the block table for
+* binary search. The rest of a block is encoded as varints of the delta of
+* value and the zigzag delta of address to the previous edge.
+*
+* The image is laid out as the header, the block table and the encoded
+* edges. It has no pointers, so that a saved index can be mapped as is.
+***************************************************************************/
+#define REF_INDEX_MAGIC   0x58444952u	// "RIDX"
+#define REF_INDEX_VERSION 2
+#define REF_INDEX_BLOCK   64
+#define REF_INDEX_CHUNK_SZ (4ul*1024*1024)
+#define REF_INDEX_SAMPLES  64	// bytes of the core sampled for its identity
+#define REF_INDEX_SAMPLE_SZ 64
+
+struct ref_index_header
+{
+	unsigned int       m_magic;
+	unsigned int       m_version;
+	unsigned int       m_ptr_bit;
+	unsigned int       m_segment_count;
+	unsigned long long m_segments_hash;	// the index belongs to these segments
+	unsigned long long m_core_size;		// and to the core file of this size,
+	long long          m_core_mtime;	// modification time
+	unsigned long long m_content_hash;	// and sampled content
+	unsigned long long m_nedges;
+	unsigned long long m_nblocks;
+	unsigned long long m_data_size;		// bytes of encoded edges
+};
+
+struct ref_index_block
+{
+	unsigned long long m_value;
+	unsigned long long m_vaddr;
+	unsigned long long m_offset;	// of the second edge in encoded edges
+};
+
+// range of pointers of a segment scanned by one worker
+struct ref_index_chunk
+{
+	unsigned int seg_index;
+	size_t begin;		// bit indexes in the segment
+	size_t end;
+};
+
+static const char* g_index_base = NULL;
+static size_t g_index_size = 0;
+static bool g_index_mapped = false;
+static std::vector<char> g_index_buffer;
+
+static inline const struct ref_index_header* index_header(void)
+{
+	return (const struct ref_index_header*) g_index_base;
+}
+
+static inline const struct ref_index_block* index_blocks(void)
+{
+	return (const struct ref_index_block*) (g_index_base + sizeof(struct ref_index_header));
+}
+
+static inline const unsigned char* index_data(void)
+{
+	return (const unsigned char*) (index_blocks() + index_header()->m_nblocks);
+}
+
+static inline void fnv_hash(unsigned long long* hash, const void* data, size_t sz)
+{
+	const unsigned char* bytes = (const unsigned char*) data;
+	size_t k;
+	for (k = 0; k < sz; k++)
+	{
+		*hash ^= bytes[k];
+		*hash *= 0x100000001b3ull;
+	}
+}
+
+// FNV-1a of the layout of segments
+static unsigned long long segments_hash(void)
+{
+	unsigned long long hash = 0xcbf29ce484222325ull;
+	unsigned int i;
+	for (i = 0; i < g_segment_count; i++)
+	{
+		unsigned long long vals[3] = {g_segments[i].m_vaddr, g_segments[i].m_vsize, g_segments[i].m_fsize};
+		fnv_hash(&hash, vals, sizeof(vals));
+	}
+	return hash;
+}
+
+/*
+ * FNV-1a of bytes sampled evenly over the data of all segments. Layout
+ * and file time alone don't tell apart cores of the same program, which
+ * is restarted and crashes at the same place.
+ */
+static unsigned long long content_hash(void)
+{
+	unsigned long long hash = 0xcbf29ce484222325ull;
+	size_t total = 0, stride, next, seg_start = 0;
+	unsigned int i;
+
+	for (i = 0; i < g_segment_count; i++)
+		total += g_segments[i].m_fsize;
+	stride = total / REF_INDEX_SAMPLES;
+	if (stride < REF_INDEX_SAMPLE_SZ)
+		stride = REF_INDEX_SAMPLE_SZ;
+	next = 0;
+	for (i = 0; i < g_segment_count && next < total; i++)
+	{
+		const struct ca_segment* segment = &g_segments[i];
+		size_t seg_end = seg_start + segment->m_fsize;
+		for (; next < seg_end; next += stride)
+		{
+			const char* data = segment->m_faddr + (next - seg_start);
+			size_t sz = seg_end - next;
+			if (sz > REF_INDEX_SAMPLE_SZ)
+				sz = REF_INDEX_SAMPLE_SZ;
+			if (g_core_compressed && !pin_core_range(data, sz))
+				continue;
+			fnv_hash(&hash, data, sz);
+			if (g_core_compressed)
+				unpin_core_range(data, sz);
+		}
+		seg_start = seg_end;
+	}
+	return hash;
+}
+
+// Set fields of the header that tell which core the index belongs to
+static void set_core_identity(struct ref_index_header* header)
+{
+	size_t core_size = 0;
+	long long core_mtime = 0;
+
+	get_core_file_stat(&core_size, &core_mtime);
+	header->m_ptr_bit = g_ptr_bit;
+	header->m_segment_count = g_segment_count;
+	header->m_segments_hash = segments_hash();
+	header->m_core_size = core_size;
+	header->m_core_mtime = core_mtime;
+	header->m_content_hash = content_hash();
+}
+
+static void encode_varint(std::vector<char>& out, unsigned long long val)
+{
+	while (val >= 0x80)
+	{
+		out.push_back((char)(val | 0x80));
+		val >>= 7;
+	}
+	out.push_back((char)val);
+}
+
+static inline unsigned long long decode_varint(const unsigned char** cursor)
+{
+	unsigned long long val = 0;
+	unsigned int shift = 0;
+	const unsigned char* p = *cursor;
+	while (*p & 0x80)
+	{
+		val |= (unsigned long long)(*p++ & 0x7f) << shift;
+		shift += 7;
+	}
+	val |= (unsigned long long)(*p++) << shift;
+	*cursor = p;
+	return val;
+}
+
+// Encode the edge as the delta of value and the zigzag delta of address
+static inline void encode_edge(std::vector<char>& out, const struct ref_edge& prev, const struct ref_edge& edge)
+{
+	long long delta = (long long)(edge.m_vaddr - prev.m_vaddr);
+	encode_varint(out, edge.m_value - prev.m_value);
+	encode_varint(out, ((unsigned long long)delta << 1) ^ (unsigned long long)(delta >> 63));
+}
+
+static inline void decode_edge(const unsigned char** cursor, struct ref_edge& edge)
+{
+	unsigned long long zigzag;
+	edge.m_value += decode_varint(cursor);
+	zigzag = decode_varint(cursor);
+	edge.m_vaddr += (address_t)((zigzag >> 1) ^ (0 - (zigzag & 1)));
+}
+
+static bool edge_less(const struct ref_edge& a, const struct ref_edge& b)
+{
+	return a.m_value < b.m_value || (a.m_value == b.m_value && a.m_vaddr < b.m_vaddr);
+}
+
+/*
+ * Sorted edges of a chunk, encoded as soon as the chunk is scanned so that
+ * no more than one chunk per worker is ever kept in full. The first edge
+ * is the delta to a zero edge.
+ */
+struct ref_index_run
+{
+	std::vector<char> m_data;
+	size_t m_nedges;
+};
+
+// Collect edges of pointers of the chunk, the bit vector has been set
+static void collect_chunk_edges(const struct ref_index_chunk& chunk, struct ref_index_run& run)
+{
+	const struct ca_segment* segment = &g_segments[chunk.seg_index];
+	size_t ptr_sz = g_ptr_bit >> 3;
+	const char* data = segment->m_faddr + chunk.begin * ptr_sz;
+	size_t data_sz = (chunk.end - chunk.begin) * ptr_sz;
+	size_t next_bit_index = chunk.begin;
+	size_t bits[REF_INDEX_BLOCK];
+	std::vector<struct ref_edge> edges;
+	struct ref_edge prev;
+	size_t n, k;
+
+	run.m_nedges = 0;
+	if (g_core_compressed && !pin_core_range(data, data_sz))
+		return;
+	while ((n = gather_ptr_bits(segment->m_ptr_bitmap, &next_bit_index, chunk.end, bits, REF_INDEX_BLOCK)) > 0)
+	{
+		for (k = 0; k < n; k++)
+		{
+			struct ref_edge edge;
+			// memcpy for the data in sparcv9 core file, which aligns on 4-byte only
+			if (ptr_sz == 8)
+			{
+				unsigned long long val;
+				memcpy(&val, segment->m_faddr + bits[k] * ptr_sz, sizeof(val));
+				edge.m_value = (address_t) val;
+			}
+			else
+			{
+				unsigned int val;
+				memcpy(&val, segment->m_faddr + bits[k] * ptr_sz, sizeof(val));
+				edge.m_value = val;
+			}
+			edge.m_vaddr = segment->m_vaddr + bits[k] * ptr_sz;
+			edges.push_back(edge);
+		}
+	}
+	if (g_core_compressed)
+		unpin_core_range(data, data_sz);
+	std::sort(edges.begin(), edges.end(), edge_less);
+
+	prev.m_value = 0;
+	prev.m_vaddr = 0;
+	for (k = 0; k < edges.size(); k++)
+	{
+		encode_edge(run.m_data, prev, edges[k]);
+		prev = edges[k];
+	}
+	run.m_data.shrink_to_fit();
+	run.m_nedges = edges.size();
+}
+
+// Merge the encoded runs into the image of the index, which is written once
+static void encode_index(std::vector<struct ref_index_run>& runs)
+{
+	// the next edge of a run and where the rest of the run starts
+	struct run_cursor
+	{
+		struct ref_edge edge;
+		const unsigned char* next;
+		size_t left;
+	};
+	typedef std::pair<struct ref_edge, size_t> run_head;
+	auto head_greater = [](const run_head& a, const run_head& b) { return edge_less(b.first, a.first); };
+	std::priority_queue<run_head, std::vector<run_head>, decltype(head_greater)> heads(head_greater);
+	std::vector<struct run_cursor> cursors(runs.size());
+	struct ref_index_header header;
+	size_t nedges = 0, data_hint = 0, blocks_end, i;
+	struct ref_edge prev;
+
+	prev.m_value = 0;
+	prev.m_vaddr = 0;
+	for (i = 0; i < runs.size(); i++)
+	{
+		struct run_cursor& cursor = cursors[i];
+		nedges += runs[i].m_nedges;
+		data_hint += runs[i].m_data.size();
+		cursor.left = runs[i].m_nedges;
+		if (cursor.left == 0)
+			continue;
+		cursor.next = (const unsigned char*) &runs[i].m_data[0];
+		cursor.edge.m_value = 0;
+		cursor.edge.m_vaddr = 0;
+		decode_edge(&cursor.next, cursor.edge);
+		heads.push(run_head(cursor.edge, i));
+	}
+	memset(&header, 0, sizeof(header));
+	header.m_magic = REF_INDEX_MAGIC;
+	header.m_version = REF_INDEX_VERSION;
+	set_core_identity(&header);
+	header.m_nedges = nedges;
+	header.m_nblocks = (nedges + REF_INDEX_BLOCK - 1) / REF_INDEX_BLOCK;
+
+	// edges are appended to the image right after the block table, the
+	// merged deltas are no longer than those of the runs in general
+	blocks_end = sizeof(header) + header.m_nblocks * sizeof(struct ref_index_block);
+	g_index_buffer.clear();
+	g_index_buffer.reserve(blocks_end + data_hint);
+	g_index_buffer.resize(blocks_end);
+	for (i = 0; !heads.empty(); i++)
+	{
+		run_head head = heads.top();
+		const struct ref_edge& edge = head.first;
+		struct run_cursor& cursor = cursors[head.second];
+		heads.pop();
+		if (i % REF_INDEX_BLOCK == 0)
+		{
+			struct ref_index_block block;
+			block.m_value = edge.m_value;
+			block.m_vaddr = edge.m_vaddr;
+			block.m_offset = g_index_buffer.size() - blocks_end;
+			memcpy(&g_index_buffer[sizeof(header) + (i / REF_INDEX_BLOCK) * sizeof(block)], &block, sizeof(block));
+		}
+		else
+			encode_edge(g_index_buffer, prev, edge);
+		prev = edge;
+		if (--cursor.left > 0)
+		{
+			decode_edge(&cursor.next, cursor.edge);
+			heads.push(run_head(cursor.edge, head.second));
+		}
+		else
+			std::vector<char>().swap(runs[head.second].m_data);
+	}
+	header.m_data_size = g_index_buffer.size() - blocks_end;
+	memcpy(&g_index_buffer[0], &header, sizeof(header));
+	g_index_base = &g_index_buffer[0];
+	g_index_size = g_index_buffer.size();
+	g_index_mapped = false;
+}
+
+bool build_ref_index(void)
+{
+	size_t ptr_sz = g_ptr_bit >> 3;
+	size_t chunk_words = REF_INDEX_CHUNK_SZ / ptr_sz;
+	std::vector<struct ref_index_run> runs;
+	unsigned int seg_index = 0;
+	std::atomic<bool> abort(false);
+
+	release_ref_index();
+	if (!g_debug_core)
+	{
+		CA_PRINT("Reference index is available for core files only\n");
+		return false;
+	}
+	else if (has_set_values())
+	{
+		CA_PRINT("Reference index is not available while values are set\n");
+		return false;
+	}
+
+	// segments are scanned in batches whose bit vectors fit in the budget
+	while (seg_index < g_segment_count && !abort)
+	{
+		std::vector<struct ref_index_chunk> chunks;
+		unsigned int batch_end;
+		size_t first_run = runs.size();
+
+		pin_bit_vecs();
+		for (batch_end = seg_index; batch_end < g_segment_count; batch_end++)
+		{
+			struct ca_segment* segment = &g_segments[batch_end];
+			size_t max_bit_index = segment->m_fsize / ptr_sz;
+
+			if (max_bit_index == 0)
+				continue;
+			if (!chunks.empty() && bit_vecs_over_budget())
+				break;
+			set_addressable_bit_vec(segment);
+			for (size_t begin = 0; begin < max_bit_index; begin += chunk_words)
+			{
+				struct ref_index_chunk chunk;
+				chunk.seg_index = batch_end;
+				chunk.begin = begin;
+				chunk.end = begin + chunk_words < max_bit_index ? begin + chunk_words : max_bit_index;
+				chunks.push_back(chunk);
+			}
+		}
+
+		runs.resize(first_run + chunks.size());
+		std::thread::id caller = std::this_thread::get_id();
+		CA_THREAD_POOL.parallel_for(chunks.size(), [&](size_t k) {
+			if (abort)
+				return;
+			if (std::this_thread::get_id() == caller && user_request_break())
+			{
+				abort = true;
+				return;
+			}
+			collect_chunk_edges(chunks[k], runs[first_run + k]);
+		});
+		unpin_bit_vecs();
+		seg_index = batch_end;
+	}
+	if (abort)
+	{
+		CA_PRINT("Abort building reference index\n");
+		return false;
+	}
+
+	encode_index(runs);
+	CA_PRINT("Reference index has %lld pointers in " PRINT_FORMAT_SIZE " bytes\n",
+			index_header()->m_nedges, g_index_size);
+	return true;
+}
+
+void release_ref_index(void)
+{
+	if (g_index_mapped)
+	{
+#ifndef WIN32
+		munmap((void*)g_index_base, g_index_size);
+#endif
+	}
+	else
+		std::vector<char>().swap(g_index_buffer);
+	g_index_base = NULL;
+	g_index_size = 0;
+	g_index_mapped = false;
+}
+
+bool ref_index_ready(void)
+{
+	return g_index_base != NULL;
+}
+
+bool save_ref_index(const char* fname)
+{
+	FILE* fp;
+
+	if (!ref_index_ready())
+		return false;
+	fp = fopen(fname, "wb");
+	if (!fp)
+	{
+		CA_PRINT("Failed to open file %s\n", fname);
+		return false;
+	}
+	if (fwrite(g_index_base, 1, g_index_size, fp) != g_index_size)
+	{
+		CA_PRINT("Failed to write file %s\n", fname);
+		fclose(fp);
+		return false;
+	}
+	fclose(fp);
+	CA_PRINT("Reference index is saved to %s\n", fname);
+	return true;
+}
+
+// The image is intact and belongs to current core
+static bool
+valid_index_image(const char* base, size_t size)
+{
+	const struct ref_index_header* header = (const struct ref_index_header*) base;
+	struct ref_index_header core;
+
+	if (size < sizeof(*header)
+		|| header->m_magic != REF_INDEX_MAGIC
+		|| header->m_version != REF_INDEX_VERSION)
+		return false;
+	if (size != sizeof(*header) + header->m_nblocks * sizeof(struct ref_index_block) + header->m_data_size)
+		return false;
+	set_core_identity(&core);
+	return header->m_ptr_bit == core.m_ptr_bit
+		&& header->m_segment_count == core.m_segment_count
+		&& header->m_segments_hash == core.m_segments_hash
+		&& header->m_core_size == core.m_core_size
+		&& header->m_core_mtime == core.m_core_mtime
+		&& header->m_content_hash == core.m_content_hash;
+}
+
+bool load_ref_index(const char* fname)
+{
+	const char* base = NULL;
+	size_t size = 0;
+
+	release_ref_index();
+	// edges are of the unpatched memory
+	if (has_set_values())
+		return false;
+#ifdef WIN32
+	FILE* fp = fopen(fname, "rb");
+	if (!fp)
+		return false;
+	fseek(fp, 0, SEEK_END);
+	size = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	g_index_buffer.resize(size);
+	if (size == 0 || fread(&g_index_buffer[0], 1, size, fp) != size)
+	{
+		fclose(fp);
+		std::vector<char>().swap(g_index_buffer);
+		return false;
+	}
+	fclose(fp);
+	base = &g_index_buffer[0];
+#else
+	struct stat st;
+	int fd = open(fname, O_RDONLY);
+	if (fd < 0)
+		return false;
+	if (fstat(fd, &st) || st.st_size == 0)
+	{
+		close(fd);
+		return false;
+	}
+	size = st.st_size;
+	base = (const char*) mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (base == (const char*) MAP_FAILED)
+		return false;
+	g_index_mapped = true;
+#endif
+	g_index_base = base;
+	g_index_size = size;
+	if (!valid_index_image(base, size))
+	{
+		CA_PRINT("Reference index %s doesn't match the target\n", fname);
+		release_ref_index();
+		return false;
+	}
+	CA_PRINT("Reference index of %lld pointers is loaded from %s\n", index_header()->m_nedges, fname);
+	return true;
+}
+
+bool ref_index_covers(const std::list<struct object_range*>& targets)
+{
+	if (!ref_index_ready())
+		return false;
+	for (auto target : targets)
+	{
+		address_t cursor = target->low;
+		while (cursor < target->high)
+		{
+			struct ca_segment* segment = get_segment(cursor, 1);
+			if (!segment)
+				return false;
+			cursor = segment->m_vaddr + segment->m_vsize;
+		}
+	}
+	return true;
+}
+
+void ref_index_lookup(address_t low, address_t high, std::vector<struct ref_edge>& edges)
+{
+	const struct ref_index_header* header;
+	const struct ref_index_block* blocks;
+	size_t nblocks, b;
+
+	if (!ref_index_ready() || low >= high)
+		return;
+	header = index_header();
+	blocks = index_blocks();
+	nblocks = header->m_nblocks;
+	// edges of value low may start in the block before the first one not below low
+	b = std::lower_bound(blocks, blocks + nblocks, (unsigned long long)low,
+			[](const struct ref_index_block& block, unsigned long long val) { return block.m_value < val; }) - blocks;
+	if (b > 0)
+		b--;
+	for (; b < nblocks && blocks[b].m_value < high; b++)
+	{
+		const unsigned char* cursor = index_data() + blocks[b].m_offset;
+		size_t count = header->m_nedges - b * REF_INDEX_BLOCK;
+		struct ref_edge edge;
+		size_t i;
+
+		if (count > REF_INDEX_BLOCK)
+			count = REF_INDEX_BLOCK;
+		edge.m_value = blocks[b].m_value;
+		edge.m_vaddr = blocks[b].m_vaddr;
+		for (i = 0; i < count; i++)
+		{
+			if (i > 0)
+				decode_edge(&cursor, edge);
+			if (edge.m_value >= high)
+				return;
+			if (edge.m_value >= low)
+				edges.push_back(edge);
+		}
+	}
+}
@@ -0,0 +1,51 @@
+/*
+ * ref_index.h
+ *		Reverse index of pointers in a core, from the values that
+ *		pointers hold to the addresses where they are found
+ *
+ *  Created on: Oct 17, 2026
+ */
+#ifndef REF_INDEX_H_
+#define REF_INDEX_H_
+
+#include <list>
+#include <vector>
+#include "ref.h"
+
+/*
+ * An edge of the index, the pointer at m_vaddr holds m_value
+ */
+struct ref_edge
+{
+	address_t m_value;
+	address_t m_vaddr;
+};
+
+/*
+ * Scan all pointers of the core in parallel and index them by value.
+ * It is dropped when segments are changed
+ */
+extern bool build_ref_index(void);
+
+extern void release_ref_index(void);
+
+extern bool ref_index_ready(void);
+
+/*
+ * The index is a position-independent image, which is saved as is and
+ * mapped back by a later session of the same core
+ */
+extern bool save_ref_index(const char* fname);
+
+extern bool load_ref_index(const char* fname);
+
+/*
+ * True if the index is ready and has every word whose value is in one
+ * of the targets, i.e. all values of targets are addresses of segments
+ */
+extern bool ref_index_covers(const std::list<struct object_range*>& targets);
+
+// Append edges whose values are in [low, high) in the order of values
+extern void ref_index_lookup(address_t low, address_t high, std::vector<struct ref_edge>& edges);
+
+#endif /* REF_INDEX_H_ */
@@ -7,9 +7,16 @@
 #include <algorithm>
 #include <list>
 #include <set>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
 #include "search.h"
 #include "segment.h"
 #include "heap.h"
+#include "compressed_core.h"
+#include "thread_pool.h"
+#include "simd_scan.h"
+#include "ref_index.h"
 #include <sstream>
 #include <string>
 
@@ -20,8 +27,19 @@ struct shared_object
 {
 	address_t start;
 	address_t end;
-	std::list<struct object_reference*> thread_owners;	// list of thread references
-	std::list<struct shared_object*> parent_shrobjs;	// list of shared_objects that point to me
+	unsigned int level;		// the least level of indirection from threads
+	std::vector<struct object_reference> thread_owners;	// thread references
+	std::vector<unsigned int> parent_shrobjs;	// indexes of shared_objects that point to me
+};
+
+// A register or stack word of a thread that points to a heap block or global
+struct shrobj_hit
+{
+	address_t vaddr;		// stack address
+	address_t value;
+	address_t obj_start;	// the object if it is resolved by the scan
+	size_t    obj_size;
+	int reg_num;			// -1 for a stack word
 };
 
 /////////////////////////////////////////////////////
@@ -31,6 +49,12 @@ bool g_skip_free = true;
 bool g_skip_unknown = false;
 unsigned int g_max_indirection_level = 16;
 #define MAX_INDIRECTION_LEVEL 64
+#define SEARCH_WINDOW_SZ (64ul*1024*1024)
+#define SEARCH_CHUNK_SZ (4ul*1024*1024)
+#define SEARCH_GATHER_COUNT 64
+#define CENSUS_CHUNK_BLOCKS (64*1024)
+#define PATTERN_CHUNK_SZ (64ul*1024)
+#define PATTERN_TOP_COUNT 10
 
 static unsigned int g_shrobj_level = 1;
 static const unsigned int MAX_SHROBJ_LEVEL = 16;
@@ -45,9 +69,14 @@ static const int min_chars = 4;
 
 static unsigned int g_output_count = 0;
 
-static bool shared_object_comp_func(void *lhs, void *rhs);
-typedef std::set<struct shared_object*, decltype(&shared_object_comp_func)> SharedObjectSet;
-static  SharedObjectSet g_shared_objects(&shared_object_comp_func);
+// Shared objects in the order they are found, an open-addressing table from
+// their start addresses to indexes plus one, and their indexes by address
+static std::vector<struct shared_object> g_shared_objects;
+static std::vector<unsigned int> g_shrobj_slots;
+static std::vector<unsigned int> g_shrobj_order;
+// in-use blocks that heap objects are looked up in
+static struct inuse_block* g_shrobj_blocks = nullptr;
+static unsigned long g_shrobj_nblocks = 0;
 
 /////////////////////////////////////////////////////
 // forward declarations.
@@ -57,17 +86,264 @@ static void print_string(address_t str);
 static void print_wstring(address_t str);
 static void print_ref_chain (const std::list<struct object_reference*>&);
 static void init_shared_objects(void);
-static void empty_shared_objects(void);
 static void print_shared_objects_by_threads(void);
-static struct shared_object* add_one_shared_object(address_t, bool, unsigned int);
-static bool has_multiple_thread_owners(struct shared_object* shrobj);
+static bool prescan_shared_object(address_t, struct shrobj_hit*);
+static void add_thread_owners(struct ca_segment*, const std::vector<struct shrobj_hit>&);
+static void expand_shared_objects(void);
+static bool has_multiple_thread_owners(unsigned int index);
+
+/***************************************************************************
+* Matcher of values against many target ranges
+*	ranges are sorted and coalesced. A few of them are checked one by one,
+*	up to hundreds by binary search, and more are bucketed by page in a
+*	hash table. A value costs O(log n) at most regardless of targets.
+***************************************************************************/
+#define MATCHER_LINEAR_MAX  8
+#define MATCHER_BSEARCH_MAX 256
+#define MATCHER_PAGE_SHIFT  12
+
+enum matcher_strategy
+{
+	MATCH_LINEAR,
+	MATCH_BSEARCH,
+	MATCH_PAGE_TABLE
+};
+
+// ranges that overlap a page are [m_first, m_last) of the sorted ranges
+struct matcher_bucket
+{
+	address_t    m_page;
+	unsigned int m_first;
+	unsigned int m_last;	// zero for an empty bucket
+};
+
+struct target_matcher
+{
+	std::vector<address_t> m_lows;
+	std::vector<address_t> m_highs;
+	address_t m_min;
+	address_t m_max;
+	enum matcher_strategy m_strategy;
+	std::vector<struct matcher_bucket> m_buckets;
+	unsigned int m_bucket_shift;
+
+	target_matcher(const std::list<struct object_range*>& targets);
+
+	bool has_zero() const { return !m_lows.empty() && m_lows[0] == 0; }
+
+	bool match(address_t val) const
+	{
+		if (val < m_min || val >= m_max)
+			return false;
+		if (m_strategy == MATCH_LINEAR)
+		{
+			for (size_t i = 0; i < m_lows.size(); i++)
+			{
+				if (val >= m_lows[i] && val < m_highs[i])
+					return true;
+			}
+			return false;
+		}
+		else if (m_strategy == MATCH_BSEARCH)
+			return match_sorted(0, m_lows.size(), val);
+		else
+		{
+			const struct matcher_bucket* bucket = find_bucket(val >> MATCHER_PAGE_SHIFT);
+			return bucket && match_sorted(bucket->m_first, bucket->m_last, val);
+		}
+	}
+
+	// Index of the first of nwords raw words at data that matches, nwords if none
+	// A few ranges are compared by vector kernels directly; otherwise the
+	// kernels filter words by the bounds of all ranges before match()
+	size_t find_first(const char* data, size_t nwords, size_t ptr_sz) const
+	{
+		size_t i = 0;
+
+		if (m_lows.empty())
+			return nwords;
+		if (m_lows.size() <= MAX_SCAN_RANGES)
+			return find_words_in_ranges(data, nwords, ptr_sz, &m_lows[0], &m_highs[0], m_lows.size());
+		while (i < nwords)
+		{
+			address_t val;
+			i += find_words_in_ranges(data + i * ptr_sz, nwords - i, ptr_sz, &m_min, &m_max, 1);
+			if (i >= nwords)
+				break;
+			if (ptr_sz == 8)
+				val = *(address_t*)(data + i * ptr_sz);
+			else
+				val = *(unsigned int*)(data + i * ptr_sz);
+			if (match(val))
+				return i;
+			i++;
+		}
+		return nwords;
+	}
+
+private:
+	// the last range of [first, last) starting at or below val contains it
+	bool match_sorted(size_t first, size_t last, address_t val) const
+	{
+		const address_t* base = &m_lows[first];
+		size_t len = last - first;
+		while (len > 1)
+		{
+			size_t half = len / 2;
+			base = base[half] <= val ? base + half : base;
+			len -= half;
+		}
+		return *base <= val && val < m_highs[base - &m_lows[0]];
+	}
+
+	size_t bucket_hash(address_t page) const
+	{
+		return (size_t)(((unsigned long long)page * 0x9E3779B97F4A7C15ull) >> m_bucket_shift);
+	}
+
+	const struct matcher_bucket* find_bucket(address_t page) const
+	{
+		size_t mask = m_buckets.size() - 1;
+		size_t i;
+		for (i = bucket_hash(page); m_buckets[i].m_last; i = (i + 1) & mask)
+		{
+			if (m_buckets[i].m_page == page)
+				return &m_buckets[i];
+		}
+		return NULL;
+	}
+
+	bool build_page_table(void);
+};
+
+target_matcher::target_matcher(const std::list<struct object_range*>& targets)
+	: m_min(0), m_max(0), m_strategy(MATCH_LINEAR), m_bucket_shift(0)
+{
+	std::vector<struct object_range> ranges;
+	for (auto target : targets)
+	{
+		if (target->low < target->high)
+			ranges.push_back(*target);
+	}
+	std::sort(ranges.begin(), ranges.end(),
+		[](const struct object_range& a, const struct object_range& b) { return a.low < b.low; });
+	for (auto& range : ranges)
+	{
+		if (!m_lows.empty() && range.low <= m_highs.back())
+		{
+			if (range.high > m_highs.back())
+				m_highs.back() = range.high;
+		}
+		else
+		{
+			m_lows.push_back(range.low);
+			m_highs.push_back(range.high);
+		}
+	}
+	if (m_lows.empty())
+		return;
+	m_min = m_lows.front();
+	m_max = m_highs.back();
+
+	if (m_lows.size() <= MATCHER_LINEAR_MAX)
+		m_strategy = MATCH_LINEAR;
+	else if (m_lows.size() <= MATCHER_BSEARCH_MAX || !build_page_table())
+		m_strategy = MATCH_BSEARCH;
+	else
+		m_strategy = MATCH_PAGE_TABLE;
+}
+
+// Return false if the ranges span too many pages to be bucketed
+bool target_matcher::build_page_table(void)
+{
+	size_t npages = 0, nbuckets = 1;
+	size_t i;
+	unsigned int bits = 0;
+
+	for (i = 0; i < m_lows.size(); i++)
+		npages += ((m_highs[i] - 1) >> MATCHER_PAGE_SHIFT) - (m_lows[i] >> MATCHER_PAGE_SHIFT) + 1;
+	if (npages > m_lows.size() * 16)
+		return false;
+	// keep the table at most half full
+	while (nbuckets < npages * 2)
+	{
+		nbuckets <<= 1;
+		bits++;
+	}
+	m_bucket_shift = 64 - (bits ? bits : 1);
+	m_buckets.assign(nbuckets < 2 ? 2 : nbuckets, matcher_bucket());
+	for (i = 0; i < m_lows.size(); i++)
+	{
+		address_t page;
+		for (page = m_lows[i] >> MATCHER_PAGE_SHIFT; page <= (m_highs[i] - 1) >> MATCHER_PAGE_SHIFT; page++)
+		{
+			size_t mask = m_buckets.size() - 1;
+			size_t k = bucket_hash(page);
+			while (m_buckets[k].m_last && m_buckets[k].m_page != page)
+				k = (k + 1) & mask;
+			// sorted ranges of a page are consecutive
+			if (!m_buckets[k].m_last)
+			{
+				m_buckets[k].m_page = page;
+				m_buckets[k].m_first = i;
+			}
+			m_buckets[k].m_last = i + 1;
+		}
+	}
+	return true;
+}
 
 /***************************************************************************
 * Search functions
 ***************************************************************************/
 /*
+ * Check pointers marked in the segment's bit vector against targets
+ * Set bits are gathered in batches, and their values are loaded
+ * together before they are compared.
+ */
+template <typename T>
+static bool
+search_ptr_bits(struct ca_segment* segment,
+		size_t* next_bit_index,
+		size_t max_bit_index,
+		const struct target_matcher& targets,
+		address_t* found_val,
+		address_t* found_vaddr)
+{
+	const T* words = (const T*) segment->m_faddr;
+	size_t bits[SEARCH_GATHER_COUNT];
+	address_t vals[SEARCH_GATHER_COUNT];
+	size_t n, k;
+
+	while (*next_bit_index < max_bit_index)
+	{
+		n = gather_ptr_bits(segment->m_ptr_bitmap, next_bit_index, max_bit_index,
+				bits, SEARCH_GATHER_COUNT);
+		for (k = 0; k < n; k++)
+			vals[k] = words[bits[k]];
+		for (k = 0; k < n; k++)
+		{
+			if (targets.match(vals[k]))
+			{
+				*next_bit_index = bits[k];
+				*found_val = vals[k];
+				*found_vaddr = segment->m_vaddr + bits[k] * sizeof(T);
+				return true;
+			}
+		}
+		if (n == 0)
+			break;
+	}
+	*next_bit_index = max_bit_index;
+	return false;
+}
+
+/*
+ * The segment's bit vector must have been set, so that it may be
+ * called by workers
  * Params:
  * 		next_bit_index represents the i_th pointers in this segment
+ * 		pointers before max_bit_index are searched
  * 		searched-for value is in the range of [target_low, target_high)
  * Return:
  * 		true if the 1st match is found, false otherwise
@@ -76,135 +352,459 @@ static bool has_multiple_thread_owners(struct shared_object* shrobj);
 static bool
 search_value_by_range(struct ca_segment* segment,
 		size_t* next_bit_index,
-		struct object_range** targets,
+		size_t max_bit_index,
+		const struct target_matcher& targets,
 		int target_is_ptr,
 		address_t* found_val,
 		address_t* found_vaddr)
 {
 	size_t ptr_sz = g_ptr_bit >> 3;
-	size_t max_bit_index  = segment->m_fsize / ptr_sz;
-
-	if (!segment->m_bitvec_ready)
-		set_addressable_bit_vec(segment);
+	size_t populated_end = 0;
+	// unpopulated pages are all zeros
+	bool skip_unpopulated = !targets.has_zero();
 
 	// find next addressable pointer
 	while (*next_bit_index < max_bit_index)
 	{
-		unsigned int target_index;
-		// The bit vector of addressable can speed up search significantly
-		if (target_is_ptr)
+		// skip file holes and pages of zeros wholesale, the bit vector
+		// of pointers has no bit in them anyway
+		if (!target_is_ptr && skip_unpopulated && *next_bit_index * ptr_sz >= populated_end)
 		{
-			unsigned int i;
-			unsigned int uint_bit;
-			size_t uint_index = *next_bit_index >> 5;
-			unsigned int bits = segment->m_ptr_bitvec[uint_index];
-
-			if (bits == 0)
-			{
-				// There are no addressable ptrs in the next chunk of memory (32 ptrs)
-				// Also account for unaligned next_bit_index
-				*next_bit_index = (*next_bit_index & ~(size_t)0x1F) + 32;
-				continue;
-			}
-			// consider the bit inside the uint
-			uint_bit = *next_bit_index & (size_t)0x1F;
-			bits &= ~( (1 << uint_bit) - 1);
-			if (bits == 0)
+			size_t offset = next_populated_offset(segment, *next_bit_index * ptr_sz);
+			populated_end = next_unpopulated_offset(segment, offset);
+			if (offset / ptr_sz > *next_bit_index)
 			{
-				*next_bit_index = (*next_bit_index & ~(size_t)0x1F) + 32;
+				*next_bit_index = offset / ptr_sz;
 				continue;
 			}
-			// find the non-zero bit
-			bits = bits >> uint_bit;
-			for (i=uint_bit; i<32; i++)
+		}
+		// The bit vector of addressable can speed up search significantly
+		if (target_is_ptr)
+		{
+			if (ptr_sz == 8)
+				return search_ptr_bits<unsigned long long>(segment, next_bit_index,
+						max_bit_index, targets, found_val, found_vaddr);
+			else
+				return search_ptr_bits<unsigned int>(segment, next_bit_index,
+						max_bit_index, targets, found_val, found_vaddr);
+		}
+		else	// we have to scan raw data for arbitrary target
+		{
+			const char* start = segment->m_faddr;
+			const char* next  = start + (*next_bit_index * ptr_sz);
+			const char* end   = start + max_bit_index * ptr_sz;
+			if (skip_unpopulated && start + populated_end < end)
+				end = start + populated_end;
+			if (next + ptr_sz <= end)
 			{
-				if (bits & 0x1)
+				size_t nwords = (end - next) / ptr_sz;
+				size_t i = targets.find_first(next, nwords, ptr_sz);
+
+				*next_bit_index += i;
+				if (i < nwords)
 				{
-					// this is a valid ptr, check if it points to target object
-					size_t offset = *next_bit_index * ptr_sz;
-					const char* next_ref = segment->m_faddr + offset;
-					address_t val;
+					next += i * ptr_sz;
 					if (ptr_sz == 8)
-						val = *(address_t*)next_ref;
+						*found_val = *(address_t*)next;
 					else
-						val = *(unsigned int*)next_ref;
-
-					for (target_index=0; targets[target_index]; target_index++)
-					{
-						if (val >= targets[target_index]->low && val < targets[target_index]->high)
-						{
-							*found_val = val;
-							*found_vaddr = segment->m_vaddr + offset;
-							return true;
-						}
-					}
+						*found_val = *(unsigned int*)next;
+					*found_vaddr = segment->m_vaddr + (next - start);
+					return true;
 				}
-				bits = bits >> 1;
-				(*next_bit_index)++;
 			}
 		}
-		else	// we have to scan raw data for arbitrary target
+	}
+
+	return false;
+}
+
+/////////////////////////////////////////////////////////////////////////
+// Consumer of found references
+//	references are streamed to the consumer in the order of memory, and
+//	are only valid during the call. The consumer may keep, count or print
+//	them, and returns false to stop the search, e.g. after enough results
+//	or when its time is up.
+/////////////////////////////////////////////////////////////////////////
+typedef bool (*ref_consumer)(const struct object_reference* ref, void* ctx);
+
+struct ref_sink
+{
+	ref_consumer consume;
+	void*        ctx;
+	bool         stopped;
+};
+
+static inline void
+put_found_ref(struct ref_sink* sink, const struct object_reference* ref)
+{
+	if (!sink->stopped && !sink->consume(ref, sink->ctx))
+		sink->stopped = true;
+}
+
+/////////////////////////////////////////////////////////////////////////
+// References found by a query are carved from chunks of an arena, which
+// are released at once when the query is done. A reference returned to
+// the caller of the query is copied out with new.
+/////////////////////////////////////////////////////////////////////////
+#define REF_ARENA_CHUNK 1024
+
+class ref_arena
+{
+public:
+	ref_arena() : m_used(REF_ARENA_CHUNK) {}
+	~ref_arena()
+	{
+		for (auto chunk : m_chunks)
+			delete [] chunk;
+	}
+	ref_arena(const ref_arena&) = delete;
+	ref_arena& operator=(const ref_arena&) = delete;
+
+	struct object_reference* alloc(const struct object_reference& ref)
+	{
+		struct object_reference* result;
+		if (m_used == REF_ARENA_CHUNK)
 		{
-			const char* start = segment->m_faddr;
-			const char* next  = start + (*next_bit_index * ptr_sz);
-			const char* end   = start + segment->m_fsize;
-			while (next + ptr_sz <= end)
+			m_chunks.push_back(new struct object_reference[REF_ARENA_CHUNK]);
+			m_used = 0;
+		}
+		result = &m_chunks.back()[m_used++];
+		*result = ref;
+		return result;
+	}
+
+private:
+	std::vector<struct object_reference*> m_chunks;
+	size_t m_used;	// references taken from the last chunk
+};
+
+struct ref_list
+{
+	std::list<struct object_reference*>* refs;
+	ref_arena* arena;
+};
+
+// The classic output, every reference is copied to the front of a list
+static bool
+ref_list_consumer(const struct object_reference* ref, void* ctx)
+{
+	struct ref_list* list = (struct ref_list*) ctx;
+	list->refs->push_front(list->arena->alloc(*ref));
+	return true;
+}
+
+// Registers of a thread are few, they are collected and then streamed
+static bool
+sink_registers(struct ca_segment* segment,
+		const std::list<struct object_range*>& targets,
+		struct ref_sink* sink)
+{
+	std::list<struct object_reference*> regs;
+	bool found = search_registers(segment, targets, regs);
+
+	// in the order they are found
+	for (auto itr = regs.rbegin(); itr != regs.rend(); itr++)
+	{
+		put_found_ref(sink, *itr);
+		free (*itr);
+	}
+	return found;
+}
+
+/////////////////////////////////////////////////////////////////////////
+// Describe a match found in the segment and stream it to the sink
+// Return true if the match is kept
+/////////////////////////////////////////////////////////////////////////
+static bool
+add_found_ref(struct ca_segment* segment, address_t val, address_t vaddr,
+		struct ref_sink* sink)
+{
+	bool valid_ref = false;
+	struct object_reference aref;
+	struct object_reference* ref = &aref;
+	ref->storage_type = segment->m_type;
+	ref->vaddr        = vaddr;
+	ref->value        = val;
+
+	// detail for various storage class
+	if (segment->m_type == ENUM_STACK)
+	{
+		ref->where.stack.tid = segment->m_thread.tid;
+		ref->where.stack.frame = get_frame_number(segment, vaddr, &ref->where.stack.offset);
+		if (ref->where.stack.frame >= 0 || !g_skip_free)
+			valid_ref = true;
+	}
+	else if (segment->m_type == ENUM_MODULE_TEXT || segment->m_type == ENUM_MODULE_DATA)
+	{
+		// it belongs to a module's .text or .data
+		valid_ref = true;
+		ref->where.module.name = segment->m_module_name;
+		ref->where.module.base = segment->m_vaddr;
+		ref->where.module.size = segment->m_vsize;
+	}
+	else if (segment->m_type == ENUM_HEAP)
+	{
+		if (CA_HEAP->is_heap_block(vaddr))
+		{
+			// otherwise, it is on heap
+			struct heap_block blk;
+			CA_HEAP->get_heap_block_info(vaddr, &blk);
+			// we generally don't care about free heap memory
+			if (blk.inuse || !g_skip_free)
 			{
-				address_t val;
-				if (ptr_sz == 8)
-					val = *(address_t*)next;
-				else
-					val = *(unsigned int*)next;
+				valid_ref = true;
+				ref->where.heap.addr = blk.addr;
+				ref->where.heap.size = blk.size;
+				ref->where.heap.inuse = blk.inuse;
+			}
+		}
+		else	// it is in heap segment, but not recognized by allocator
+			ref->storage_type = ENUM_UNKNOWN;
+	}
+	// keep meaningful ref, and throw away undesired one
+	if (valid_ref || (!g_skip_unknown && ref->storage_type == ENUM_UNKNOWN))
+	{
+		put_found_ref(sink, ref);
+		return true;
+	}
+	return false;
+}
+
+/////////////////////////////////////////////////////////////////////////
+// Memory of a core file is scanned by the worker pool
+//	segments are split into page-aligned chunks. Workers only collect
+//	raw matches of their chunks. Registers and matches are then turned
+//	into references on the calling thread in segment and address order,
+//	so that the output is the same as a sequential scan.
+//	Segments are scanned in batches whose bit vectors fit in the
+//	budget and are pinned while the workers run. Chunks of a batch are
+//	scanned a window at a time and merged before the next window, so
+//	that raw matches held at once are bounded and a sink that stops
+//	saves the scan of the rest.
+/////////////////////////////////////////////////////////////////////////
+#define SEARCH_WINDOW_CHUNKS_PER_THREAD 2
+
+struct search_match
+{
+	address_t val;
+	address_t vaddr;
+};
+
+struct search_chunk
+{
+	unsigned int seg_index;
+	size_t begin;		// bit indexes in the segment
+	size_t end;
+	bool   done;
+	std::vector<struct search_match> matches;
+};
+
+static bool
+search_value_parallel(const std::list<struct object_range*>& targets,
+		const struct target_matcher& matcher,
+		bool target_is_ptr,
+		enum storage_type stype,
+		struct ref_sink* sink)
+{
+	size_t ptr_sz = g_ptr_bit >> 3;
+	size_t chunk_words = SEARCH_CHUNK_SZ / ptr_sz;
+	size_t window_chunks = (CA_THREAD_POOL.size() + 1) * SEARCH_WINDOW_CHUNKS_PER_THREAD;
+	unsigned int seg_index = 0;
+	bool lbFound = false;
+	// workers stop at the user's break
+	std::atomic<bool> abort(false);
+
+	// registers are read if this is a thread stack
+	auto merge_registers = [&](unsigned int i) {
+		struct ca_segment* segment = &g_segments[i];
+		if (segment->m_type == ENUM_STACK && (stype & ENUM_REGISTER))
+		{
+			if (sink_registers(segment, targets, sink))
+				lbFound = true;
+		}
+	};
+
+	while (seg_index < g_segment_count && !abort && !sink->stopped)
+	{
+		std::vector<struct search_chunk> chunks;
+		unsigned int batch_end;
+		size_t window, k;
+
+		pin_bit_vecs();
+		for (batch_end = seg_index; batch_end < g_segment_count; batch_end++)
+		{
+			struct ca_segment* segment = &g_segments[batch_end];
+			size_t max_bit_index = segment->m_fsize / ptr_sz;
+
+			if ((segment->m_type & stype) == 0 || max_bit_index == 0)
+				continue;
+			// bit vectors also tell populated pages for raw scan
+			if (!chunks.empty() && bit_vecs_over_budget())
+				break;
+			set_addressable_bit_vec(segment);
+			for (size_t begin = 0; begin < max_bit_index; begin += chunk_words)
+			{
+				struct search_chunk chunk;
+				chunk.seg_index = batch_end;
+				chunk.begin = begin;
+				chunk.end = begin + chunk_words < max_bit_index ? begin + chunk_words : max_bit_index;
+				chunk.done = false;
+				chunks.push_back(chunk);
+			}
+		}
+
+		// the calling thread also takes chunks, and watches for user's break
+		std::thread::id caller = std::this_thread::get_id();
+		for (window = 0, k = 0; window < chunks.size() && !abort && !sink->stopped; )
+		{
+			size_t window_end = window + window_chunks < chunks.size() ? window + window_chunks : chunks.size();
+
+			CA_THREAD_POOL.parallel_for(window_end - window, [&](size_t i) {
+				struct search_chunk& chunk = chunks[window + i];
+				struct ca_segment* segment = &g_segments[chunk.seg_index];
+				size_t next_bit_index = chunk.begin;
+				address_t val, vaddr;
 
-				for (target_index=0; targets[target_index]; target_index++)
+				if (abort)
+					return;
+				if (std::this_thread::get_id() == caller && user_request_break())
 				{
-					if (val >= targets[target_index]->low && val < targets[target_index]->high)
-					{
-						*found_val = val;
-						*found_vaddr = segment->m_vaddr + (next - start);
-						return true;
-					}
+					abort = true;
+					return;
+				}
+				while (!abort && search_value_by_range(segment, &next_bit_index, chunk.end,
+						matcher, target_is_ptr, &val, &vaddr))
+				{
+					struct search_match match = {val, vaddr};
+					chunk.matches.push_back(match);
+					next_bit_index++;
 				}
-				(*next_bit_index)++;
-				next += ptr_sz;
+				chunk.done = !abort;
+			});
+
+			// merge in order, up to the first chunk left by an abort
+			// or until the sink has had enough
+			for (; k < window_end && chunks[k].done && !sink->stopped; k++)
+			{
+				struct search_chunk& chunk = chunks[k];
+				for (; seg_index <= chunk.seg_index && !sink->stopped; seg_index++)
+					merge_registers(seg_index);
+				for (auto& match : chunk.matches)
+				{
+					if (sink->stopped)
+						break;
+					if (add_found_ref(&g_segments[chunk.seg_index], match.val, match.vaddr, sink))
+						lbFound = true;
+				}
+				std::vector<struct search_match>().swap(chunk.matches);
 			}
+			window = window_end;
 		}
+		unpin_bit_vecs();
+
+		// registers of the rest of segments of the batch
+		if (abort || sink->stopped)
+			break;
+		for (; seg_index < batch_end && !sink->stopped; seg_index++)
+			merge_registers(seg_index);
 	}
+	if (abort)
+		CA_PRINT("Abort searching\n");
 
-	return false;
+	return lbFound;
+}
+
+/////////////////////////////////////////////////////////////////////////
+// Pointers to targets are looked up in the reference index
+//	edges are sorted by address, so that references are reported in the
+//	same order as a scan of segments.
+/////////////////////////////////////////////////////////////////////////
+static bool
+ref_edge_vaddr_less(const struct ref_edge& a, const struct ref_edge& b)
+{
+	return a.m_vaddr < b.m_vaddr;
+}
+
+static bool
+search_value_indexed(const std::list<struct object_range*>& targets,
+		enum storage_type stype,
+		struct ref_sink* sink)
+{
+	std::vector<struct ref_edge> edges;
+	bool lbFound = false;
+	size_t k = 0;
+
+	for (auto target : targets)
+		ref_index_lookup(target->low, target->high, edges);
+	// overlapped targets find the same pointer more than once
+	std::sort(edges.begin(), edges.end(), ref_edge_vaddr_less);
+	edges.erase(std::unique(edges.begin(), edges.end(),
+			[](const struct ref_edge& a, const struct ref_edge& b) { return a.m_vaddr == b.m_vaddr; }),
+			edges.end());
+
+	for (unsigned int i = 0; i < g_segment_count && !sink->stopped; i++)
+	{
+		struct ca_segment* segment = &g_segments[i];
+		address_t seg_end = segment->m_vaddr + segment->m_fsize;
+
+		// registers are read if this is a thread stack
+		if (segment->m_type == ENUM_STACK && (stype & ENUM_REGISTER))
+		{
+			if (sink_registers(segment, targets, sink))
+				lbFound = true;
+		}
+		while (k < edges.size() && edges[k].m_vaddr < segment->m_vaddr)
+			k++;
+		for (; k < edges.size() && edges[k].m_vaddr < seg_end && !sink->stopped; k++)
+		{
+			if ((segment->m_type & stype) == 0)
+				continue;
+			if (add_found_ref(segment, edges[k].m_value, edges[k].m_vaddr, sink))
+				lbFound = true;
+		}
+	}
+
+	return lbFound;
 }
 
 /////////////////////////////////////////////////////////////////////////
 // The work horse of value search
-// Found references are inserted into output list.
+// Found references are streamed to the sink.
 // Return true if at least one is found
 /////////////////////////////////////////////////////////////////////////
 static bool
-search_value_internal(const std::list<struct object_range*>& targets,
+search_value_sink(const std::list<struct object_range*>& targets,
 		bool target_is_ptr,
 		enum storage_type stype,
-		std::list<struct object_reference*>& refs)
+		struct ref_sink* sink)
 {
 	bool lbFound = false;
-	std::vector<struct object_range*> target_array;
 
 	if (targets.size() == 0)
 		return false;
 
-	// use an array terminated with NULL, for performance sake
-	for (auto target : targets)
-		target_array.push_back(target);
-	target_array.push_back(nullptr);
+	// the reference index has every word whose value is an address of the
+	// core, so it answers for pointer and raw targets alike if it covers them
+	if (g_debug_core && ref_index_covers(targets))
+		return search_value_indexed(targets, stype, sink);
+
+	// sorted and indexed targets, for performance sake
+	struct target_matcher matcher(targets);
+
+	// a live process is read through the debugger, a compressed core
+	// is pinned window by window; both are scanned on this thread
+	if (g_debug_core && !g_core_compressed)
+		return search_value_parallel(targets, matcher, target_is_ptr, stype, sink);
 
 	// search all threads' registers/stacks
-	for (unsigned int i=0; i<g_segment_count; i++)
+	for (unsigned int i=0; i<g_segment_count && !sink->stopped; i++)
 	{
 		struct ca_segment* segment = &g_segments[i];
 
 		// registers are read if this is a thread stack
 		if (segment->m_type == ENUM_STACK && (stype & ENUM_REGISTER))
 		{
-			if (search_registers(segment, targets, refs))
+			if (sink_registers(segment, targets, sink))
 				lbFound = true;
 		}
 
@@ -222,7 +822,12 @@ search_value_internal(const std::list<struct object_range*>& targets,
 		// search segment memory
 		if (segment->m_fsize > 0)
 		{
+			size_t ptr_sz = g_ptr_bit >> 3;
 			size_t next_bit_index = 0;
+			size_t max_bit_index = segment->m_fsize / ptr_sz;
+			size_t window_begin = 0;
+			size_t window_end = max_bit_index;
+			bool pinned = false;
 			// if we are debugging core file, read memory from mmap-ed file
 			// for live process, use a buffer to read in the whole segment
 			if (!g_debug_core)
@@ -242,65 +847,54 @@ search_value_internal(const std::list<struct object_range*>& targets,
 				else
 					segment->m_faddr = gp_mem_buf;
 			}
+			// it also marks the segment's bit vector as recently used
+			set_addressable_bit_vec(segment);
 			// begin to scan memory, pointed by segment->m_faddr
-			while (1)
+			while (next_bit_index < max_bit_index)
 			{
 				address_t val   = 0xdeadbeef;
 				address_t vaddr = 0xdeadbeef;
 
-                if(search_value_by_range(segment, &next_bit_index, &target_array[0], target_is_ptr, &val, &vaddr))
+				// a compressed core is decompressed and scanned window by window
+				if (g_core_compressed && !pinned)
 				{
-					// find a match in this segment
-					bool valid_ref = false;
-					struct object_reference* ref = new struct object_reference;
-					ref->storage_type = segment->m_type;
-					ref->vaddr        = vaddr;
-					ref->value        = val;
-
-					// detail for various storage class
-					if (segment->m_type == ENUM_STACK)
-					{
-						ref->where.stack.tid = segment->m_thread.tid;
-						ref->where.stack.frame = get_frame_number(segment, vaddr, &ref->where.stack.offset);
-						if (ref->where.stack.frame >= 0 || !g_skip_free)
-							valid_ref = true;
-					}
-					else if (segment->m_type == ENUM_MODULE_TEXT || segment->m_type == ENUM_MODULE_DATA)
+					size_t window_words = SEARCH_WINDOW_SZ / ptr_sz;
+					const char* window;
+
+					window_begin = next_bit_index & ~(window_words - 1);
+					window = segment->m_faddr + window_begin * ptr_sz;
+
+					window_end = window_begin + window_words;
+					if (window_end > max_bit_index)
+						window_end = max_bit_index;
+					prefetch_core_range(window, (window_end - window_begin) * ptr_sz);
+					pinned = pin_core_range(window, (window_end - window_begin) * ptr_sz);
+					if (!pinned)
 					{
-						// it belongs to a module's .text or .data
-						valid_ref = true;
-						ref->where.module.name = segment->m_module_name;
-						ref->where.module.base = segment->m_vaddr;
-						ref->where.module.size = segment->m_vsize;
+						next_bit_index = window_end;
+						continue;
 					}
-					else if (segment->m_type == ENUM_HEAP)
-					{
-						if (CA_HEAP->is_heap_block(vaddr))
-						{
-							// otherwise, it is on heap
-							struct heap_block blk;
-							CA_HEAP->get_heap_block_info(vaddr, &blk);
-							// we generally don't care about free heap memory
-							if (blk.inuse || !g_skip_free)
-							{
-								valid_ref = true;
-								ref->where.heap.addr = blk.addr;
-								ref->where.heap.size = blk.size;
-								ref->where.heap.inuse = blk.inuse;
-							}
-						}
-						else	// it is in heap segment, but not recognized by allocator
-							ref->storage_type = ENUM_UNKNOWN;
-					}
-					// keep meaningful ref, and throw away undesired one
-					if (valid_ref || (!g_skip_unknown && ref->storage_type == ENUM_UNKNOWN))
-					{
-						refs.push_front(ref);
+				}
+                if(search_value_by_range(segment, &next_bit_index, window_end, matcher, target_is_ptr, &val, &vaddr))
+				{
+					// find a match in this segment
+					if (add_found_ref(segment, val, vaddr, sink))
 						lbFound = true;
-					}
-					else
-						delete ref;
 					next_bit_index++;
+					if (sink->stopped)
+					{
+						if (pinned)
+							unpin_core_range(segment->m_faddr + window_begin * ptr_sz,
+									(window_end - window_begin) * ptr_sz);
+						break;
+					}
+				}
+				else if (pinned)
+				{
+					unpin_core_range(segment->m_faddr + window_begin * ptr_sz,
+							(window_end - window_begin) * ptr_sz);
+					pinned = false;
+					next_bit_index = window_end;
 				}
 				else
 					break;
@@ -314,6 +908,24 @@ search_value_internal(const std::list<struct object_range*>& targets,
 	return lbFound;
 }
 
+/////////////////////////////////////////////////////////////////////////
+// Value search with found references inserted into output list
+//     the references are allocated from the query's arena
+// Return true if at least one is found
+/////////////////////////////////////////////////////////////////////////
+static bool
+search_value_internal(const std::list<struct object_range*>& targets,
+		bool target_is_ptr,
+		enum storage_type stype,
+		std::list<struct object_reference*>& refs,
+		ref_arena& arena)
+{
+	struct ref_list list = {&refs, &arena};
+	struct ref_sink sink = {ref_list_consumer, &list, false};
+
+	return search_value_sink(targets, target_is_ptr, stype, &sink);
+}
+
 // Given an address (ref->vaddr), figure out its proper storage type
 void
 fill_ref_location(struct object_reference* ref)
@@ -364,82 +976,359 @@ fill_ref_location(struct object_reference* ref)
 }
 
 /////////////////////////////////////////////////////////////////////////
-// Given an object, check whether its data member references the target
+// Global variables and heap blocks reachable from thread stacks
+//     each block is read once into the list of its words that hit the
+//     target or point to globals or heap, i.e. possible children.
+//     Whether a block references the target within a number of levels
+//     is memoized, so that a block shared by many paths is walked once
+//     per level, and paths are only followed if they end at the target.
 /////////////////////////////////////////////////////////////////////////
-static bool search_object_tree (std::list<struct object_reference*>& refs, address_t obj_vaddr, size_t obj_sz, size_t iLevel)
+#define TREE_CHILD_UNRESOLVED (-2)
+
+enum tree_reach
+{
+	REACH_UNKNOWN = 0,
+	REACH_NO,
+	REACH_YES
+};
+
+struct tree_word
+{
+	address_t vaddr;
+	address_t value;
+	int  child;		// index of the block it points to, -1 if none
+	bool hit;		// the value is in the target
+};
+
+struct tree_block
+{
+	struct ca_segment* segment;
+	address_t start;
+	address_t end;
+	struct object_reference ref;		// common part of refs of its words
+	bool loaded;
+	unsigned int dist;			// least levels to the target by the index, 0 if none
+	std::vector<struct tree_word> words;
+	std::vector<char> reach;		// enum tree_reach by levels
+};
+
+struct object_tree
+{
+	address_t obj_vaddr;
+	size_t obj_sz;
+	std::vector<struct tree_block> blocks;
+	std::unordered_map<address_t, int> block_index;	// start of a block => index
+	std::unordered_map<address_t, int> value_block;	// pointer value => index of its block, -1 if none
+	bool indexed;		// reachability is known by dist of blocks
+};
+
+// The global variable or in-use heap block that val points to, -1 if none
+static int tree_block_of(struct object_tree& tree, address_t val)
 {
 	size_t ptr_sz = g_ptr_bit >> 3;
-	bool rc = false;
-	struct object_reference* ref;
 	struct ca_segment* segment;
+	struct tree_block block;
 	address_t sym_addr;
 	size_t    sym_sz;
-	address_t cursor = 0;
-	address_t end = 0;
-	struct object_reference new_ref;
+	int index = -1;
 
-	ref = refs.front();
+	auto itr = tree.value_block.find(val);
+	if (itr != tree.value_block.end())
+		return itr->second;
 
-	segment = get_segment (ref->value, ptr_sz);
-	if (!segment)
-		return false;
-
-	// go deeper if the referenced value points to a global variable or an in-use heap block
-	if (segment->m_type == ENUM_MODULE_DATA && known_global_sym(ref, &sym_addr, &sym_sz))
+	memset(&block.ref, 0, sizeof(block.ref));
+	block.start = block.end = 0;
+	segment = get_segment (val, ptr_sz);
+	if (segment && segment->m_type == ENUM_MODULE_DATA)
 	{
-		cursor = sym_addr;
-		end    = sym_addr + sym_sz;
+		// the symbol that contains the value
+		struct object_reference aref;
+		memset(&aref, 0, sizeof(aref));
+		aref.storage_type = ENUM_MODULE_DATA;
+		aref.vaddr = val;
+		aref.value = val;
+		if (known_global_sym(&aref, &sym_addr, &sym_sz))
+		{
+			block.start = sym_addr;
+			block.end   = sym_addr + sym_sz;
+		}
 	}
-	else if (segment->m_type == ENUM_HEAP && CA_HEAP->is_heap_block(ref->value))
+	else if (segment && segment->m_type == ENUM_HEAP && CA_HEAP->is_heap_block(val))
 	{
 		struct heap_block blk;
-		CA_HEAP->get_heap_block_info(ref->value, &blk);
+		CA_HEAP->get_heap_block_info(val, &blk);
 		// we generally don't care about free heap memory
 		if (blk.inuse || !g_skip_free)
 		{
-			cursor = blk.addr;
-			end    = blk.addr + blk.size;
-			new_ref.where.heap.addr = blk.addr;
-			new_ref.where.heap.inuse = blk.inuse;
-			new_ref.where.heap.size = blk.size;
+			block.start = blk.addr;
+			block.end   = blk.addr + blk.size;
+			block.ref.where.heap.addr = blk.addr;
+			block.ref.where.heap.inuse = blk.inuse;
+			block.ref.where.heap.size = blk.size;
+		}
+	}
+
+	if (block.start && block.end)
+	{
+		auto found = tree.block_index.find(block.start);
+		if (found != tree.block_index.end())
+			index = found->second;
+		else
+		{
+			block.segment = segment;
+			block.ref.storage_type = segment->m_type;
+			block.loaded = false;
+			block.dist = 0;
+			index = tree.blocks.size();
+			tree.blocks.push_back(block);
+			tree.block_index[block.start] = index;
+		}
+	}
+	tree.value_block[val] = index;
+	return index;
+}
+
+// Read the block's words once
+static void load_tree_block(struct object_tree& tree, int index)
+{
+	size_t ptr_sz = g_ptr_bit >> 3;
+	struct tree_block& block = tree.blocks[index];
+	address_t cursor = block.start;
+	std::vector<char> buf;
+
+	block.loaded = true;
+	if (block.end < block.start + ptr_sz)
+		return;
+	buf.resize(block.end - block.start);
+	bool whole = read_memory_wrapper(block.segment, block.start, &buf[0], buf.size());
+	for (; cursor + ptr_sz <= block.end; cursor += ptr_sz)
+	{
+		struct tree_word word;
+		address_t val = 0;
+		if (whole)
+			memcpy(&val, &buf[cursor - block.start], ptr_sz);
+		else if (!read_memory_wrapper(block.segment, cursor, (void*)&val, ptr_sz))
+			break;
+		word.hit = val >= tree.obj_vaddr && val < tree.obj_vaddr + tree.obj_sz;
+		// only a global or a heap block may be a child
+		if (!word.hit)
+		{
+			struct ca_segment* segment = val ? get_segment(val, ptr_sz) : NULL;
+			if (!segment || (segment->m_type != ENUM_MODULE_DATA && segment->m_type != ENUM_HEAP))
+				continue;
 		}
+		word.vaddr = cursor;
+		word.value = val;
+		word.child = TREE_CHILD_UNRESOLVED;
+		block.words.push_back(word);
 	}
+}
+
+static enum tree_reach tree_reach_state(struct object_tree& tree, int index, size_t level)
+{
+	const std::vector<char>& reach = tree.blocks[index].reach;
+	return level < reach.size() ? (enum tree_reach) reach[level] : REACH_UNKNOWN;
+}
+
+static void set_tree_reach(struct object_tree& tree, int index, size_t level, enum tree_reach state)
+{
+	std::vector<char>& reach = tree.blocks[index].reach;
+	if (level >= reach.size())
+		reach.resize(level + 1, REACH_UNKNOWN);
+	reach[level] = state;
+}
 
-	if (cursor && end)
+// The block a word points to, only resolved when it is walked
+static int tree_word_child(struct object_tree& tree, int index, size_t word_index)
+{
+	int child = tree.blocks[index].words[word_index].child;
+	if (child == TREE_CHILD_UNRESOLVED)
 	{
-		new_ref.level = ref->level + 1;
-		new_ref.storage_type = segment->m_type;
-		// check each pointer/ref of the memory block
-		while (cursor + ptr_sz <= end)
+		// blocks may be reallocated
+		child = tree_block_of(tree, tree.blocks[index].words[word_index].value);
+		tree.blocks[index].words[word_index].child = child;
+	}
+	return child;
+}
+
+// Whether any word of the block references the target within the levels
+// Blocks are walked depth first with an explicit stack
+static bool tree_reaches(struct object_tree& tree, int root, size_t levels)
+{
+	struct reach_frame
+	{
+		int index;
+		size_t levels;
+		size_t next;
+	};
+	std::vector<struct reach_frame> stack;
+
+	if (tree.indexed)
+		return tree.blocks[root].dist && tree.blocks[root].dist <= levels;
+	if (tree_reach_state(tree, root, levels) == REACH_UNKNOWN)
+	{
+		struct reach_frame frame = {root, levels, 0};
+		stack.push_back(frame);
+	}
+	while (!stack.empty())
+	{
+		struct reach_frame& frame = stack.back();
+		enum tree_reach state = REACH_NO;
+		bool descend = false;
+
+		if (!tree.blocks[frame.index].loaded)
+			load_tree_block(tree, frame.index);
+		for (; frame.next < tree.blocks[frame.index].words.size(); frame.next++)
 		{
-			address_t val = 0;
-			if (!read_memory_wrapper(segment, cursor, (void*)&val, ptr_sz))
+			if (tree.blocks[frame.index].words[frame.next].hit)
+			{
+				state = REACH_YES;
 				break;
-			if (val >= obj_vaddr && val < obj_vaddr + obj_sz)
+			}
+			if (frame.levels > 1)
 			{
-				// find one match
-				rc = true;
-				new_ref.vaddr = cursor;
-				new_ref.value = val;
-				refs.push_front(&new_ref);
-				print_ref_chain (refs);
-				refs.pop_front();
+				int child = tree_word_child(tree, frame.index, frame.next);
+				if (child < 0)
+					continue;
+				enum tree_reach child_state = tree_reach_state(tree, child, frame.levels - 1);
+				if (child_state == REACH_YES)
+				{
+					state = REACH_YES;
+					break;
+				}
+				else if (child_state == REACH_UNKNOWN)
+				{
+					// resume at this word after the child is resolved
+					struct reach_frame child_frame = {child, frame.levels - 1, 0};
+					stack.push_back(child_frame);
+					descend = true;
+					break;
+				}
 			}
-			else if (iLevel > 1 && val)
+		}
+		if (!descend)
+		{
+			set_tree_reach(tree, frame.index, frame.levels, state);
+			stack.pop_back();
+		}
+	}
+	return tree_reach_state(tree, root, levels) == REACH_YES;
+}
+
+/*
+ * Blocks that reach the target within the levels are found backward by
+ * the reference index, level by level from the target. Others are never
+ * read.
+ */
+static void index_tree_reach(struct object_tree& tree, size_t levels)
+{
+	size_t ptr_sz = g_ptr_bit >> 3;
+	std::vector<struct ref_edge> edges;
+	std::vector<int> found;
+	size_t level;
+
+	ref_index_lookup(tree.obj_vaddr, tree.obj_vaddr + tree.obj_sz, edges);
+	for (level = 1; level <= levels && !edges.empty(); level++)
+	{
+		found.clear();
+		for (auto& edge : edges)
+		{
+			// the block that has the pointer
+			int index = tree_block_of(tree, edge.m_vaddr);
+			if (index < 0 || tree.blocks[index].dist
+				|| (edge.m_vaddr - tree.blocks[index].start) % ptr_sz
+				|| edge.m_vaddr + ptr_sz > tree.blocks[index].end)
+				continue;
+			tree.blocks[index].dist = level;
+			found.push_back(index);
+		}
+		edges.clear();
+		if (level < levels)
+		{
+			for (auto index : found)
+				ref_index_lookup(tree.blocks[index].start, tree.blocks[index].end, edges);
+		}
+	}
+	tree.indexed = true;
+}
+
+/////////////////////////////////////////////////////////////////////////
+// Given an object, check whether its data member references the target
+//     the object is what refs.front() points to. Every chain to the target
+//     is printed in the order of words of objects.
+/////////////////////////////////////////////////////////////////////////
+static bool search_object_tree (struct object_tree& tree, std::list<struct object_reference*>& refs, size_t iLevel)
+{
+	struct tree_frame
+	{
+		int index;
+		size_t levels;
+		size_t next;
+		struct object_reference ref;	// the word being walked
+	};
+	std::deque<struct tree_frame> stack;	// elements stay put while refs point to them
+	int root = tree_block_of(tree, refs.front()->value);
+
+	if (root < 0 || !tree_reaches(tree, root, iLevel))
+		return false;
+	if (!tree.blocks[root].loaded)
+		load_tree_block(tree, root);
+
+	struct tree_frame root_frame;
+	root_frame.index = root;
+	root_frame.levels = iLevel;
+	root_frame.next = 0;
+	root_frame.ref = tree.blocks[root].ref;
+	root_frame.ref.level = refs.front()->level + 1;
+	stack.push_back(root_frame);
+	while (!stack.empty())
+	{
+		struct tree_frame& frame = stack.back();
+
+		if (frame.next >= tree.blocks[frame.index].words.size())
+		{
+			stack.pop_back();
+			if (!stack.empty())
 			{
-				// user wants to dig deeper
-				new_ref.vaddr = cursor;
-				new_ref.value = val;
-				refs.push_front(&new_ref);
-				if (search_object_tree (refs, obj_vaddr, obj_sz, iLevel - 1))
-					rc = true;
 				refs.pop_front();
+				stack.back().next++;
+			}
+			continue;
+		}
+
+		const struct tree_word& word = tree.blocks[frame.index].words[frame.next];
+		frame.ref.vaddr = word.vaddr;
+		frame.ref.value = word.value;
+		if (word.hit)
+		{
+			// find one match
+			refs.push_front(&frame.ref);
+			print_ref_chain (refs);
+			refs.pop_front();
+		}
+		else if (frame.levels > 1)
+		{
+			// only dig into objects that lead to the target
+			int child = tree_word_child(tree, frame.index, frame.next);
+			if (child >= 0 && tree_reaches(tree, child, frame.levels - 1))
+			{
+				struct tree_frame child_frame;
+				if (!tree.blocks[child].loaded)
+					load_tree_block(tree, child);
+				child_frame.index = child;
+				child_frame.levels = frame.levels - 1;
+				child_frame.next = 0;
+				child_frame.ref = tree.blocks[child].ref;
+				child_frame.ref.level = frame.ref.level + 1;
+				refs.push_front(&frame.ref);
+				stack.push_back(child_frame);
+				continue;
 			}
-			cursor += ptr_sz;
 		}
+		frame.next++;
 	}
 
-	return rc;
+	return true;
 }
 
 /////////////////////////////////////////////////////////////////////////
@@ -466,6 +1355,18 @@ bool find_object_refs_on_threads(address_t obj_vaddr, size_t obj_sz, unsigned in
 	}
 
 	g_output_count = 0;
+	// objects reachable from stacks are shared by all threads
+	struct object_tree tree;
+	tree.obj_vaddr = obj_vaddr;
+	tree.obj_sz = obj_sz;
+	tree.indexed = false;
+	if (iLevel > 1 && g_debug_core)
+	{
+		struct object_range target = {obj_vaddr, obj_vaddr + obj_sz};
+		std::list<struct object_range*> targets(1, &target);
+		if (ref_index_covers(targets))
+			index_tree_reach(tree, iLevel - 1);
+	}
 	// search all threads' registers/stacks
 	for (i=0; i<g_segment_count; i++)
 	{
@@ -530,7 +1431,7 @@ bool find_object_refs_on_threads(address_t obj_vaddr, size_t obj_sz, unsigned in
 					{
 						std::list<struct object_reference *> refs;
 						refs.push_front(&ref);
-						if (search_object_tree (refs, obj_vaddr, obj_sz, iLevel - 1))
+						if (search_object_tree (tree, refs, iLevel - 1))
 							rc = true;
 						refs.clear();
 					}
@@ -553,6 +1454,7 @@ search_object_refs(address_t obj_vaddr, size_t obj_sz, unsigned int iLevel, enum
 	std::list<struct object_range*> targets;
 	std::list<struct object_reference*> result_list;
 	struct object_range target;
+	ref_arena arena;
 
 	// set up search target
 	target.low = obj_vaddr;
@@ -560,7 +1462,7 @@ search_object_refs(address_t obj_vaddr, size_t obj_sz, unsigned int iLevel, enum
 	targets.push_front(&target);
 
 	// invoke full-core memory search
-	if (search_value_internal(targets, false, stype, ref_list) )
+	if (search_value_internal(targets, false, stype, ref_list, arena) )
 	{
 		// References are found, eliminate unwanted and save the rest into result
 		for (auto ref : ref_list)
@@ -580,12 +1482,199 @@ search_object_refs(address_t obj_vaddr, size_t obj_sz, unsigned int iLevel, enum
 			}
 			if (!dup_heap_block)
 				result_list.push_front(ref);
-			else
-				free (ref);
 		}
 	}
+	// the result outlives the arena
+	for (auto& ref : result_list)
+		ref = new struct object_reference(*ref);
+
+	return result_list;
+}
+
+/////////////////////////////////////////////////////////////////////////
+// Search references to many targets with one pass over memory
+//     a found reference is given to every target that contains its value,
+//     each target's list is in the order of a search of the target alone
+/////////////////////////////////////////////////////////////////////////
+static std::vector<std::list<struct object_reference*>>
+search_value_by_targets(const std::vector<struct object_range>& objects,
+		bool target_is_ptr,
+		enum storage_type stype,
+		ref_arena& arena)
+{
+	std::vector<std::list<struct object_reference*>> result(objects.size());
+	std::vector<struct object_range> ranges(objects);
+	std::list<struct object_range*> targets;
+	std::list<struct object_reference*> ref_list;
+	std::vector<size_t> order;
+	std::vector<address_t> lows;
+	std::vector<address_t> max_highs;	// the highest end of objects up to the one in order
+	size_t i;
+
+	for (i = 0; i < ranges.size(); i++)
+	{
+		targets.push_back(&ranges[i]);
+		order.push_back(i);
+	}
+	// invoke full-core memory search once for all objects
+	if (targets.empty() || !search_value_internal(targets, target_is_ptr, stype, ref_list, arena))
+		return result;
+
+	std::sort(order.begin(), order.end(),
+		[&ranges](size_t a, size_t b) { return ranges[a].low < ranges[b].low; });
+	for (i = 0; i < order.size(); i++)
+	{
+		lows.push_back(ranges[order[i]].low);
+		if (i == 0 || ranges[order[i]].high > max_highs.back())
+			max_highs.push_back(ranges[order[i]].high);
+		else
+			max_highs.push_back(max_highs.back());
+	}
+
+	for (auto ref : ref_list)
+	{
+		bool owned = false;
+		// objects before k start at or below the value
+		size_t k = std::upper_bound(lows.begin(), lows.end(), ref->value) - lows.begin();
+		for (; k > 0 && max_highs[k - 1] > ref->value; k--)
+		{
+			const struct object_range& range = ranges[order[k - 1]];
+
+			if (ref->value < range.low || ref->value >= range.high)
+				continue;
+			result[order[k - 1]].push_back(owned ? arena.alloc(*ref) : ref);
+			owned = true;
+		}
+	}
+
+	return result;
+}
+
+/////////////////////////////////////////////////////////////////////////
+// Search references to many objects with one pass over memory
+//     each object's list is the same as search_object_refs() of the object
+/////////////////////////////////////////////////////////////////////////
+std::vector<std::list<struct object_reference*>>
+search_object_refs_batch(const std::vector<struct object_range>& objects, enum storage_type stype)
+{
+	ref_arena arena;
+	std::vector<std::list<struct object_reference*>> result =
+		search_value_by_targets(objects, false, stype, arena);
+
+	for (auto& refs : result)
+	{
+		std::list<struct object_reference*> result_list;
+		for (auto ref : refs)
+		{
+			// remove self/circular-reference heap block
+			bool dup_heap_block = false;
+			if (ref->storage_type == ENUM_HEAP)
+			{
+				for (auto cursor : result_list)
+				{
+					if (cursor->storage_type == ENUM_HEAP && cursor->where.heap.addr == ref->where.heap.addr)
+					{
+						dup_heap_block = true;
+						break;
+					}
+				}
+			}
+			// the result outlives the arena
+			if (!dup_heap_block)
+				result_list.push_front(new struct object_reference(*ref));
+		}
+		refs.swap(result_list);
+	}
+
+	return result;
+}
+
+/////////////////////////////////////////////////////////////////////////
+// Search references to objects listed in a file
+//     each line has an object address and optional size, both in hex.
+//     A heap block is searched as a whole if size is omitted.
+/////////////////////////////////////////////////////////////////////////
+bool find_object_refs_batch(const char* fname)
+{
+	std::vector<struct object_range> objects;
+	size_t nfound = 0;
+	size_t i;
+	char line[256];
+	FILE* fp;
+
+	fp = fopen(fname, "r");
+	if (!fp)
+	{
+		CA_PRINT("Failed to open file %s\n", fname);
+		return false;
+	}
+	while (fgets(line, sizeof(line), fp))
+	{
+		struct object_range range;
+		unsigned long long addr, size = 0;
+		struct heap_block blk;
+		char* cursor;
+		char* end;
+
+		addr = strtoull(line, &cursor, 16);
+		if (cursor == line)
+		{
+			// blank line or comment
+			if (line[strspn(line, " \t\r\n")] != '\0' && line[strspn(line, " \t")] != '#')
+				CA_PRINT("Ignore invalid line: %s", line);
+			continue;
+		}
+		size = strtoull(cursor, &end, 16);
+		end += strspn(end, " \t\r\n");
+		if (addr == 0 || (*end != '\0' && *end != '#'))
+		{
+			CA_PRINT("Ignore invalid line: %s", line);
+			continue;
+		}
+		range.low = addr;
+		range.high = addr + (size ? size : 1);
+		if (size == 0 && CA_HEAP->get_heap_block_info(addr, &blk) && blk.inuse)
+		{
+			range.low = blk.addr;
+			range.high = blk.addr + blk.size;
+		}
+		objects.push_back(range);
+	}
+	fclose(fp);
+	if (objects.empty())
+	{
+		CA_PRINT("No object address is found in file %s\n", fname);
+		return false;
+	}
+
+	CA_PRINT("Search for references to " PRINT_FORMAT_SIZE " objects\n", objects.size());
+	std::vector<std::list<struct object_reference*>> results = search_object_refs_batch(objects, ENUM_ALL);
+
+	{
+		std::vector<struct object_reference*> all_refs;
+		for (i = 0; i < results.size(); i++)
+			all_refs.insert(all_refs.end(), results[i].begin(), results[i].end());
+		symbolize_refs(all_refs);
+	}
+	clear_addr_type_map();
+	for (i = 0; i < objects.size(); i++)
+	{
+		if (results[i].empty())
+			continue;
+		nfound++;
+		CA_PRINT("------------------------- [" PRINT_FORMAT_POINTER ", " PRINT_FORMAT_POINTER ") -------------------------\n",
+				objects[i].low, objects[i].high);
+		for (auto ref : results[i])
+		{
+			print_ref(ref, 0, false, true);
+			delete ref;
+		}
+		CA_PRINT("\n");
+	}
+	clear_addr_type_map();
+	CA_PRINT(PRINT_FORMAT_SIZE " out of " PRINT_FORMAT_SIZE " objects are referenced\n", nfound, objects.size());
 
-	return result_list;
+	return nfound > 0;
 }
 
 /////////////////////////////////////////////////////////////////////////
@@ -597,18 +1686,21 @@ bool find_object_refs(address_t obj_vaddr, size_t obj_sz, unsigned int iLevel)
 	unsigned int i, n;
 	struct object_reference* ref;
 	std::list<struct object_reference*> ref_list;
+	struct object_reference target_ref;
+	ref_arena arena;
 
 	// references are placed in an array
 	std::vector<struct object_reference*> refs;
 
 	// the 1st element is the searched target
-	ref = new struct object_reference;
-	ref->level = 0;
-	ref->target_index = -1;
-	ref->storage_type = ENUM_UNKNOWN;
-	ref->vaddr        = obj_vaddr;
-	ref->value        = 0;
-	ref->where.target.size = obj_sz;
+	memset(&target_ref, 0, sizeof(target_ref));
+	target_ref.level = 0;
+	target_ref.target_index = -1;
+	target_ref.storage_type = ENUM_UNKNOWN;
+	target_ref.vaddr        = obj_vaddr;
+	target_ref.value        = 0;
+	target_ref.where.target.size = obj_sz;
+	ref = arena.alloc(target_ref);
 	refs.push_back(ref);
 	//fill_ref_location(ref);
 
@@ -640,7 +1732,7 @@ bool find_object_refs(address_t obj_vaddr, size_t obj_sz, unsigned int iLevel)
 				targets.push_front(&target);
 				// invoke full-core memory search
 				// ref_list shall be empty at this point
-				if (search_value_internal(targets, target_is_ptr, ENUM_ALL, ref_list) )
+				if (search_value_internal(targets, target_is_ptr, ENUM_ALL, ref_list, arena) )
 				{
 					for (auto aref : ref_list)
 					{
@@ -665,8 +1757,6 @@ bool find_object_refs(address_t obj_vaddr, size_t obj_sz, unsigned int iLevel)
 							aref->target_index = i;
 							refs.push_back(aref);
 						}
-						else
-							delete aref;
 					}
 					ref_list.clear();
 				}
@@ -682,6 +1772,7 @@ bool find_object_refs(address_t obj_vaddr, size_t obj_sz, unsigned int iLevel)
 		int cur_level = iLevel;
 		int indent = 0;
 		int prev_target = refs[ref_cursor]->target_index;
+		symbolize_refs(refs);
 		CA_PRINT("------------------------- Level %d -------------------------\n", cur_level);
 		clear_addr_type_map();
 		while (ref_cursor>0 && cur_level>0)
@@ -724,15 +1815,121 @@ bool find_object_refs(address_t obj_vaddr, size_t obj_sz, unsigned int iLevel)
 		clear_addr_type_map();
 	}
 
-	// clean up
-	for (auto aref : refs)
-		delete aref;
-
 	if (refs.size() > 1)
 		return true;
 	return false;
 }
 
+/////////////////////////////////////////////////////////////////////////
+// Deep search of find_object_type() and get_object_type_name()
+//     levels are searched breadth first. All candidates of a level are
+//     searched with one pass over memory, and found references are then
+//     examined candidate by candidate from the last one, as if each was
+//     searched alone.
+// Return true if a known symbol is found, *levels is the number of
+// levels searched
+/////////////////////////////////////////////////////////////////////////
+static bool
+search_object_type_levels(std::vector<struct object_reference*>& refs, unsigned int* levels,
+		ref_arena& arena)
+{
+	bool lbFound = false;
+	unsigned int n;
+
+	for (n=0; !lbFound && n<g_max_indirection_level; n++)
+	{
+		int vec_sz = refs.size();
+		int i;
+		size_t k;
+		bool target_is_ptr = true;
+		std::vector<struct object_range> targets;
+
+		if (refs[vec_sz-1]->level != n)	// no more candidate to search
+			break;
+
+		for (i=vec_sz-1; i>=0 && refs[i]->level==n; i--)
+		{
+			struct object_reference* ref = refs[i];
+			struct object_range target;
+			target.low = ref->vaddr;
+			target.high = target.low + 1;
+			// searched target can only be heap block or unknown
+			if (ref->storage_type == ENUM_HEAP)
+			{
+				target.low = ref->where.heap.addr;
+				target.high = target.low + ref->where.heap.size;
+			}
+			else if (ref->target_index < 0)
+			{
+				target_is_ptr = false;
+				target.high = target.low + ref->where.target.size;
+			}
+			targets.push_back(target);
+		}
+
+		// invoke full-core memory search once for the level
+		std::vector<std::list<struct object_reference*>> ref_lists =
+			search_value_by_targets(targets, target_is_ptr, ENUM_ALL, arena);
+
+		for (k=0, i=vec_sz-1; k<ref_lists.size(); k++, i--)
+		{
+			std::list<struct object_reference*>& ref_list = ref_lists[k];
+			// candidates after the one with a known symbol are dropped
+			if (lbFound)
+				continue;
+			// first scan for known symbol
+			std::set<struct object_reference*> validRefs;
+			for (auto aref : ref_list) {
+				if ( (aref->storage_type == ENUM_STACK && aref->where.stack.frame >= 0)
+					|| aref->storage_type == ENUM_REGISTER
+					|| aref->storage_type == ENUM_MODULE_DATA
+					|| (aref->storage_type==ENUM_HEAP && aref->where.heap.inuse && known_heap_block(aref)) )
+				{
+					// find a known symbol that references the target address
+					lbFound = true;
+					validRefs.insert(aref);
+				}
+			}
+			if (!lbFound) {
+				// second scan if none of the refs is good
+				// select proper refs as the next-level search targets
+				for (auto aref : ref_list) {
+					// only consider in-use heap block
+					if (aref->storage_type == ENUM_HEAP && aref->where.heap.inuse) {
+						// remove self-reference
+						bool selfRef = false;
+						for (int refidx=refs.size()-1; refidx>=0; refidx--)
+						{
+							const struct object_reference* cursor = refs[refidx];
+							if (cursor->storage_type == ENUM_HEAP && cursor->where.heap.addr == aref->where.heap.addr)
+							{
+								selfRef = true;
+								break;
+							}
+						}
+						if (!selfRef)
+							validRefs.insert(aref);
+					} else if (aref->storage_type == ENUM_MODULE_TEXT) {
+						if (!global_text_ref(aref))
+							validRefs.insert(aref);
+					}
+				}
+			}
+			for (auto aref : ref_list) {
+				// append the valid refs as either result or targets of the next-level search
+				if (validRefs.find(aref) != validRefs.end()) {
+					aref->level = n + 1;
+					aref->target_index = i;
+					refs.push_back(aref);
+				}
+			}
+		}
+	}
+	*levels = n;
+
+	return lbFound;
+}
+
 /////////////////////////////////////////////////////////////////////////
 // Vertical search.
 //     Find a recognizable object to identify the type associated with
@@ -744,7 +1941,8 @@ bool find_object_type(address_t obj_vaddr)
 	int i;
 	unsigned int n;
 	struct object_reference* ref;
-	std::list<struct object_reference*> ref_list;
+	struct object_reference target_ref;
+	ref_arena arena;
 
 	// references are placed in an array
 	std::vector<struct object_reference*> refs;
@@ -757,13 +1955,14 @@ bool find_object_type(address_t obj_vaddr)
 	}
 
 	// the 1st element is the searched target
-	ref = new struct object_reference;
-	ref->level = 0;
-	ref->target_index = -1;
-	ref->storage_type = ENUM_UNKNOWN;
-	ref->vaddr        = obj_vaddr;
-	ref->value        = 0;
-	ref->where.target.size = 1;
+	memset(&target_ref, 0, sizeof(target_ref));
+	target_ref.level = 0;
+	target_ref.target_index = -1;
+	target_ref.storage_type = ENUM_UNKNOWN;
+	target_ref.vaddr        = obj_vaddr;
+	target_ref.value        = 0;
+	target_ref.where.target.size = 1;
+	ref = arena.alloc(target_ref);
 	refs.push_back(ref);
 
 	fill_ref_location(ref);
@@ -793,90 +1992,7 @@ bool find_object_type(address_t obj_vaddr)
 	else
 	{
 		// Deep search of heap objects
-		for (n=0; !lbFound && n<g_max_indirection_level; n++)
-		{
-			int vec_sz = refs.size();
-			if (refs[vec_sz-1]->level != n)	// no more candidate to search
-				break;
-
-			for (i=vec_sz-1; !lbFound && i>=0 && refs[i]->level==n; i--)
-			{
-				bool target_is_ptr = true;
-				std::list<struct object_range*> targets;
-				struct object_range target;
-				target.low = ref->vaddr;
-				target.high = target.low + 1;
-				// searched target can only be heap block or unknown
-				ref = refs[i];
-				if (ref->storage_type == ENUM_HEAP)
-				{
-					target.low = ref->where.heap.addr;
-					target.high = target.low + ref->where.heap.size;
-				}
-				else if (ref->target_index < 0)
-				{
-					target_is_ptr = false;
-					target.high = target.low + ref->where.target.size;
-				}
-				targets.push_front(&target);
-
-				// invoke full-core memory search
-				if (search_value_internal(targets, target_is_ptr, ENUM_ALL, ref_list) )
-				{
-					// first scan for known symbol
-					std::set<struct object_reference*> validRefs;
-					for (auto aref : ref_list) {
-						if ( (aref->storage_type == ENUM_STACK && aref->where.stack.frame >= 0)
-							|| aref->storage_type == ENUM_REGISTER
-							|| aref->storage_type == ENUM_MODULE_DATA
-							|| (aref->storage_type==ENUM_HEAP && aref->where.heap.inuse && known_heap_block(aref)) )
-						{
-							// find a known symbol that references the target address
-							lbFound = true;
-							validRefs.insert(aref);
-						}
-					}
-					if (!lbFound) {
-						// second scan if none of the refs is good
-						// select proper refs as the next-level search targets
-						for (auto aref : ref_list) {
-							// only consider in-use heap block
-							if (aref->storage_type == ENUM_HEAP && aref->where.heap.inuse) {
-								// remove self-reference
-								bool selfRef = false;
-								for (int refidx=refs.size()-1; refidx>=0; refidx--)
-								{
-									const struct object_reference* cursor = refs[refidx];
-									if (cursor->storage_type == ENUM_HEAP && cursor->where.heap.addr == aref->where.heap.addr)
-									{
-										selfRef = true;
-										break;
-									}
-								}
-								if (!selfRef)
-									validRefs.insert(aref);
-							} else if (aref->storage_type == ENUM_MODULE_TEXT) {
-								if (!global_text_ref(aref))
-									validRefs.insert(aref);
-							}
-						}
-					}
-					for (auto aref : ref_list) {
-						// append the valid refs as either result or targets of the next-level search
-						if (validRefs.find(aref) != validRefs.end()) {
-							aref->level = n + 1;
-							aref->target_index = i;
-							refs.push_back(aref);
-						} else {
-							// free others
-							delete aref;
-						}
-					}
-				}
-				ref_list.clear();
-			}
-		}
-		ref_list.clear();
+		lbFound = search_object_type_levels(refs, &n, arena);
 
 		if (n == g_max_indirection_level)
 			CA_PRINT("Warning: max levels of indirection %d has been reached\n", g_max_indirection_level);
@@ -915,10 +2031,6 @@ bool find_object_type(address_t obj_vaddr)
 	}
 	clear_addr_type_map();
 
-	// clean up
-	for (auto aref : refs)
-		delete aref;
-
 	return lbFound;
 }
 
@@ -934,7 +2046,8 @@ std::string get_object_type_name(address_t obj_vaddr)
 	int i;
 	unsigned int n;
 	struct object_reference* ref;
-	std::list<struct object_reference*> ref_list;
+	struct object_reference target_ref;
+	ref_arena arena;
 
 	// references are placed in an array
 	std::vector<struct object_reference*> refs;
@@ -948,13 +2061,14 @@ std::string get_object_type_name(address_t obj_vaddr)
 	}
 
 	// the 1st element is the searched target
-	ref = new struct object_reference;
-	ref->level = 0;
-	ref->target_index = -1;
-	ref->storage_type = ENUM_UNKNOWN;
-	ref->vaddr        = obj_vaddr;
-	ref->value        = 0;
-	ref->where.target.size = 1;
+	memset(&target_ref, 0, sizeof(target_ref));
+	target_ref.level = 0;
+	target_ref.target_index = -1;
+	target_ref.storage_type = ENUM_UNKNOWN;
+	target_ref.vaddr        = obj_vaddr;
+	target_ref.value        = 0;
+	target_ref.where.target.size = 1;
+	ref = arena.alloc(target_ref);
 	refs.push_back(ref);
 
 	fill_ref_location(ref);
@@ -972,90 +2086,7 @@ std::string get_object_type_name(address_t obj_vaddr)
 	else
 	{
 		// Deep search of heap objects
-		for (n=0; !lbFound && n<g_max_indirection_level; n++)
-		{
-			int vec_sz = refs.size();
-			if (refs[vec_sz-1]->level != n)	// no more candidate to search
-				break;
-
-			for (i=vec_sz-1; !lbFound && i>=0 && refs[i]->level==n; i--)
-			{
-				bool target_is_ptr = true;
-				std::list<struct object_range*> targets;
-				struct object_range target;
-				target.low = ref->vaddr;
-				target.high = target.low + 1;
-				// searched target can only be heap block or unknown
-				ref = refs[i];
-				if (ref->storage_type == ENUM_HEAP)
-				{
-					target.low = ref->where.heap.addr;
-					target.high = target.low + ref->where.heap.size;
-				}
-				else if (ref->target_index < 0)
-				{
-					target_is_ptr = false;
-					target.high = target.low + ref->where.target.size;
-				}
-				targets.push_front(&target);
-
-				// invoke full-core memory search
-				if (search_value_internal(targets, target_is_ptr, ENUM_ALL, ref_list) )
-				{
-					// first scan for known symbol
-					std::set<struct object_reference*> validRefs;
-					for (auto aref : ref_list) {
-						if ( (aref->storage_type == ENUM_STACK && aref->where.stack.frame >= 0)
-							|| aref->storage_type == ENUM_REGISTER
-							|| aref->storage_type == ENUM_MODULE_DATA
-							|| (aref->storage_type==ENUM_HEAP && aref->where.heap.inuse && known_heap_block(aref)) )
-						{
-							// find a known symbol that references the target address
-							lbFound = true;
-							validRefs.insert(aref);
-						}
-					}
-					if (!lbFound) {
-						// second scan if none of the refs is good
-						// select proper refs as the next-level search targets
-						for (auto aref : ref_list) {
-							// only consider in-use heap block
-							if (aref->storage_type == ENUM_HEAP && aref->where.heap.inuse) {
-								// remove self-reference
-								bool selfRef = false;
-								for (int refidx=refs.size()-1; refidx>=0; refidx--)
-								{
-									const struct object_reference* cursor = refs[refidx];
-									if (cursor->storage_type == ENUM_HEAP && cursor->where.heap.addr == aref->where.heap.addr)
-									{
-										selfRef = true;
-										break;
-									}
-								}
-								if (!selfRef)
-									validRefs.insert(aref);
-							} else if (aref->storage_type == ENUM_MODULE_TEXT) {
-								if (!global_text_ref(aref))
-									validRefs.insert(aref);
-							}
-						}
-					}
-					for (auto aref : ref_list) {
-						// append the valid refs as either result or targets of the next-level search
-						if (validRefs.find(aref) != validRefs.end()) {
-							aref->level = n + 1;
-							aref->target_index = i;
-							refs.push_back(aref);
-						} else {
-							// free others
-							delete aref;
-						}
-					}
-				}
-				ref_list.clear();
-			}
-		}
-		ref_list.clear();
+		lbFound = search_object_type_levels(refs, &n, arena);
 
 		//if (n == g_max_indirection_level)
 		//	CA_PRINT("Warning: max levels of indirection %d has been reached\n", g_max_indirection_level);
@@ -1094,12 +2125,64 @@ std::string get_object_type_name(address_t obj_vaddr)
 	}
 	clear_addr_type_map();
 
-	// clean up
-	for (auto aref : refs)
-		delete aref;
     return type_name;
 }
 
+/////////////////////////////////////////////////////////////////////////
+// C++ objects are picked out of references to their vtables as they are
+// found, so that references to a popular vtable are never held at once
+/////////////////////////////////////////////////////////////////////////
+struct cplusplus_objects
+{
+	size_t type_sz;
+	std::unordered_set<address_t> unique_refs;
+	std::list<struct object_reference*>* result;	// found objects are printed if NULL
+	size_t count;
+	size_t max_count;	// stop the search after so many objects, no limit if 0
+};
+
+static bool
+cplusplus_object_consumer(const struct object_reference* aref, void* ctx)
+{
+	struct cplusplus_objects* objects = (struct cplusplus_objects*) ctx;
+	address_t var_addr = 0;
+	size_t    var_size = 0;
+	address_t obj_addr;
+
+	// avoid slicing of heap object and duplicate
+	if (aref->storage_type == ENUM_HEAP)
+		obj_addr = aref->where.heap.addr;
+	else
+		obj_addr = aref->vaddr;
+	if (!objects->unique_refs.insert(obj_addr).second)
+		return true;
+
+	// ignore register object
+	if (aref->storage_type == ENUM_REGISTER)
+		return true;
+	// ignore unknown global (it may be reference from linker generated objects, like import/export items)
+	/*else if ( ((aref->storage_type == ENUM_MODULE_TEXT || aref->storage_type == ENUM_MODULE_DATA)
+			&& !known_global_sym(aref, NULL, NULL)) )
+	{
+	}*/
+	// ignore all globals to avoid red herrings, e.g. gcc compiler generates global object of "VTT for some_class"
+	else if (aref->storage_type == ENUM_MODULE_TEXT || aref->storage_type == ENUM_MODULE_DATA)
+		return true;
+	// skip known stack variable which is not a pointer type
+	else if (aref->storage_type == ENUM_STACK
+			&& (!known_stack_sym(aref, &var_addr, &var_size) || var_size != objects->type_sz))
+		return true;
+
+	struct object_reference ref = *aref;
+	ref.value = 0;
+	objects->count++;
+	if (objects->result)
+		objects->result->push_back(new struct object_reference(ref));
+	else
+		print_ref(&ref, 1, false, false);	// print out object
+	return objects->max_count == 0 || objects->count < objects->max_count;
+}
+
 /////////////////////////////////////////////////////////////////////////
 // Return a list of C++ objects with _vptr to the type of the input expression
 //   the caller is responsible to release the list and its elements
@@ -1113,57 +2196,14 @@ std::list<struct object_reference*> search_cplusplus_objects_with_vptr(const cha
 
 	if (get_vtable_from_exp(exp, vtables, type_name, NAME_BUF_SZ, &type_sz))
 	{
-		std::list<struct object_reference*>	ref_list;
-
-    	if (search_value_internal(vtables, true, ENUM_ALL, ref_list) )
-    	{
-			std::set<address_t> unique_refs;
-
-    		// go through all found objects
-			for (auto ref : ref_list)
-    		{
-				address_t obj_addr;
-    			bool delete_ref = true;
-				// avoid slicing of heap object
-				if (ref->storage_type == ENUM_HEAP)
-					obj_addr = ref->where.heap.addr;
-				else
-					obj_addr = ref->vaddr;
-
-				if (unique_refs.find(obj_addr) == unique_refs.end())
-				{
-					address_t var_addr;
-					size_t    var_size;
-
-					unique_refs.insert(obj_addr);
-					// ignore register object
-					if (ref->storage_type == ENUM_REGISTER)
-					{
-					}
-					// ignore unknown global (it may be reference from linker generated objects, like import/export items)
-					/*else if ( ((ref->storage_type == ENUM_MODULE_TEXT || ref->storage_type == ENUM_MODULE_DATA)
-							&& !known_global_sym(ref, NULL, NULL)) )
-					{
-					}*/
-					else if (ref->storage_type == ENUM_MODULE_TEXT || ref->storage_type == ENUM_MODULE_DATA)
-					{
-					}
-					// skip known stack variable which is not a pointer type
-					else if (ref->storage_type == ENUM_STACK
-							&& (!known_stack_sym(ref, &var_addr, &var_size) || var_size != type_sz))
-					{
-					}
-					else
-					{
-	    				ref->value = 0;
-						result_list.push_front(ref);
-						delete_ref = false;
-					}
-				}
-    			if (delete_ref)
-    				free (ref);
-    		}
-    	}
+		struct cplusplus_objects objects;
+		objects.type_sz = type_sz;
+		objects.result = &result_list;
+		objects.count = 0;
+		objects.max_count = 0;
+		struct ref_sink sink = {cplusplus_object_consumer, &objects, false};
+
+		search_value_sink(vtables, true, ENUM_ALL, &sink);
 	}
 
 	// clean up vtables
@@ -1175,8 +2215,10 @@ std::list<struct object_reference*> search_cplusplus_objects_with_vptr(const cha
 
 /////////////////////////////////////////////////////////////////////////
 // search C++ objects and references to them by the type of the input expression
+//     at most max_count objects are shown if it is not 0
 /////////////////////////////////////////////////////////////////////////
-bool search_cplusplus_objects_and_references(const char* exp, bool search_ref, bool thread_scope)
+bool search_cplusplus_objects_and_references(const char* exp, bool search_ref, bool thread_scope,
+		size_t max_count)
 {
 	bool lbFound = false;
 	std::list<struct object_range*> vtables;
@@ -1185,7 +2227,6 @@ bool search_cplusplus_objects_and_references(const char* exp, bool search_ref, b
 
 	if (get_vtable_from_exp(exp, vtables, type_name, NAME_BUF_SZ, &type_sz))
 	{
-		std::list<struct object_reference*> ref_list;
 		struct object_range* target;
 
 		CA_PRINT ("Searching objects of type=\"%s\" size=%ld ",	type_name, type_sz);
@@ -1203,58 +2244,20 @@ bool search_cplusplus_objects_and_references(const char* exp, bool search_ref, b
 			CA_PRINT ("\n");
 		}
 
-    	if (search_value_internal(vtables, true, ENUM_ALL, ref_list) )
-    	{
-    		std::set<address_t> unique_refs;
-			size_t obj_count = 0;
-    		// show found objects
-			for (auto ref : ref_list)
-    		{
-				address_t var_addr = 0;
-				size_t    var_size = 0;
-				address_t obj_addr;
-
-				// avoid duplicate
-				if (ref->storage_type == ENUM_HEAP)
-					obj_addr = ref->where.heap.addr;
-				else
-					obj_addr = ref->vaddr;
-				if (unique_refs.find(obj_addr) != unique_refs.end())
-					continue;
-				else {
-					unique_refs.insert(obj_addr);
-				}
+		// show found objects as they are found
+		struct cplusplus_objects objects;
+		objects.type_sz = type_sz;
+		objects.result = NULL;
+		objects.count = 0;
+		objects.max_count = max_count;
+		struct ref_sink sink = {cplusplus_object_consumer, &objects, false};
 
-				// ignore register object
-    			if (ref->storage_type == ENUM_REGISTER)
-    			{
-    			}
-    			// ignore unknown global (it may be reference from linker generated objects, like import/export items)
-    			/*else if ( ((ref->storage_type == ENUM_MODULE_TEXT || ref->storage_type == ENUM_MODULE_DATA)
-    					&& !known_global_sym(ref, NULL, NULL)) )
-    			{
-    			}*/
-    			// ignore all globals to avoid red herrings, e.g. gcc compiler generates global object of "VTT for some_class"
-    			else if (ref->storage_type == ENUM_MODULE_TEXT || ref->storage_type == ENUM_MODULE_DATA)
-    			{
-    			}
-    			// skip known stack variable which is not a pointer type
-    			else if (ref->storage_type == ENUM_STACK
-    					&& (!known_stack_sym(ref, &var_addr, &var_size) || var_size != type_sz))
-    			{
-    			}
-    			else
-    			{
-					obj_count++;
-					// print out object
-    				ref->value = 0;
-					print_ref(ref, 1, false, false);
-    			}
-    			// release this found item and move on to the next
-    			free (ref);
-    		}
-			CA_PRINT("Total objects found: " PRINT_FORMAT_SIZE "\n", obj_count);
-    		ref_list.clear();
+    	if (search_value_sink(vtables, true, ENUM_ALL, &sink) )
+    	{
+			if (sink.stopped)
+				CA_PRINT("Search stopped after " PRINT_FORMAT_SIZE " objects\n", objects.count);
+			else
+				CA_PRINT("Total objects found: " PRINT_FORMAT_SIZE "\n", objects.count);
     	}
     	else
     		CA_PRINT ("No objects are found\n");
@@ -1273,78 +2276,219 @@ bool search_cplusplus_objects_and_references(const char* exp, bool search_ref, b
 	return lbFound;
 }
 
-static void
-find_shared_objects_one_thread(struct ca_segment* segment, bool ignore_new_shrobj)
+/////////////////////////////////////////////////////////////////////////
+// Count in-use heap blocks by the class of their vptr
+//	the first word of each block is looked up in the index of all vtables
+/////////////////////////////////////////////////////////////////////////
+struct census_stat
 {
-	size_t ptr_sz = g_ptr_bit >> 3;
-	int k, nread;
-	struct shared_object* shrobj;
-	struct object_reference* aref;
-	address_t cursor, end;
+	const char* name;
+	size_t count;
+	size_t bytes;
+};
 
-	// static buffer for all register values
-	if (g_nregs == 0)
+static bool census_stat_comp(const struct census_stat& a, const struct census_stat& b)
+{
+	if (a.bytes != b.bytes)
+		return a.bytes > b.bytes;
+	return a.count > b.count;
+}
+
+// The vtable that vptr points into, NULL if none
+static const struct vtable_range*
+find_vtable(const std::vector<struct vtable_range>& vtables, address_t vptr)
+{
+	auto itr = std::upper_bound(vtables.begin(), vtables.end(), vptr,
+			[](address_t v, const struct vtable_range& r) { return v < r.low; });
+	if (itr == vtables.begin() || vptr >= (--itr)->high)
+		return NULL;
+	return &*itr;
+}
+
+bool census_cplusplus_objects(void)
+{
+	const std::vector<struct vtable_range>& vtables = get_vtable_index();
+	size_t ptr_sz = g_ptr_bit >> 3;
+	unsigned long total_blocks = 0;
+	struct inuse_block* blocks;
+	address_t vtables_low, vtables_high = 0;
+	size_t nchunks, i;
+	size_t total_count = 0, total_bytes = 0;
+	std::atomic<bool> abort(false);
+
+	if (vtables.empty())
 	{
-		g_nregs = read_registers (NULL, NULL, 0);
-		g_regs_buf = new struct reg_value[g_nregs];
+		CA_PRINT("No vtable symbol is found\n");
+		return false;
 	}
-
-	// read register values of this thread context
-	nread = read_registers (segment, g_regs_buf, g_nregs);
-	for (k=0; k<nread; k++)
+	blocks = build_inuse_heap_blocks(&total_blocks);
+	if (!blocks || total_blocks == 0)
+	{
+		CA_PRINT("Failed: no in-use heap block is found\n");
+		return false;
+	}
+	vtables_low = vtables.front().low;
+	for (auto& vtable : vtables)
 	{
-		if (g_regs_buf[k].reg_width == ptr_sz && g_regs_buf[k].value)
+		if (vtable.high > vtables_high)
+			vtables_high = vtable.high;
+	}
+
+	// each chunk of blocks counts by the index of vtables
+	nchunks = (total_blocks + CENSUS_CHUNK_BLOCKS - 1) / CENSUS_CHUNK_BLOCKS;
+	std::vector<std::unordered_map<size_t, struct census_stat>> chunk_stats(nchunks);
+	std::thread::id caller = std::this_thread::get_id();
+	auto census_chunk = [&](size_t k) {
+		std::unordered_map<size_t, struct census_stat>& stats = chunk_stats[k];
+		struct ca_segment* segment = NULL;
+		size_t begin = k * CENSUS_CHUNK_BLOCKS;
+		size_t end = begin + CENSUS_CHUNK_BLOCKS < total_blocks ? begin + CENSUS_CHUNK_BLOCKS : total_blocks;
+		size_t n;
+
+		if (abort)
+			return;
+		if (std::this_thread::get_id() == caller && user_request_break())
+		{
+			abort = true;
+			return;
+		}
+		for (n = begin; n < end; n++)
 		{
-			shrobj = add_one_shared_object(g_regs_buf[k].value, ignore_new_shrobj, 1);
-			if (shrobj)
+			const struct inuse_block* blk = &blocks[n];
+			address_t vptr = 0;
+
+			if (blk->size < ptr_sz)
+				continue;
+			// blocks are sorted, so a segment is shared by neighbors.
+			// A core is read through the block's own segment by all threads
+			if (g_debug_core
+				&& (!segment || blk->addr < segment->m_vaddr
+					|| blk->addr + ptr_sz > segment->m_vaddr + segment->m_fsize))
 			{
-				aref = new struct object_reference;
-				memset(aref, 0, sizeof(struct object_reference));
-				aref->value = g_regs_buf[k].value;
-				aref->storage_type = ENUM_REGISTER;
-				aref->where.reg.tid = segment->m_thread.tid;
-				aref->where.reg.reg_num = k;
-				shrobj->thread_owners.push_front(aref);
+				segment = get_segment(blk->addr, ptr_sz);
+				if (!segment || blk->addr + ptr_sz > segment->m_vaddr + segment->m_fsize)
+				{
+					segment = NULL;
+					continue;
+				}
 			}
+			if (!read_memory_wrapper(segment, blk->addr, &vptr, ptr_sz)
+				|| vptr < vtables_low || vptr >= vtables_high)
+				continue;
+			const struct vtable_range* vtable = find_vtable(vtables, vptr);
+			if (!vtable)
+				continue;
+			struct census_stat& stat = stats[vtable - &vtables[0]];
+			stat.name = vtable->name;
+			stat.count++;
+			stat.bytes += blk->size;
+		}
+	};
+	if (g_debug_core)
+		CA_THREAD_POOL.parallel_for(nchunks, census_chunk);
+	else
+	{
+		// a live process is read by the main thread
+		for (i = 0; i < nchunks && !abort; i++)
+			census_chunk(i);
+	}
+	if (abort)
+	{
+		CA_PRINT("Abort census\n");
+		return false;
+	}
+
+	// classes of the same name in different modules are merged
+	std::unordered_map<const char*, struct census_stat> class_stats;
+	for (auto& stats : chunk_stats)
+	{
+		for (auto& itr : stats)
+		{
+			struct census_stat& stat = class_stats[itr.second.name];
+			stat.name = itr.second.name;
+			stat.count += itr.second.count;
+			stat.bytes += itr.second.bytes;
+		}
+	}
+	std::vector<struct census_stat> sorted;
+	sorted.reserve(class_stats.size());
+	for (auto& itr : class_stats)
+		sorted.push_back(itr.second);
+	std::sort(sorted.begin(), sorted.end(), census_stat_comp);
+
+	for (i = 0; i < sorted.size(); i++)
+	{
+		const struct census_stat& stat = sorted[i];
+		CA_PRINT("[" PRINT_FORMAT_SIZE "] %s: " PRINT_FORMAT_SIZE " objects ", i + 1, stat.name, stat.count);
+		print_size(stat.bytes);
+		CA_PRINT(" (average " PRINT_FORMAT_SIZE " bytes)\n", stat.bytes / stat.count);
+		total_count += stat.count;
+		total_bytes += stat.bytes;
+	}
+	CA_PRINT("Total " PRINT_FORMAT_SIZE " objects of " PRINT_FORMAT_SIZE " classes ", total_count, sorted.size());
+	print_size(total_bytes);
+	CA_PRINT(" in %ld in-use blocks\n", total_blocks);
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////
+// Words of a thread's stack above its stack pointer that point to heap
+// blocks or globals. Thread-safe for a core.
+/////////////////////////////////////////////////////////////////////////
+static void
+scan_thread_stack(struct ca_segment* segment, address_t rsp, std::vector<struct shrobj_hit>& hits)
+{
+	size_t ptr_sz = g_ptr_bit >> 3;
+	address_t cursor = rsp;
+	address_t end = segment->m_vaddr + segment->m_fsize;
+
+	if (cursor < segment->m_vaddr || cursor >= segment->m_vaddr + segment->m_vsize)
+		cursor = segment->m_vaddr;
+	for (; cursor + ptr_sz <= end; cursor += ptr_sz)
+	{
+		struct shrobj_hit hit;
+		address_t value = 0;
+
+		if (!read_memory_wrapper(segment, cursor, (void*)&value, ptr_sz))
+			break;
+		if (value && prescan_shared_object(value, &hit))
+		{
+			hit.vaddr = cursor;
+			hit.value = value;
+			hit.reg_num = -1;
+			hits.push_back(hit);
 		}
 	}
+}
+
+// Registers of a thread that point to heap blocks or globals
+static void
+scan_thread_registers(struct ca_segment* segment, std::vector<struct shrobj_hit>& hits)
+{
+	size_t ptr_sz = g_ptr_bit >> 3;
+	int k, nread;
+
+	// static buffer for all register values
+	if (g_nregs == 0)
+	{
+		g_nregs = read_registers (NULL, NULL, 0);
+		g_regs_buf = new struct reg_value[g_nregs];
+	}
 
-	// stack memory
-	cursor = get_rsp(segment);
-	end    = segment->m_vaddr + segment->m_fsize;
-	if (cursor < segment->m_vaddr || cursor >= segment->m_vaddr + segment->m_vsize)
-		cursor = segment->m_vaddr;
-	while (cursor + ptr_sz <= end)
+	// read register values of this thread context
+	nread = read_registers (segment, g_regs_buf, g_nregs);
+	for (k=0; k<nread; k++)
 	{
-		address_t value = 0;
-		if (!read_memory_wrapper(segment, cursor, (void*)&value, ptr_sz))
-			break;
-		if (value)
+		struct shrobj_hit hit;
+
+		if (g_regs_buf[k].reg_width == ptr_sz && g_regs_buf[k].value
+			&& prescan_shared_object(g_regs_buf[k].value, &hit))
 		{
-			shrobj = add_one_shared_object(value, ignore_new_shrobj, 1);
-			if (shrobj)
-			{
-				address_t var_addr = 0;
-				size_t    var_size = 0;
-
-				aref = new struct object_reference;
-				memset(aref, 0, sizeof(struct object_reference));
-				aref->storage_type = ENUM_STACK;
-				aref->vaddr = cursor;
-				aref->value = value;
-				aref->where.stack.tid = segment->m_thread.tid;
-				aref->where.stack.frame = get_frame_number(segment, cursor, &aref->where.stack.offset);
-
-				if (!known_stack_sym(aref, &var_addr, &var_size)
-					|| var_size >= ptr_sz)
-				{
-					shrobj->thread_owners.push_front(aref);
-				}
-				else
-					free (aref);
-			}
+			hit.vaddr = 0;
+			hit.value = g_regs_buf[k].value;
+			hit.reg_num = k;
+			hits.push_back(hit);
 		}
-		cursor += ptr_sz;
 	}
 }
 
@@ -1430,24 +2574,62 @@ static bool shared_objects_internal(std::list<int>& threads, bool verbose)
 
 	// set shared object repository to initial state
 	init_shared_objects ();
+	g_shrobj_blocks = build_inuse_heap_blocks(&g_shrobj_nblocks);
 
-	// First search all input threads' registers/stacks, record all found shared objects
+	// Registers are read by the main thread and stacks are scanned in parallel
+	// for a core. A hit is resolved to its object if it is a heap block
+	std::vector<unsigned int> thread_segs;
+	std::vector<address_t> rsps;
 	for (i=0; i<g_segment_count; i++)
 	{
-		if (user_request_break())
+		segment = &g_segments[i];
+		if (segment->m_type == ENUM_STACK && input_tid_map[segment->m_thread.tid])
 		{
-			if (verbose)
-				CA_PRINT("Abort searching shared objects\n");
-			break;
+			thread_segs.push_back(i);
+			rsps.push_back(get_rsp(segment));
 		}
+	}
+	delete[] input_tid_map;
 
-		segment = &g_segments[i];
-		if (segment->m_type == ENUM_STACK && input_tid_map[segment->m_thread.tid])
-			find_shared_objects_one_thread (segment, false);
+	size_t nthreads = thread_segs.size();
+	std::vector<std::vector<struct shrobj_hit>> reg_hits(nthreads), stack_hits(nthreads);
+	std::atomic<bool> abort(false);
+	std::thread::id caller = std::this_thread::get_id();
+	auto scan_thread = [&](size_t k) {
+		if (abort)
+			return;
+		if (std::this_thread::get_id() == caller && user_request_break())
+		{
+			abort = true;
+			return;
+		}
+		scan_thread_stack(&g_segments[thread_segs[k]], rsps[k], stack_hits[k]);
+	};
+	for (i = 0; i < nthreads; i++)
+		scan_thread_registers(&g_segments[thread_segs[i]], reg_hits[i]);
+	if (g_debug_core)
+		CA_THREAD_POOL.parallel_for(nthreads, scan_thread);
+	else
+	{
+		for (i = 0; i < nthreads && !abort; i++)
+			scan_thread(i);
+	}
+	if (abort)
+	{
+		if (verbose)
+			CA_PRINT("Abort searching shared objects\n");
+		return false;
 	}
 
-	// clean up
-	delete[] input_tid_map;
+	// Then record all found shared objects in the order of threads, and their
+	// frames and symbols
+	for (i = 0; i < nthreads; i++)
+	{
+		segment = &g_segments[thread_segs[i]];
+		add_thread_owners(segment, reg_hits[i]);
+		add_thread_owners(segment, stack_hits[i]);
+	}
+	expand_shared_objects();
 
 	return true;
 }
@@ -1463,13 +2645,13 @@ std::list<struct object_reference*> search_shared_objects_by_threads(std::list<i
 	if (shared_objects_internal(threads, false))
 	{
 		// Prepare result
-		for (auto itr = g_shared_objects.begin(); itr != g_shared_objects.end(); itr++)
+		for (auto index : g_shrobj_order)
 		{
-			auto shrobj = *itr;
+			struct shared_object* shrobj = &g_shared_objects[index];
 			// there might be no owner because we know the stack variable are not of pointer type
 			if (shrobj->thread_owners.empty() && shrobj->parent_shrobjs.empty())
 				continue;
-			else if (has_multiple_thread_owners(shrobj))
+			else if (has_multiple_thread_owners(index))
 			{
 				struct object_reference* ref = new struct object_reference;
 				ref->vaddr = shrobj->start;
@@ -1769,6 +2951,298 @@ void print_memory_pattern(address_t lo, address_t hi)
 	}
 }
 
+/////////////////////////////////////////////////////////////////////////
+// Summary of the memory pattern of a large range
+//	words are classified in bulk by chunks of the range. Candidate
+//	pointers are picked by the vector classifier and resolved by their
+//	segments and the in-use block array, strings by a vector scan of
+//	printable bytes. A string across chunks is counted by its parts.
+/////////////////////////////////////////////////////////////////////////
+enum pattern_class
+{
+	PATTERN_HEAP = 0,
+	PATTERN_STACK,
+	PATTERN_GLOBAL,
+	PATTERN_TEXT,
+	PATTERN_ZERO,
+	PATTERN_ASCII,
+	PATTERN_UTF16,
+	PATTERN_OTHER,
+	PATTERN_CLASS_COUNT
+};
+
+static const char* pattern_class_names[PATTERN_CLASS_COUNT] =
+{
+	"pointer to heap",
+	"pointer to stack",
+	"pointer to global",
+	"pointer to text",
+	"zero",
+	"ASCII string",
+	"UTF-16 string",
+	"other"
+};
+
+struct pattern_chunk
+{
+	struct ca_segment* segment;
+	address_t start;
+	address_t end;
+	bool      done;
+	size_t    counts[PATTERN_CLASS_COUNT];
+	std::unordered_map<unsigned long, size_t> block_refs;	// by index of in-use blocks
+};
+
+struct pattern_ref_stat
+{
+	unsigned long index;	// the block, or a vtable if by types
+	size_t refs;
+	size_t count;			// blocks of a type
+};
+
+static bool pattern_ref_comp(const struct pattern_ref_stat& a, const struct pattern_ref_stat& b)
+{
+	if (a.refs != b.refs)
+		return a.refs > b.refs;
+	return a.index < b.index;
+}
+
+static enum pattern_class
+classify_pattern_pointer(address_t value, struct inuse_block* blocks, unsigned long nblocks,
+		unsigned long* block_index)
+{
+	struct ca_segment* segment;
+	struct inuse_block* blk = find_inuse_block(value, blocks, nblocks);
+
+	if (blk)
+	{
+		*block_index = blk - blocks;
+		return PATTERN_HEAP;
+	}
+	segment = get_segment(value, 1);
+	if (!segment)
+		return PATTERN_OTHER;
+	else if (segment->m_type == ENUM_STACK)
+		return PATTERN_STACK;
+	else if (segment->m_type == ENUM_MODULE_DATA)
+		return PATTERN_GLOBAL;
+	else if (segment->m_type == ENUM_MODULE_TEXT)
+		return PATTERN_TEXT;
+	// free heap memory or unknown segments
+	return PATTERN_OTHER;
+}
+
+static void
+summarize_pattern_chunk(struct pattern_chunk& chunk, struct inuse_block* blocks, unsigned long nblocks)
+{
+	size_t ptr_sz = g_ptr_bit >> 3;
+	size_t nbytes = chunk.end - chunk.start;
+	size_t nwords = nbytes / ptr_sz;
+	unsigned int word_mask = (1u << ptr_sz) - 1;
+	std::vector<char> buf(nbytes);
+	std::vector<unsigned int> ptrs((nwords + 31) >> 5);
+	std::vector<unsigned int> ascii((nbytes + 31) >> 5), utf16((nbytes + 31) >> 5);
+	size_t w;
+
+	if (!read_memory_wrapper(chunk.segment, chunk.start, buf.data(), nbytes))
+		return;
+	classify_ptr_words(buf.data(), nwords, ptr_sz, ptrs.data(), chunk.segment);
+	find_string_bytes(buf.data(), nbytes, min_chars, ascii.data(), utf16.data());
+
+	for (w = 0; w < nwords; w++)
+	{
+		size_t offset = w * ptr_sz;
+		enum pattern_class cls = PATTERN_OTHER;
+		address_t value = 0;
+
+		memcpy(&value, &buf[offset], ptr_sz);
+		if (value == 0)
+			cls = PATTERN_ZERO;
+		else if (ptrs[w >> 5] & (1u << (w & 0x1F)))
+		{
+			unsigned long index = 0;
+			cls = classify_pattern_pointer(value, blocks, nblocks, &index);
+			if (cls == PATTERN_HEAP)
+				chunk.block_refs[index]++;
+		}
+		// a word is a string if any of its bytes is, words are aligned in
+		// a word of the bit vectors
+		if (cls == PATTERN_OTHER)
+		{
+			if ((ascii[offset >> 5] >> (offset & 0x1F)) & word_mask)
+				cls = PATTERN_ASCII;
+			else if ((utf16[offset >> 5] >> (offset & 0x1F)) & word_mask)
+				cls = PATTERN_UTF16;
+		}
+		chunk.counts[cls]++;
+	}
+	chunk.done = true;
+}
+
+bool summarize_memory_pattern(address_t lo, address_t hi)
+{
+	size_t ptr_sz = g_ptr_bit >> 3;
+	unsigned long nblocks = 0;
+	struct inuse_block* blocks;
+	address_t cursor;
+	size_t counts[PATTERN_CLASS_COUNT];
+	size_t total_words = 0;
+	size_t i;
+	std::atomic<bool> abort(false);
+
+	blocks = build_inuse_heap_blocks(&nblocks);
+	if (!ptr_range_table_ready())
+		build_ptr_range_table();
+
+	// chunks don't cross segments so that each is read through its own
+	std::vector<struct pattern_chunk> chunks;
+	for (cursor = ALIGN(lo, ptr_sz); cursor + ptr_sz <= hi; )
+	{
+		struct ca_segment* segment = get_segment(cursor, ptr_sz);
+		address_t end;
+
+		if (!segment || cursor + ptr_sz > segment->m_vaddr + segment->m_fsize)
+		{
+			CA_PRINT("inaccessible memory " PRINT_FORMAT_POINTER "\n", cursor);
+			break;
+		}
+		end = segment->m_vaddr + segment->m_fsize;
+		if (end > hi)
+			end = hi;
+		if (end > cursor + PATTERN_CHUNK_SZ)
+			end = cursor + PATTERN_CHUNK_SZ;
+		end = cursor + (end - cursor) / ptr_sz * ptr_sz;
+
+		chunks.emplace_back();
+		struct pattern_chunk& chunk = chunks.back();
+		chunk.segment = segment;
+		chunk.start = cursor;
+		chunk.end = end;
+		chunk.done = false;
+		memset(chunk.counts, 0, sizeof(chunk.counts));
+		cursor = end;
+	}
+
+	std::thread::id caller = std::this_thread::get_id();
+	auto summarize_chunk = [&](size_t k) {
+		if (abort)
+			return;
+		if (std::this_thread::get_id() == caller && user_request_break())
+		{
+			abort = true;
+			return;
+		}
+		summarize_pattern_chunk(chunks[k], blocks, nblocks);
+	};
+	if (g_debug_core)
+		CA_THREAD_POOL.parallel_for(chunks.size(), summarize_chunk);
+	else
+	{
+		// a live process is read by the main thread
+		for (i = 0; i < chunks.size() && !abort; i++)
+			summarize_chunk(i);
+	}
+	if (abort)
+	{
+		CA_PRINT("Abort summarizing memory pattern\n");
+		return false;
+	}
+
+	// merge chunks
+	std::unordered_map<unsigned long, size_t> block_refs;
+	memset(counts, 0, sizeof(counts));
+	for (auto& chunk : chunks)
+	{
+		if (!chunk.done)
+		{
+			CA_PRINT("Failed to read memory [" PRINT_FORMAT_POINTER ", " PRINT_FORMAT_POINTER ")\n",
+				chunk.start, chunk.end);
+			continue;
+		}
+		for (i = 0; i < PATTERN_CLASS_COUNT; i++)
+			counts[i] += chunk.counts[i];
+		for (auto& itr : chunk.block_refs)
+			block_refs[itr.first] += itr.second;
+	}
+
+	CA_PRINT("memory pattern [" PRINT_FORMAT_POINTER ", " PRINT_FORMAT_POINTER "] summary:\n", lo, hi);
+	for (i = 0; i < PATTERN_CLASS_COUNT; i++)
+		total_words += counts[i];
+	for (i = 0; i < PATTERN_CLASS_COUNT; i++)
+	{
+		CA_PRINT("\t%-20s " PRINT_FORMAT_SIZE " words ", pattern_class_names[i], counts[i]);
+		print_size(counts[i] * ptr_sz);
+		if (total_words)
+			CA_PRINT(" (%.1f%%)", (double)counts[i] * 100 / total_words);
+		CA_PRINT("\n");
+	}
+	CA_PRINT("Total " PRINT_FORMAT_SIZE " words ", total_words);
+	print_size(total_words * ptr_sz);
+	CA_PRINT("\n");
+	if (block_refs.empty())
+		return true;
+
+	// the referenced blocks and their classes by vptr
+	const std::vector<struct vtable_range>& vtables = get_vtable_index();
+	std::vector<struct pattern_ref_stat> block_stats;
+	std::unordered_map<const char*, struct pattern_ref_stat> type_refs;	// by class name
+	std::vector<const struct vtable_range*> block_types;
+	block_stats.reserve(block_refs.size());
+	for (auto& itr : block_refs)
+	{
+		struct pattern_ref_stat stat = {itr.first, itr.second, 1};
+		block_stats.push_back(stat);
+	}
+	std::sort(block_stats.begin(), block_stats.end(), pattern_ref_comp);
+	for (auto& stat : block_stats)
+	{
+		const struct inuse_block* blk = &blocks[stat.index];
+		const struct vtable_range* vtable = NULL;
+		address_t vptr = 0;
+
+		if (!vtables.empty() && blk->size >= ptr_sz
+			&& read_memory_wrapper(NULL, blk->addr, &vptr, ptr_sz))
+			vtable = find_vtable(vtables, vptr);
+		block_types.push_back(vtable);
+		if (vtable)
+		{
+			// classes of the same name in different modules are merged
+			struct pattern_ref_stat& type_stat = type_refs[vtable->name];
+			type_stat.index = vtable - &vtables[0];
+			type_stat.refs += stat.refs;
+			type_stat.count++;
+		}
+	}
+
+	CA_PRINT("Top referenced heap blocks:\n");
+	for (i = 0; i < block_stats.size() && i < PATTERN_TOP_COUNT; i++)
+	{
+		const struct inuse_block* blk = &blocks[block_stats[i].index];
+		CA_PRINT("\t[" PRINT_FORMAT_SIZE "] [" PRINT_FORMAT_POINTER ", " PRINT_FORMAT_POINTER ") ",
+			i + 1, blk->addr, blk->addr + blk->size);
+		print_size(blk->size);
+		CA_PRINT(" referenced " PRINT_FORMAT_SIZE " times", block_stats[i].refs);
+		if (block_types[i])
+			CA_PRINT(" %s", block_types[i]->name);
+		CA_PRINT("\n");
+	}
+	CA_PRINT("Total " PRINT_FORMAT_SIZE " heap blocks are referenced\n", block_stats.size());
+
+	if (type_refs.empty())
+		return true;
+	std::vector<struct pattern_ref_stat> type_stats;
+	for (auto& itr : type_refs)
+		type_stats.push_back(itr.second);
+	std::sort(type_stats.begin(), type_stats.end(), pattern_ref_comp);
+	CA_PRINT("Top referenced types:\n");
+	for (i = 0; i < type_stats.size() && i < PATTERN_TOP_COUNT; i++)
+	{
+		CA_PRINT("\t[" PRINT_FORMAT_SIZE "] %s: referenced " PRINT_FORMAT_SIZE " times, " PRINT_FORMAT_SIZE " objects\n",
+			i + 1, vtables[type_stats[i].index].name, type_stats[i].refs, type_stats[i].count);
+	}
+	return true;
+}
+
 /*
  * Given a string of command options, end each option with '\0',
  * 		and store in an array
@@ -1912,136 +3386,265 @@ print_wstring(address_t str)
 /***************************************************************************
 * Helper functions for shared objects
 ***************************************************************************/
-static bool shared_object_comp_func(void *lhs, void *rhs)
+static void init_shared_objects(void)
 {
-	struct shared_object* shrobj1 = (struct shared_object*)lhs;
-	struct shared_object* shrobj2 = (struct shared_object*)rhs;
-	if (shrobj1->start < shrobj2->start)
-		return true;
-	else
-		return false;
+	g_shared_objects.clear();
+	g_shrobj_slots.clear();
+	g_shrobj_order.clear();
+	g_shrobj_blocks = nullptr;
+	g_shrobj_nblocks = 0;
 }
 
-static void empty_shared_objects(void)
+static inline size_t shrobj_hash(address_t start, size_t mask)
 {
-	if (g_shared_objects.empty())
-		return;
+	return (size_t)(((unsigned long long)start >> 3) * 0x9E3779B97F4A7C15ull >> 20) & mask;
+}
+
+/*
+ * if the object is first time seen, create an entry for it at the level
+ * Return the index of the object
+ */
+static unsigned int
+find_or_insert_object(address_t obj_start, size_t obj_size, unsigned int level)
+{
+	size_t mask, i, k;
 
-	// free shared objects one by one
-	for (auto itr = g_shared_objects.begin(); itr != g_shared_objects.end(); itr++)
+	// the table is kept at most half full
+	if ((g_shared_objects.size() + 1) * 2 > g_shrobj_slots.size())
 	{
-		auto shrobj = *itr;
-		// cleanup owners
-		for (auto ref : shrobj->thread_owners)
-			delete ref;
-		shrobj->thread_owners.clear();
-		shrobj->parent_shrobjs.clear();
-		// free shared object itself
-		delete shrobj;
+		g_shrobj_slots.assign(g_shrobj_slots.empty() ? 1024 : g_shrobj_slots.size() * 2, 0);
+		mask = g_shrobj_slots.size() - 1;
+		for (k = 0; k < g_shared_objects.size(); k++)
+		{
+			for (i = shrobj_hash(g_shared_objects[k].start, mask); g_shrobj_slots[i]; i = (i + 1) & mask)
+				;
+			g_shrobj_slots[i] = k + 1;
+		}
 	}
-	// remove all nodes
-	g_shared_objects.clear();
-}
 
-static void init_shared_objects(void)
-{
-	empty_shared_objects ();
-	g_shared_objects.clear();
+	/* search previously found shared objects */
+	mask = g_shrobj_slots.size() - 1;
+	for (i = shrobj_hash(obj_start, mask); g_shrobj_slots[i]; i = (i + 1) & mask)
+	{
+		if (g_shared_objects[g_shrobj_slots[i] - 1].start == obj_start)
+			return g_shrobj_slots[i] - 1;
+	}
+
+	// This is a new shared object
+	struct shared_object shrobj;
+	shrobj.start = obj_start;
+	shrobj.end   = obj_start + obj_size;
+	shrobj.level = level;
+	g_shared_objects.push_back(shrobj);
+	g_shrobj_slots[i] = g_shared_objects.size();
+	return g_shared_objects.size() - 1;
 }
 
 /*
- * if the object is first time seen, create an entry for it
- * Return a new reference, which is attached to the object's owner list
+ * Thread-safe part of resolve_shared_object, only heap blocks are resolved
+ * Return false if addr can't be an object
  */
-static struct shared_object*
-find_or_insert_object(address_t obj_start, size_t obj_size, bool ignore_new_shrobj)
+static bool
+prescan_shared_object(address_t addr, struct shrobj_hit* hit)
 {
-	/* search previously found shared objects */
-	struct shared_object  anobj;
-	struct shared_object* shrobj = nullptr;
+	struct ca_segment* segment = get_segment(addr, 8);
 
-	anobj.start = obj_start;
-	anobj.end   = obj_start + obj_size;
-	auto itr = g_shared_objects.find(&anobj);
-	if (itr != g_shared_objects.end())
-		shrobj = *itr;
-	if (!shrobj && !ignore_new_shrobj)
+	hit->obj_start = 0;
+	hit->obj_size = 0;
+	if (!segment)
+		return false;
+	if (segment->m_type == ENUM_HEAP && g_shrobj_blocks)
 	{
-		// This is a new shared object
-		shrobj = new shared_object;
-		shrobj->start = anobj.start;
-		shrobj->end   = anobj.end;
-		g_shared_objects.insert(shrobj);
+		struct inuse_block* blk = find_inuse_block(addr, g_shrobj_blocks, g_shrobj_nblocks);
+		if (!blk)
+			return false;
+		hit->obj_start = blk->addr;
+		hit->obj_size = blk->size;
+		return true;
 	}
+	return segment->m_type == ENUM_HEAP || segment->m_type == ENUM_MODULE_DATA;
+}
+
+// figure out the addr/size of the object that addr points to
+static bool
+resolve_shared_object(address_t addr, address_t* obj_addr, size_t* obj_size)
+{
+	struct shrobj_hit hit;
 
-	return shrobj;
+	if (!prescan_shared_object(addr, &hit))
+		return false;
+	*obj_addr = hit.obj_start;
+	*obj_size = hit.obj_size;
+	if (!*obj_size)
+	{
+		struct ca_segment* segment = get_segment(addr, 8);
+		if (segment->m_type == ENUM_HEAP)
+		{
+			struct heap_block blockinfo;
+			if (CA_HEAP->is_heap_block(addr)
+				&& CA_HEAP->get_heap_block_info(addr, &blockinfo)
+				&& blockinfo.inuse == true)
+			{
+				*obj_addr = blockinfo.addr;
+				*obj_size = blockinfo.size;
+			}
+		}
+		else if (segment->m_type == ENUM_MODULE_DATA)
+		{
+			struct object_reference obj_ref;
+			obj_ref.storage_type = ENUM_MODULE_DATA;
+			obj_ref.vaddr = addr;
+			if (!known_global_sym(&obj_ref, obj_addr, obj_size))
+			{
+				*obj_addr = addr;
+				*obj_size  = 1;
+			}
+		}
+	}
+	return *obj_addr && *obj_size;
 }
 
+// Record objects referenced by a thread, and the references as their owners
 static void
-get_all_parents(SharedObjectSet& parents, struct shared_object* shrobj, unsigned int level)
+add_thread_owners(struct ca_segment* segment, const std::vector<struct shrobj_hit>& hits)
 {
-	if (level < g_shrobj_level)
+	size_t ptr_sz = g_ptr_bit >> 3;
+
+	for (auto& hit : hits)
 	{
-		for (auto parent : shrobj->parent_shrobjs)
+		struct object_reference aref;
+		address_t obj_addr = hit.obj_start;
+		size_t    obj_size = hit.obj_size;
+		unsigned int index;
+
+		if (!obj_size && !resolve_shared_object(hit.value, &obj_addr, &obj_size))
+			continue;
+		index = find_or_insert_object(obj_addr, obj_size, 1);
+
+		memset(&aref, 0, sizeof(struct object_reference));
+		aref.value = hit.value;
+		if (hit.reg_num >= 0)
+		{
+			aref.storage_type = ENUM_REGISTER;
+			aref.where.reg.tid = segment->m_thread.tid;
+			aref.where.reg.reg_num = hit.reg_num;
+		}
+		else
 		{
-			parents.insert(parent);
-			if (level+1 < g_shrobj_level)
-				get_all_parents(parents, parent, level+1);
+			address_t var_addr = 0;
+			size_t    var_size = 0;
+
+			aref.storage_type = ENUM_STACK;
+			aref.vaddr = hit.vaddr;
+			aref.where.stack.tid = segment->m_thread.tid;
+			aref.where.stack.frame = get_frame_number(segment, hit.vaddr, &aref.where.stack.offset);
+			// a local variable smaller than a pointer doesn't refer to the object
+			if (known_stack_sym(&aref, &var_addr, &var_size) && var_size < ptr_sz)
+				continue;
 		}
+		g_shared_objects[index].thread_owners.push_back(aref);
 	}
 }
 
-static bool has_multiple_thread_owners(struct shared_object* shrobj)
+static bool shrobj_index_comp(unsigned int a, unsigned int b)
 {
-	int tid;
-	int first_seen_tid = -1;
-	bool rc = false;
+	return g_shared_objects[a].start < g_shared_objects[b].start;
+}
+
+/*
+ * Objects pointed to by shared objects are shared as well, up to
+ * g_shrobj_level of indirection. Objects are appended in the order of
+ * their levels, so each is expanded once at its least level.
+ */
+static void
+expand_shared_objects(void)
+{
+	size_t ptr_sz = g_ptr_bit >> 3;
+	unsigned int next;
 
-	// first check all thread owners
-	for (auto ref : shrobj->thread_owners)
+	for (next = 0; next < g_shared_objects.size(); next++)
 	{
-		tid = (ref->storage_type == ENUM_STACK) ? ref->where.stack.tid : ref->where.reg.tid;
-		// if this thread is first seen
-		if (first_seen_tid >= 0)
+		unsigned int level = g_shared_objects[next].level;
+		address_t obj_end = g_shared_objects[next].end;
+		address_t cursor;
+
+		if (level >= g_shrobj_level)
+			continue;
+		for (cursor = g_shared_objects[next].start; cursor + ptr_sz < obj_end; cursor += ptr_sz)
 		{
-			if (first_seen_tid != tid)
-				return true;
+			address_t value = 0;
+			address_t obj_addr;
+			size_t    obj_size;
+
+			if (!read_memory_wrapper(NULL, cursor, (void*)&value, ptr_sz))
+				break;
+			else if (value && resolve_shared_object(value, &obj_addr, &obj_size))
+			{
+				unsigned int child = find_or_insert_object(obj_addr, obj_size, level + 1);
+				std::vector<unsigned int>& parents = g_shared_objects[child].parent_shrobjs;
+				if (parents.empty() || parents.back() != next)
+					parents.push_back(next);
+			}
 		}
-		else
-			first_seen_tid = tid;
 	}
 
-	// At this point, there is no or only one thread owner of this shared object
-	// if this is a child object, check parental shared objects
-	if (g_shrobj_level > 1 && !shrobj->parent_shrobjs.empty())
+	// the last found reference is listed first
+	for (auto& shrobj : g_shared_objects)
 	{
-		SharedObjectSet parents;
+		std::reverse(shrobj.thread_owners.begin(), shrobj.thread_owners.end());
+		std::reverse(shrobj.parent_shrobjs.begin(), shrobj.parent_shrobjs.end());
+	}
+	g_shrobj_order.resize(g_shared_objects.size());
+	for (next = 0; next < g_shared_objects.size(); next++)
+		g_shrobj_order[next] = next;
+	std::sort(g_shrobj_order.begin(), g_shrobj_order.end(), shrobj_index_comp);
+}
+
+static inline int owner_tid(const struct object_reference& ref)
+{
+	return (ref.storage_type == ENUM_STACK) ? ref.where.stack.tid : ref.where.reg.tid;
+}
 
-		get_all_parents(parents, shrobj, 1);
+/*
+ * True if the object, or its parental shared objects up to g_shrobj_level
+ * of indirection, are referenced by more than one thread
+ */
+static bool has_multiple_thread_owners(unsigned int index)
+{
+	int first_seen_tid = -1;
+	unsigned int level;
+	std::vector<unsigned int> objs(1, index), parents;
+	std::unordered_set<unsigned int> visited;
 
-		for (auto obj : parents)
+	visited.insert(index);
+	for (level = 1; !objs.empty(); level++)
+	{
+		for (auto obj : objs)
 		{
-			if (rc != false)
-				break;
-			for (auto ref : obj->thread_owners)
+			for (auto& ref : g_shared_objects[obj].thread_owners)
 			{
-				tid = (ref->storage_type == ENUM_STACK) ? ref->where.stack.tid : ref->where.reg.tid;
+				int tid = owner_tid(ref);
 				// if this thread is first seen
-				if (first_seen_tid >= 0)
-				{
-					if (first_seen_tid != tid)
-					{
-						rc = true;
-						break;
-					}
-				}
-				else
-					first_seen_tid = tid;
+				if (first_seen_tid >= 0 && first_seen_tid != tid)
+					return true;
+				first_seen_tid = tid;
+			}
+		}
+		if (level >= g_shrobj_level)
+			break;
+		// move up to parents of this level
+		parents.clear();
+		for (auto obj : objs)
+		{
+			for (auto parent : g_shared_objects[obj].parent_shrobjs)
+			{
+				if (visited.insert(parent).second)
+					parents.push_back(parent);
 			}
 		}
+		objs.swap(parents);
 	}
-
-	return rc;
+	return false;
 }
 
 static void
@@ -2052,8 +3655,8 @@ print_one_shared_object(struct shared_object* shrobj, std::list<struct shared_ob
 	address_t parent_obj_start, parent_obj_end;
 
 	// first all thread owners
-	for (auto ref : shrobj->thread_owners)
-		print_ref(ref, 1, false, true);
+	for (auto& ref : shrobj->thread_owners)
+		print_ref(&ref, 1, false, true);
 
 	// print the parent chain reaching this shared object
 	level = 1;
@@ -2099,9 +3702,9 @@ print_one_shared_object(struct shared_object* shrobj, std::list<struct shared_ob
 	{
 		CA_PRINT("    ...................................................\n");
 		child_chain.push_front(shrobj);
-		for (auto child : shrobj->parent_shrobjs)
+		for (auto parent : shrobj->parent_shrobjs)
 		{
-			print_one_shared_object(child, child_chain);
+			print_one_shared_object(&g_shared_objects[parent], child_chain);
 		}
 		child_chain.pop_front();
 	}
@@ -2112,9 +3715,9 @@ static void print_shared_objects_by_threads(void)
 	int count = 0;
 	std::list<struct shared_object*> child_chain;
 
-	for (auto itr = g_shared_objects.begin(); itr != g_shared_objects.end(); itr++)
+	for (auto index : g_shrobj_order)
 	{
-		auto shrobj = *itr;
+		struct shared_object* shrobj = &g_shared_objects[index];
 		// there might be no owner because we know the stack variable are not of pointer type
 		if (shrobj->thread_owners.empty() && shrobj->parent_shrobjs.empty())
 			continue;
@@ -2122,7 +3725,7 @@ static void print_shared_objects_by_threads(void)
 		// We are only interested in shared object referenced by more than one thread
 		// which is a candidate of race condition
 		// Display all references to this object
-		if (has_multiple_thread_owners(shrobj))
+		if (has_multiple_thread_owners(index))
 		{
 			struct object_reference aref;
 
@@ -2147,70 +3750,3 @@ static void print_shared_objects_by_threads(void)
 		}
 	}
 }
-
-static struct shared_object*
-add_one_shared_object(address_t addr, bool ignore_new_shrobj, unsigned int level)
-{
-	size_t ptr_sz = g_ptr_bit >> 3;
-	struct ca_segment* segment = get_segment(addr, 8);
-	struct shared_object* shrobj;
-	address_t obj_addr = 0;
-	size_t    obj_size = 0;
-
-	if (!segment)
-		return NULL;
-
-	// figure out the addr/size of the object
-	if (segment->m_type == ENUM_HEAP)
-	{
-		struct heap_block blockinfo;
-		if (CA_HEAP->is_heap_block(addr)
-			&& CA_HEAP->get_heap_block_info(addr, &blockinfo)
-			&& blockinfo.inuse == true)
-		{
-			obj_addr = blockinfo.addr;
-			obj_size = blockinfo.size;
-		}
-	}
-	else if (segment->m_type == ENUM_MODULE_DATA)
-	{
-		struct object_reference obj_ref;
-		obj_ref.storage_type = ENUM_MODULE_DATA;
-		obj_ref.vaddr = addr;
-		if (!known_global_sym(&obj_ref, &obj_addr, &obj_size))
-		{
-			obj_addr = addr;
-			obj_size  = 1;
-		}
-	}
-
-	if (obj_addr && obj_size)
-	{
-		shrobj = find_or_insert_object(obj_addr, obj_size, ignore_new_shrobj);
-		// if deeper relationship is desired, call me recursively
-		if (shrobj && level < g_shrobj_level)
-		{
-			address_t cursor;
-			for(cursor = obj_addr;
-				cursor + ptr_sz < obj_addr + obj_size;
-				cursor += ptr_sz )
-			{
-				address_t value = 0;
-				if (!read_memory_wrapper(NULL, cursor, (void*)&value, ptr_sz))
-					break;
-				else if (value)
-				{
-					struct shared_object* child_shrobj = add_one_shared_object(value, ignore_new_shrobj, level+1);
-					if (child_shrobj && std::find(child_shrobj->parent_shrobjs.begin(), child_shrobj->parent_shrobjs.end(), shrobj) == child_shrobj->parent_shrobjs.end())
-					{
-						child_shrobj->parent_shrobjs.push_front(shrobj);
-					}
-				}
-			}
-		}
-	}
-	else
-		shrobj = NULL;
-
-	return shrobj;
-}
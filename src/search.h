@@ -10,6 +10,7 @@
 
 #include "ref.h"
 #include <list>
+#include <vector>
 
 /*
  * Exposed functions
@@ -20,13 +21,18 @@ extern std::string get_object_type_name(address_t addr);
 extern bool find_object_refs(address_t addr, size_t size, unsigned int iLevel);
 extern std::list<struct object_reference*>
 search_object_refs(address_t addr, size_t size, unsigned int iLevel, enum storage_type stype);
+extern std::vector<std::list<struct object_reference*>>
+search_object_refs_batch(const std::vector<struct object_range>& objects, enum storage_type stype);
+extern bool find_object_refs_batch(const char* fname);
 extern void set_max_indirection_level(unsigned int);
 
 extern bool find_object_refs_on_threads(address_t addr, size_t size, unsigned int depth);
 
-extern bool  search_cplusplus_objects_and_references(const char* exp, bool search_ref, bool thread_scope);
+extern bool  search_cplusplus_objects_and_references(const char* exp, bool search_ref, bool thread_scope,
+		size_t max_count);
 extern std::list<struct object_reference*>
 search_cplusplus_objects_with_vptr(const char* exp);
+extern bool  census_cplusplus_objects(void);
 extern bool  search_all_objects(unsigned int);
 
 extern bool find_shared_objects_by_threads(std::list<int>& threads);
@@ -35,6 +41,7 @@ search_shared_objects_by_threads(std::list<int>& threads);
 extern void set_shared_objects_indirection_level(unsigned int);
 
 extern void print_memory_pattern(address_t lo, address_t hi);
+extern bool summarize_memory_pattern(address_t lo, address_t hi);
 
 extern void print_ref(const struct object_reference*, unsigned int, bool, bool);
 extern std::string get_ref_name(const struct object_reference*, unsigned int, bool, bool);
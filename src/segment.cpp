@@ -5,7 +5,18 @@
  *  Created on: Dec 13, 2011
  *      Author: myan
  */
+#include <limits.h>
+#include <algorithm>
+#include <map>
+#include <unordered_map>
 #include "segment.h"
+#include "thread_pool.h"
+#include "simd_scan.h"
+#include "compressed_core.h"
+#include "ref_index.h"
+#ifndef WIN32
+#include <sys/stat.h>
+#endif
 
 
 /***************************************************************************
@@ -24,6 +35,11 @@ static size_t g_bitvec_length = 0;
 
 static void* sys_alloc(size_t sz);
 static void  sys_free(void* p, size_t sz);
+static void  stop_bit_vec_workers(void);
+static void  forget_bit_vec(struct ptr_bitmap* bitmap);
+static void  forget_all_bit_vecs(void);
+static void  release_segment_index(void);
+static bool  index_one_segment(unsigned int index);
 /////////////////////////////////////////////////////////
 // Dismantle all segments previously built
 // but keep the buffer for reuse
@@ -32,13 +48,26 @@ bool release_all_segments(void)
 {
 	unsigned int i;
 	struct ca_segment* segment;
-	// release the bit vector, which is one monolithic region
+	// workers may still be building bit vectors in the background
+	stop_bit_vec_workers();
+	invalidate_ptr_range_table();
+	release_segment_index();
+	release_ref_index();
+	// release bit vectors of pointers
+	forget_all_bit_vecs();
+	for (i=0; i<g_segment_count; i++)
+	{
+		segment = &g_segments[i];
+		free_ptr_bitmap(segment->m_ptr_bitmap);
+		segment->m_ptr_bitmap = NULL;
+	}
+	// page bit vectors are one monolithic region
 	for (i=0; i<g_segment_count; i++)
 	{
 		segment = &g_segments[i];
-		if (segment->m_ptr_bitvec)
+		if (segment->m_page_bitvec)
 		{
-			sys_free(segment->m_ptr_bitvec, g_bitvec_length);
+			sys_free(segment->m_page_bitvec, g_bitvec_length);
 			break;
 		}
 	}
@@ -50,6 +79,9 @@ bool release_all_segments(void)
 			&& segment->m_module_name)
 			free((void*)segment->m_module_name);
 	}
+	// segments' data of a compressed core is gone with them
+	close_compressed_core();
+	set_core_file(-1, NULL, 0);
 	// Since all ca_segments are on a big buffer, simply ground the indexes
 	g_segment_count = 0;
 
@@ -59,6 +91,10 @@ bool release_all_segments(void)
 // Expand buffer for at least "inc" slots
 static void prepare_segment_buffer(unsigned int inc)
 {
+	// segments can't move under the feet of bit vector workers
+	stop_bit_vec_workers();
+	invalidate_ptr_range_table();
+	release_ref_index();
 	if (!g_segments)
 	{
 		g_segments = (struct ca_segment*) malloc(sizeof(struct ca_segment)*INIT_SEG_BUFFER_SZ);
@@ -111,16 +147,21 @@ static void split_segment(struct ca_segment* segment, address_t addr)
 		next->m_fsize = old_fsize - segment->m_fsize;
 	if (segment->m_module_name)
 		next->m_module_name = strdup(segment->m_module_name);
-	if (next->m_ptr_bitvec)
+	// both parts rebuild their bit vectors of pointers
+	if (segment->m_ptr_bitmap)
 	{
+		size_t ptr_sz = g_ptr_bit >> 3;
+		forget_bit_vec(segment->m_ptr_bitmap);
+		free_ptr_bitmap(segment->m_ptr_bitmap);
+		segment->m_ptr_bitmap = new_ptr_bitmap(segment->m_fsize / ptr_sz, PTR_BITMAP_CHUNK_SZ / ptr_sz);
+		next->m_ptr_bitmap = NULL;
 		if (next->m_fsize > 0)
-		{
-			size_t ptr_sz = g_ptr_bit >> 3;
-			next->m_ptr_bitvec = (unsigned int*)((char*)segment->m_ptr_bitvec + (segment->m_fsize/ptr_sz >> 3));
-		}
-		else
-			next->m_ptr_bitvec = NULL;
+			next->m_ptr_bitmap = new_ptr_bitmap(next->m_fsize / ptr_sz, PTR_BITMAP_CHUNK_SZ / ptr_sz);
+		segment->m_bitvec_ready = 0;
+		next->m_bitvec_ready = 0;
 	}
+	// page bits don't split at arbitrary address, all pages of the second part are scanned
+	next->m_page_bitvec = NULL;
 }
 
 /////////////////////////////////////////////////////////////////////
@@ -157,7 +198,11 @@ add_one_segment(address_t vaddr, size_t size,
 		segment->m_reserved = 0;
 		segment->m_thread.tid = -1;
 		segment->m_module_name = NULL;
-		segment->m_ptr_bitvec = NULL;
+		segment->m_ptr_bitmap = NULL;
+		segment->m_page_bitvec = NULL;
+		// an appended segment doesn't move others
+		if (segment_index_ready())
+			index_one_segment(g_segment_count - 1);
 	}
 	else
 	{
@@ -169,6 +214,9 @@ add_one_segment(address_t vaddr, size_t size,
 		segment = get_segment(vaddr, size);
 		if (segment)
 		{
+			// indexes of segments are shifted by split, the index is built
+			// again by the caller once all segments are added
+			release_segment_index();
 			// an existing segment fully consists of the new one
 			// check the head
 			if (segment->m_vaddr < vaddr)
@@ -194,9 +242,201 @@ add_one_segment(address_t vaddr, size_t size,
 	return segment;
 }
 
+//////////////////////////////////////////////////////////////
+// Page-granular radix index of segments
+//	a root of 12 bits and four levels of 6 bits each cover 48-bit
+//	address space of 4KB pages. A slot either refers to the node
+//	of next level or holds one value for the whole range it covers,
+//	therefore huge reserved segments cost little, and a boundary of
+//	segments which is not aligned costs small nodes of 64 slots.
+//	A value is segment index plus one, zero for no segment.
+//	A page shared by more than one segment is left to binary search.
+//////////////////////////////////////////////////////////////
+#define SEG_PAGE_SHIFT   12
+#define SEG_PAGE_SZ      (1ul << SEG_PAGE_SHIFT)
+#define SEG_PAGE_COUNT(sz) (((sz) + SEG_PAGE_SZ - 1) >> SEG_PAGE_SHIFT)
+#define SEG_RADIX_ROOT_BITS 12
+#define SEG_RADIX_BITS   6
+#define SEG_RADIX_LEVELS 5
+#define SEG_RADIX_SPAN_BITS (SEG_PAGE_SHIFT + SEG_RADIX_ROOT_BITS + SEG_RADIX_BITS * (SEG_RADIX_LEVELS - 1))
+#define SEG_SHARED_PAGE  0x7fffffffu
+
+// bits of page number below the slots of the level
+#define SEG_RADIX_SHIFT(level) (SEG_RADIX_BITS * (SEG_RADIX_LEVELS - 1 - (level)))
+#define SEG_RADIX_FANOUT(level) (1u << ((level) ? SEG_RADIX_BITS : SEG_RADIX_ROOT_BITS))
+
+/*
+ * Nodes are carved from one pool of 32-bit slots, the root at offset 0.
+ * A slot is zero, the offset of the next node (node << 1), or (value << 1 | 1)
+ */
+static unsigned int* g_seg_radix_pool = NULL;
+static size_t g_seg_radix_size = 0;		// slots in use
+static size_t g_seg_radix_capacity = 0;
+
+#define SEG_RADIX_VALUE(v) (((unsigned int)(v) << 1) | 1)
+
+// Return the offset of a new node of the level, 0 if out of memory
+static unsigned int new_seg_radix_node(unsigned int level, unsigned int init)
+{
+	size_t node = g_seg_radix_size;
+	size_t i;
+
+	if (node + SEG_RADIX_FANOUT(level) > (SEG_SHARED_PAGE >> 1) + 1)
+		return 0;
+	if (node + SEG_RADIX_FANOUT(level) > g_seg_radix_capacity)
+	{
+		size_t capacity = g_seg_radix_capacity ? g_seg_radix_capacity * 2 : SEG_RADIX_FANOUT(0) * 4;
+		unsigned int* pool = (unsigned int*) realloc(g_seg_radix_pool, capacity * sizeof(unsigned int));
+		if (!pool)
+			return 0;
+		g_seg_radix_pool = pool;
+		g_seg_radix_capacity = capacity;
+	}
+	for (i = 0; i < SEG_RADIX_FANOUT(level); i++)
+		g_seg_radix_pool[node + i] = init;
+	g_seg_radix_size = node + SEG_RADIX_FANOUT(level);
+	return (unsigned int) node;
+}
+
+// Set pages [first, last] of the node's range to value
+static bool
+seg_radix_insert(unsigned int node, unsigned int level,
+		unsigned long long first, unsigned long long last, unsigned int value)
+{
+	unsigned int shift = SEG_RADIX_SHIFT(level);
+	unsigned long long slot_pages = 1ull << shift;
+	unsigned long long i;
+
+	for (i = first >> shift; i <= last >> shift; i++)
+	{
+		unsigned long long lo = i << shift;
+		unsigned long long hi = lo + slot_pages - 1;
+		unsigned long long sub_first = first > lo ? first : lo;
+		unsigned long long sub_last = last < hi ? last : hi;
+		// the pool may grow, slots are addressed by offset
+		size_t slot = node + i;
+		unsigned int child;
+
+		if (g_seg_radix_pool[slot] == 0 && sub_first == lo && sub_last == hi)
+		{
+			g_seg_radix_pool[slot] = SEG_RADIX_VALUE(value);
+			continue;
+		}
+		else if (g_seg_radix_pool[slot] & 1)
+		{
+			if (g_seg_radix_pool[slot] == SEG_RADIX_VALUE(value)
+				|| g_seg_radix_pool[slot] == SEG_RADIX_VALUE(SEG_SHARED_PAGE))
+				continue;
+			else if (shift == 0 || (sub_first == lo && sub_last == hi))
+			{
+				g_seg_radix_pool[slot] = SEG_RADIX_VALUE(SEG_SHARED_PAGE);
+				continue;
+			}
+			// push the old value down to the next level
+			child = new_seg_radix_node(level + 1, g_seg_radix_pool[slot]);
+			if (!child)
+				return false;
+			g_seg_radix_pool[slot] = child << 1;
+		}
+		else if (g_seg_radix_pool[slot] == 0)
+		{
+			child = new_seg_radix_node(level + 1, 0);
+			if (!child)
+				return false;
+			g_seg_radix_pool[slot] = child << 1;
+		}
+		else
+			child = g_seg_radix_pool[slot] >> 1;
+		if (!seg_radix_insert(child, level + 1, sub_first - lo, sub_last - lo, value))
+			return false;
+	}
+	return true;
+}
+
+// Return the value of the page, SEG_SHARED_PAGE if the index can't tell
+static inline unsigned int seg_radix_lookup(address_t addr)
+{
+	unsigned long long page = (unsigned long long)addr >> SEG_PAGE_SHIFT;
+	const unsigned int* pool = g_seg_radix_pool;
+	unsigned int node = 0;
+	unsigned int level;
+
+	if ((unsigned long long)addr >> SEG_RADIX_SPAN_BITS)
+		return SEG_SHARED_PAGE;
+	for (level = 0; level < SEG_RADIX_LEVELS; level++)
+	{
+		unsigned int slot = pool[node + ((page >> SEG_RADIX_SHIFT(level)) & (SEG_RADIX_FANOUT(level) - 1))];
+		if (slot & 1)
+			return slot >> 1;
+		else if (!slot)
+			return 0;
+		node = slot >> 1;
+	}
+	return SEG_SHARED_PAGE;
+}
+
+static void release_segment_index(void)
+{
+	free(g_seg_radix_pool);
+	g_seg_radix_pool = NULL;
+	g_seg_radix_size = 0;
+	g_seg_radix_capacity = 0;
+}
+
+bool segment_index_ready(void)
+{
+	return g_seg_radix_size > 0;
+}
+
+// Add the segment of the index to the radix index
+static bool index_one_segment(unsigned int index)
+{
+	const unsigned long long limit = 1ull << SEG_RADIX_SPAN_BITS;
+	struct ca_segment* segment = &g_segments[index];
+	unsigned long long start = segment->m_vaddr;
+	unsigned long long end = start + segment->m_vsize;
+
+	// the part beyond the index is left to binary search
+	if (segment->m_vsize == 0 || start >= limit)
+		return true;
+	if (end > limit || end < start)
+		end = limit;
+	if (!seg_radix_insert(0, 0, start >> SEG_PAGE_SHIFT, (end - 1) >> SEG_PAGE_SHIFT, index + 1))
+	{
+		release_segment_index();
+		return false;
+	}
+	return true;
+}
+
+//////////////////////////////////////////////////////////////
+// Build the index after all segments are collected
+// get_segment() resorts to binary search if it is not available
+//////////////////////////////////////////////////////////////
+bool build_segment_index(void)
+{
+	unsigned int i;
+
+	// workers search segments with the index
+	stop_bit_vec_workers();
+	release_segment_index();
+	if (g_segment_count == 0)
+		return false;
+	new_seg_radix_node(0, 0);
+	if (!segment_index_ready())
+		return false;
+	for (i = 0; i < g_segment_count; i++)
+	{
+		if (!index_one_segment(i))
+			return false;
+	}
+	return true;
+}
+
 //////////////////////////////////////////////////////////////
 // Return the segment containing the given memory range
-// use binary search since segments are sorted by vaddr
+// use the radix index if available, otherwise binary search
+// since segments are sorted by vaddr
 //////////////////////////////////////////////////////////////
 struct ca_segment* get_segment(address_t addr, size_t len)
 {
@@ -207,6 +447,21 @@ struct ca_segment* get_segment(address_t addr, size_t len)
 	if (len == 0)
 		len = 1;
 	target_end = addr + len;
+
+	if (segment_index_ready())
+	{
+		unsigned int value = seg_radix_lookup(addr);
+		if (value && value != SEG_SHARED_PAGE)
+		{
+			struct ca_segment* segment = &g_segments[value - 1];
+			if (addr >= segment->m_vaddr && target_end <= segment->m_vaddr + segment->m_vsize
+				&& target_end > addr)
+				return segment;
+		}
+		// no other segment shares the page
+		if (value != SEG_SHARED_PAGE && len == 1)
+			return NULL;
+	}
 	// bail out for out of bound addr
 	if (addr < g_segments[0].m_vaddr
 		|| target_end > g_segments[u_index-1].m_vaddr+g_segments[u_index-1].m_vsize)
@@ -229,27 +484,42 @@ struct ca_segment* get_segment(address_t addr, size_t len)
 bool alloc_bit_vec(void)
 {
 	unsigned int i;
-	char* buffer;
+	char* buffer = NULL;
 	size_t ptr_sz = g_ptr_bit >> 3;
 
-	g_bitvec_length = 0;
+	// bit vectors of pointers are compressed, and allocated as they are set
 	for (i=0; i<g_segment_count; i++)
 	{
 		struct ca_segment* segment = &g_segments[i];
-		size_t seg_bits = segment->m_fsize/ptr_sz;
-		g_bitvec_length += ALIGN(seg_bits, 32) >> 5;
+		if (segment->m_fsize > 0)
+		{
+			segment->m_ptr_bitmap = new_ptr_bitmap(segment->m_fsize/ptr_sz, PTR_BITMAP_CHUNK_SZ/ptr_sz);
+			if (!segment->m_ptr_bitmap)
+			{
+				CA_PRINT("Out of Memory\n");
+				return false;
+			}
+		}
 	}
-	// Carve the buffer into pieces for each segment's bit vector
+
+	// Carve the buffer into pieces for each core segment's page bit vector
+	g_bitvec_length = 0;
+	if (!g_debug_core)
+		return true;
+	for (i=0; i<g_segment_count; i++)
+		g_bitvec_length += ALIGN(SEG_PAGE_COUNT(g_segments[i].m_fsize), 32) >> 5;
 	g_bitvec_length *= sizeof(unsigned int);
-	buffer = (char*) sys_alloc(g_bitvec_length);
+	if (g_bitvec_length)
+		buffer = (char*) sys_alloc(g_bitvec_length);
+	if (!buffer)
+		return true;	// every page is considered populated
 	for (i=0; i<g_segment_count; i++)
 	{
 		struct ca_segment* segment = &g_segments[i];
 		if (segment->m_fsize > 0)
 		{
-			size_t seg_bits = segment->m_fsize/ptr_sz;
-			segment->m_ptr_bitvec = (unsigned int*) buffer;
-			buffer += ALIGN(seg_bits, 32) >> 3;
+			segment->m_page_bitvec = (unsigned int*) buffer;
+			buffer += ALIGN(SEG_PAGE_COUNT(segment->m_fsize), 32) >> 3;
 		}
 	}
 	return true;
@@ -377,124 +647,689 @@ bool test_segments(bool verbose)
 //		use a bitvec to indicate whether a data in target's
 //		address space is a pointer or not.
 //////////////////////////////////////////////////////////////
-bool set_addressable_bit_vec(struct ca_segment* segment)
+//////////////////////////////////////////////////////////////
+// Populated pages of a core file
+//	holes of the core file are found by SEEK_DATA/SEEK_HOLE
+//	without reading them, and pages of zeros are found by
+//	reading them once when the bit vector is set. Scanners
+//	then skip unpopulated pages wholesale.
+//////////////////////////////////////////////////////////////
+static int         g_core_fd = -1;
+static const char* g_core_base = NULL;
+static size_t      g_core_size = 0;
+
+void set_core_file(int fd, const char* base, size_t size)
+{
+	g_core_fd = fd;
+	g_core_base = base;
+	g_core_size = size;
+}
+
+bool get_core_file_stat(size_t* size, long long* mtime)
 {
-	if (segment->m_fsize>0 && !segment->m_bitvec_ready)
+#ifndef WIN32
+	struct stat st;
+	if (g_core_fd != -1 && fstat(g_core_fd, &st) == 0)
 	{
-		size_t ptr_sz = g_ptr_bit >> 3;
-		const char* start = segment->m_faddr;
-		const char* next  = start;
-		const char* end   = start + segment->m_fsize;
+		*size = st.st_size;
+		*mtime = st.st_mtime;
+		return true;
+	}
+#endif
+	return false;
+}
 
-		while (next + ptr_sz <= end)
+static bool zero_page(const char* data, size_t sz)
+{
+	const char* end = data + sz;
+	for (; data + sizeof(address_t) <= end; data += sizeof(address_t))
+	{
+		if (*(const address_t*)data)
+			return false;
+	}
+	for (; data < end; data++)
+	{
+		if (*data)
+			return false;
+	}
+	return true;
+}
+
+// Find the data of [begin, end) of the segment in the core file
+//	set *data_begin and *data_end to the first run of pages with data
+//	return false if there is no data
+static bool
+next_data_run(struct ca_segment* segment, size_t begin, size_t end,
+		size_t* data_begin, size_t* data_end)
+{
+	*data_begin = begin;
+	*data_end = end;
+#if defined(SEEK_DATA) && defined(SEEK_HOLE)
+	if (g_core_fd != -1 && segment->m_faddr >= g_core_base
+		&& segment->m_faddr + segment->m_fsize <= g_core_base + g_core_size)
+	{
+		off_t seg_offset = segment->m_faddr - g_core_base;
+		off_t data = lseek(g_core_fd, seg_offset + begin, SEEK_DATA);
+		off_t hole;
+
+		if (data == (off_t)-1)
+			return errno != ENXIO;	// ENXIO means only a hole to the file end
+		if ((size_t)(data - seg_offset) >= end)
+			return false;
+		*data_begin = (data - seg_offset) & ~(SEG_PAGE_SZ - 1);
+		if (*data_begin < begin)
+			*data_begin = begin;
+		hole = lseek(g_core_fd, data, SEEK_HOLE);
+		if (hole != (off_t)-1)
 		{
-			address_t val = 0;
-			if (ptr_sz == 8)
-			{
-#ifdef sun
-				// data in sparcv9 core file aligns on 4-byte only. sigh..
-				if ((address_t)next & 0x7ul)
-					memcpy(&val, next, 8);
-				else
+			size_t hole_offset = ALIGN((size_t)(hole - seg_offset), SEG_PAGE_SZ);
+			if (hole_offset < end)
+				*data_end = hole_offset;
+		}
+	}
 #endif
-					val = *(address_t*)next;
-			}
-			else
-				val = *(unsigned int*)next;
-			// Assuming bitvec is sparse,
-			// Get its buffer by mmap therefore initial values are zero
-			// We only need to set the bits of addressable pointers
-			if (val)
+	return true;
+}
+
+// Classify words of [begin, end) of the segment, offsets in bytes, into
+// the bits of the range starting at bits_offset.
+// begin is aligned on a word of the bits, i.e. 32 pointers
+static void
+classify_range(struct ca_segment* segment, size_t begin, size_t end_offset,
+		unsigned int* bits, size_t bits_offset)
+{
+	size_t ptr_sz = g_ptr_bit >> 3;
+	size_t nwords = (end_offset - begin) / ptr_sz;
+
+	classify_ptr_words(segment->m_faddr + begin, nwords, ptr_sz,
+			bits + ((begin - bits_offset) / ptr_sz >> 5), segment);
+}
+
+// Set bits of pointers and populated pages of [begin, end) of the segment
+// begin is aligned on 32 pages and a container of the pointer bit vector,
+// so that different callers never share a word or a container
+static void
+set_addressable_bits(struct ca_segment* segment, size_t begin, size_t end_offset)
+{
+	size_t ptr_sz = g_ptr_bit >> 3;
+	const char* data = segment->m_faddr + begin;
+	size_t data_sz = end_offset - begin;
+	size_t range_begin = begin;
+	size_t run_begin, run_end, offset;
+	// dense bits of the range, compressed afterwards
+	std::vector<unsigned int> bits(ALIGN(data_sz, PTR_BITMAP_CHUNK_SZ) / ptr_sz >> 5, 0);
+
+	// bits are left clear if the compressed data is corrupted
+	if (g_core_compressed && !pin_core_range(data, data_sz))
+		return;
+	if (!segment->m_page_bitvec)
+		classify_range(segment, begin, end_offset, &bits[0], range_begin);
+	else
+	{
+		while (begin < end_offset && next_data_run(segment, begin, end_offset, &run_begin, &run_end))
+		{
+			// coalesce pages with data for the classifier
+			size_t page, populated = run_begin;
+			for (page = run_begin; page < run_end; page += SEG_PAGE_SZ)
 			{
-				// there is a good chance that a valid ptr points to its own segment where the ptr is
-				if ( (val >= segment->m_vaddr && val < segment->m_vaddr + segment->m_vsize)
-					|| get_segment(val, 1) )
+				size_t page_end = page + SEG_PAGE_SZ < run_end ? page + SEG_PAGE_SZ : run_end;
+				size_t page_index = page >> SEG_PAGE_SHIFT;
+				if (zero_page(segment->m_faddr + page, page_end - page))
 				{
-					size_t offset = (next - start) / ptr_sz;
-					unsigned int bit = 1 << (offset & (size_t)0x1F);
-					segment->m_ptr_bitvec[offset>>5] |= bit;
+					if (page > populated)
+						classify_range(segment, populated, page, &bits[0], range_begin);
+					populated = page_end;
 				}
+				else
+					segment->m_page_bitvec[page_index >> 5] |= 1u << (page_index & 0x1f);
 			}
-			next += ptr_sz;
+			if (run_end > populated)
+				classify_range(segment, populated, run_end, &bits[0], range_begin);
+			begin = run_end;
+		}
+	}
+	if (g_core_compressed)
+		unpin_core_range(data, data_sz);
+
+	for (offset = range_begin; offset < end_offset; offset += PTR_BITMAP_CHUNK_SZ)
+	{
+		set_ptr_bitmap_chunk(segment->m_ptr_bitmap, offset / PTR_BITMAP_CHUNK_SZ,
+				&bits[(offset - range_begin) / ptr_sz >> 5]);
+	}
+}
+
+size_t next_populated_offset(const struct ca_segment* segment, size_t offset)
+{
+	size_t page_index, npages;
+
+	if (!segment->m_page_bitvec || !segment->m_bitvec_ready || offset >= segment->m_fsize)
+		return offset < segment->m_fsize ? offset : segment->m_fsize;
+	page_index = offset >> SEG_PAGE_SHIFT;
+	npages = SEG_PAGE_COUNT(segment->m_fsize);
+	while (page_index < npages)
+	{
+		unsigned int bits = segment->m_page_bitvec[page_index >> 5] >> (page_index & 0x1f);
+		if (bits == 0)
+		{
+			page_index = (page_index & ~(size_t)0x1f) + 32;
+			continue;
+		}
+		while (!(bits & 1))
+		{
+			bits >>= 1;
+			page_index++;
+		}
+		if ((page_index << SEG_PAGE_SHIFT) <= offset)
+			return offset;
+		return page_index << SEG_PAGE_SHIFT;
+	}
+	return segment->m_fsize;
+}
+
+size_t next_unpopulated_offset(const struct ca_segment* segment, size_t offset)
+{
+	size_t page_index, npages;
+
+	if (!segment->m_page_bitvec || !segment->m_bitvec_ready || offset >= segment->m_fsize)
+		return segment->m_fsize;
+	page_index = offset >> SEG_PAGE_SHIFT;
+	npages = SEG_PAGE_COUNT(segment->m_fsize);
+	while (page_index < npages)
+	{
+		unsigned int bits = ~segment->m_page_bitvec[page_index >> 5] >> (page_index & 0x1f);
+		if (bits == 0)
+		{
+			page_index = (page_index & ~(size_t)0x1f) + 32;
+			continue;
+		}
+		while (!(bits & 1))
+		{
+			bits >>= 1;
+			page_index++;
+		}
+		if (page_index >= npages)
+			break;
+		if ((page_index << SEG_PAGE_SHIFT) <= offset)
+			return offset;
+		return page_index << SEG_PAGE_SHIFT;
+	}
+	return segment->m_fsize;
+}
+
+//////////////////////////////////////////////////////////////
+// For a core file, bit vectors of all segments are built by
+// the worker pool in the background. Big segments are split
+// into page-aligned chunks. A query claims and builds the
+// chunks of the segment it needs and waits only for those
+// chunks that workers are building.
+//////////////////////////////////////////////////////////////
+#define BITVEC_CHUNK_SZ (4ul*1024*1024)
+#define DEFAULT_PTR_BITMAP_BUDGET (2ul*1024*1024*1024)
+
+static size_t g_bitvec_budget = DEFAULT_PTR_BITMAP_BUDGET;
+
+struct bitvec_chunk
+{
+	unsigned int seg_index;
+	size_t begin;		// offsets in bytes to the segment start
+	size_t end;
+};
+
+static std::vector<struct bitvec_chunk> g_bitvec_chunks;
+static std::unique_ptr<std::atomic<bool>[]> g_bitvec_claimed;
+static std::vector<unsigned int> g_seg_first_chunk;	// g_segment_count+1 entries
+static std::vector<unsigned int> g_seg_chunks_todo;	// guarded by g_bitvec_lock
+static std::atomic<size_t> g_bitvec_cursor(0);
+static std::atomic<bool> g_bitvec_cancel(false);
+static unsigned int g_bitvec_workers = 0;		// guarded by g_bitvec_lock
+static bool g_bitvec_started = false;
+static std::mutex g_bitvec_lock;
+static std::condition_variable g_bitvec_cond;
+// bitmaps that workers have completed ahead of queries, guarded by g_bitvec_lock
+static std::vector<struct ptr_bitmap*> g_bitvec_built;
+
+// Return false if the chunk has been claimed by others
+static bool build_bit_vec_chunk(size_t chunk_index)
+{
+	if (g_bitvec_claimed[chunk_index].exchange(true))
+		return false;
+
+	const struct bitvec_chunk& chunk = g_bitvec_chunks[chunk_index];
+	if (!g_bitvec_cancel)
+		set_addressable_bits(&g_segments[chunk.seg_index], chunk.begin, chunk.end);
+
+	std::lock_guard<std::mutex> guard(g_bitvec_lock);
+	if (--g_seg_chunks_todo[chunk.seg_index] == 0)
+	{
+		g_bitvec_built.push_back(g_segments[chunk.seg_index].m_ptr_bitmap);
+		g_bitvec_cond.notify_all();
+	}
+	return true;
+}
+
+// A worker builds one chunk at a time, then queues itself behind the
+// tasks of queries, which the pool runs first
+static void bit_vec_worker(void)
+{
+	size_t i = g_bitvec_cursor++;
+
+	// stop building ahead of queries once bit vectors use up their budget
+	if (i < g_bitvec_chunks.size() && !g_bitvec_cancel
+		&& ptr_bitmap_total_bytes() < g_bitvec_budget)
+	{
+		build_bit_vec_chunk(i);
+		CA_THREAD_POOL.submit(bit_vec_worker);
+		return;
+	}
+
+	std::lock_guard<std::mutex> guard(g_bitvec_lock);
+	if (--g_bitvec_workers == 0)
+		g_bitvec_cond.notify_all();
+}
+
+static void start_bit_vec_workers(void)
+{
+	unsigned int i;
+	unsigned int nworkers = CA_THREAD_POOL.size();
+	static bool stop_at_exit = false;
+
+	// registered after the pool is created, it runs before the pool is
+	// destroyed, so the workers are not left building bit vectors
+	if (!stop_at_exit)
+	{
+		atexit(stop_bit_vec_workers);
+		stop_at_exit = true;
+	}
+	g_bitvec_started = true;
+	g_bitvec_chunks.clear();
+	g_seg_first_chunk.assign(g_segment_count + 1, 0);
+	g_seg_chunks_todo.assign(g_segment_count, 0);
+	for (i = 0; i < g_segment_count; i++)
+	{
+		struct ca_segment* segment = &g_segments[i];
+		g_seg_first_chunk[i] = g_bitvec_chunks.size();
+		if (segment->m_fsize == 0 || segment->m_bitvec_ready)
+			continue;
+		for (size_t begin = 0; begin < segment->m_fsize; begin += BITVEC_CHUNK_SZ)
+		{
+			struct bitvec_chunk chunk;
+			chunk.seg_index = i;
+			chunk.begin = begin;
+			chunk.end = begin + BITVEC_CHUNK_SZ;
+			if (chunk.end > segment->m_fsize)
+				chunk.end = segment->m_fsize;
+			g_bitvec_chunks.push_back(chunk);
+			g_seg_chunks_todo[i]++;
+		}
+	}
+	g_seg_first_chunk[g_segment_count] = g_bitvec_chunks.size();
+	g_bitvec_claimed.reset(new std::atomic<bool>[g_bitvec_chunks.size()]);
+	for (i = 0; i < g_bitvec_chunks.size(); i++)
+		g_bitvec_claimed[i] = false;
+	g_bitvec_cursor = 0;
+	g_bitvec_cancel = false;
+
+	// Workers keep going in the background after the first query returns
+	g_bitvec_workers = nworkers;
+	for (i = 0; i < nworkers; i++)
+		CA_THREAD_POOL.submit(bit_vec_worker);
+}
+
+// Called before the segments or their bit vectors are released
+static void stop_bit_vec_workers(void)
+{
+	if (!g_bitvec_started)
+		return;
+	g_bitvec_cancel = true;
+	{
+		std::unique_lock<std::mutex> guard(g_bitvec_lock);
+		while (g_bitvec_workers)
+			g_bitvec_cond.wait(guard);
+	}
+	g_bitvec_chunks.clear();
+	g_bitvec_claimed.reset();
+	g_seg_first_chunk.clear();
+	g_seg_chunks_todo.clear();
+	g_bitvec_built.clear();
+	g_bitvec_started = false;
+}
+
+//////////////////////////////////////////////////////////////
+// Bit vectors of cold segments are evicted when all of them
+// use more memory than the budget, so that a core larger than
+// the host's memory can be searched. An evicted bit vector is
+// rebuilt when its segment is used again.
+//	bitmaps used by queries are kept in the order of their last
+//	use, with their sizes. Those that workers have built ahead of
+//	queries are never used yet, and they are evicted first.
+//////////////////////////////////////////////////////////////
+typedef std::pair<unsigned long, struct ptr_bitmap*> bitvec_lru_key;	// last use, bitmap
+static std::map<bitvec_lru_key, size_t> g_bitvec_lru;		// => bytes
+static unsigned long g_bitvec_clock = 0;
+// bit vectors used at or after this clock are pinned
+static unsigned long g_bitvec_pin_clock = ULONG_MAX;
+static size_t g_bitvec_pinned_bytes = 0;
+
+static void forget_bit_vec(struct ptr_bitmap* bitmap)
+{
+	if (bitmap)
+	{
+		g_bitvec_lru.erase(bitvec_lru_key(bitmap->m_last_use, bitmap));
+		std::lock_guard<std::mutex> guard(g_bitvec_lock);
+		g_bitvec_built.erase(std::remove(g_bitvec_built.begin(), g_bitvec_built.end(), bitmap),
+				g_bitvec_built.end());
+	}
+}
+
+static void forget_all_bit_vecs(void)
+{
+	g_bitvec_lru.clear();
+	g_bitvec_pinned_bytes = 0;
+}
+
+static void evict_bit_vec(struct ptr_bitmap* bitmap)
+{
+	clear_ptr_bitmap(bitmap);
+	bitmap->m_evicted = true;
+}
+
+// Mark the bitmap as the most recently used, its size is counted again
+// if it has just been built
+static void touch_bit_vec(struct ptr_bitmap* bitmap, bool built)
+{
+	auto itr = g_bitvec_lru.find(bitvec_lru_key(bitmap->m_last_use, bitmap));
+	size_t bytes;
+
+	if (itr != g_bitvec_lru.end())
+	{
+		bytes = built ? ptr_bitmap_bytes(bitmap) : itr->second;
+		g_bitvec_lru.erase(itr);
+	}
+	else
+		bytes = ptr_bitmap_bytes(bitmap);
+	// first use since pin_bit_vecs()
+	if (g_bitvec_pin_clock != ULONG_MAX && bitmap->m_last_use < g_bitvec_pin_clock)
+		g_bitvec_pinned_bytes += bytes;
+	bitmap->m_last_use = ++g_bitvec_clock;
+	g_bitvec_lru[bitvec_lru_key(bitmap->m_last_use, bitmap)] = bytes;
+}
+
+static void evict_cold_bit_vecs(const struct ptr_bitmap* keep)
+{
+	// bitmaps built by workers and not used by any query
+	while (ptr_bitmap_total_bytes() > g_bitvec_budget)
+	{
+		struct ptr_bitmap* victim = NULL;
+		{
+			std::lock_guard<std::mutex> guard(g_bitvec_lock);
+			if (g_bitvec_built.empty())
+				break;
+			victim = g_bitvec_built.back();
+			g_bitvec_built.pop_back();
+		}
+		if (victim && victim->m_last_use == 0 && !victim->m_evicted)
+			evict_bit_vec(victim);
+	}
+	// then the least recently used, which are not pinned
+	while (ptr_bitmap_total_bytes() > g_bitvec_budget && !g_bitvec_lru.empty())
+	{
+		auto itr = g_bitvec_lru.begin();
+		struct ptr_bitmap* victim = itr->first.second;
+
+		if (itr->first.first >= g_bitvec_pin_clock)
+			break;
+		if (victim == keep)
+		{
+			if (++itr == g_bitvec_lru.end() || itr->first.first >= g_bitvec_pin_clock)
+				break;
+			victim = itr->first.second;
+		}
+		g_bitvec_lru.erase(itr);
+		evict_bit_vec(victim);
+	}
+}
+
+void pin_bit_vecs(void)
+{
+	g_bitvec_pin_clock = g_bitvec_clock + 1;
+	g_bitvec_pinned_bytes = 0;
+}
+
+void unpin_bit_vecs(void)
+{
+	g_bitvec_pin_clock = ULONG_MAX;
+	g_bitvec_pinned_bytes = 0;
+}
+
+// bitmaps pinned by the current batch fill the budget, others may be evicted
+bool bit_vecs_over_budget(void)
+{
+	return g_bitvec_pinned_bytes >= g_bitvec_budget;
+}
+
+void set_bit_vec_budget(size_t mb)
+{
+	if (mb)
+	{
+		g_bitvec_budget = mb << 20;
+		evict_cold_bit_vecs(NULL);
+	}
+	CA_PRINT("Memory budget of pointer bitmaps is " PRINT_FORMAT_SIZE " MB, " PRINT_FORMAT_SIZE " MB are used\n",
+		g_bitvec_budget >> 20, ptr_bitmap_total_bytes() >> 20);
+}
+
+bool set_addressable_bit_vec(struct ca_segment* segment)
+{
+	struct ptr_bitmap* bitmap = segment->m_ptr_bitmap;
+
+	if (segment->m_fsize>0 && (!segment->m_bitvec_ready || bitmap->m_evicted))
+	{
+		if (!ptr_range_table_ready())
+			build_ptr_range_table();
+		if (bitmap->m_evicted)
+		{
+			// chunks have been built before, rebuild them in parallel
+			size_t nchunks = ALIGN(segment->m_fsize, BITVEC_CHUNK_SZ) / BITVEC_CHUNK_SZ;
+			CA_THREAD_POOL.parallel_for(nchunks, [segment](size_t i) {
+				size_t begin = i * BITVEC_CHUNK_SZ;
+				size_t end = begin + BITVEC_CHUNK_SZ;
+				set_addressable_bits(segment, begin, end < segment->m_fsize ? end : segment->m_fsize);
+			});
+			bitmap->m_evicted = false;
+		}
+		else if (g_debug_core)
+		{
+			unsigned int seg_index = segment - &g_segments[0];
+			unsigned int i;
+
+			if (!g_bitvec_started)
+				start_bit_vec_workers();
+			// help with my own chunks, then wait for those taken by workers
+			for (i = g_seg_first_chunk[seg_index]; i < g_seg_first_chunk[seg_index + 1]; i++)
+				build_bit_vec_chunk(i);
+			std::unique_lock<std::mutex> guard(g_bitvec_lock);
+			while (g_seg_chunks_todo[seg_index])
+				g_bitvec_cond.wait(guard);
 		}
+		else
+			set_addressable_bits(segment, 0, segment->m_fsize);
 		// done
 		segment->m_bitvec_ready = 1;
+		touch_bit_vec(bitmap, true);
+		evict_cold_bit_vecs(bitmap);
 	}
+	else if (bitmap)
+		touch_bit_vec(bitmap, false);
 	return true;
 }
 
 //////////////////////////////////////////////////////////////
-// A simple implementation to remember user's choice of fake
-// data values
+// User's choice of fake data values
+//	patched words are kept sorted by address, together with
+//	the pages they are on. A read is looked up in the overlay
+//	only if it touches a patched page.
 //////////////////////////////////////////////////////////////
-struct temp_value
+static std::map<address_t, address_t> g_set_values;
+static std::unordered_map<address_t, unsigned int> g_patched_pages;	// page => number of patches
+
+// a patch is accounted on the pages of the widest word
+static void count_patched_pages(address_t addr, int inc)
 {
-	struct temp_value* next;
-	address_t addr;
-	address_t value;
-};
+	address_t first = addr >> SEG_PAGE_SHIFT;
+	address_t last = (addr + sizeof(address_t) - 1) >> SEG_PAGE_SHIFT;
+	for (address_t page = first; page <= last; page++)
+	{
+		if ((g_patched_pages[page] += inc) == 0)
+			g_patched_pages.erase(page);
+	}
+}
 
-static struct temp_value* g_set_values = NULL;
+// edges of the reference index are from the unpatched memory
+static void drop_patched_ref_index(void)
+{
+	if (ref_index_ready())
+	{
+		release_ref_index();
+		CA_PRINT("Reference index is dropped because memory is patched\n");
+	}
+}
 
 void set_value (address_t addr, address_t value)
 {
-	struct temp_value* pval = (struct temp_value*) malloc(sizeof(struct temp_value));
-	pval->next = g_set_values;
-	pval->addr = addr;
-	pval->value = value;
-	g_set_values = pval;
+	drop_patched_ref_index();
+	auto result = g_set_values.insert(std::make_pair(addr, value));
+	if (result.second)
+		count_patched_pages(addr, 1);
+	else
+		result.first->second = value;
 }
 
 void unset_value (address_t addr)
 {
-	struct temp_value* pval = g_set_values;
-	struct temp_value* previous = NULL;
-	while (pval)
+	if (g_set_values.erase(addr))
 	{
-		if (pval->addr == addr)
-		{
-			if (previous)
-				previous->next = pval->next;
-			else
-				g_set_values = pval->next;
-			free (pval);
-			return;
-		}
-		previous = pval;
+		drop_patched_ref_index();
+		count_patched_pages(addr, -1);
 	}
 }
 
 void print_set_values (void)
 {
-	struct temp_value* pval = g_set_values;
-	if (!pval)
+	if (g_set_values.empty())
 	{
 		CA_PRINT("No value is set\n");
 		return;
 	}
 
-	while (pval)
+	for (auto& patch : g_set_values)
+		CA_PRINT(PRINT_FORMAT_POINTER": " PRINT_FORMAT_POINTER "\n", patch.first, patch.second);
+}
+
+// One patch per line, "<address> <value>" in hex
+bool save_set_values (const char* fname)
+{
+	FILE* fp = fopen(fname, "w");
+	if (!fp)
 	{
-		CA_PRINT(PRINT_FORMAT_POINTER": " PRINT_FORMAT_POINTER "\n", pval->addr, pval->value);
-		pval = pval->next;
+		CA_PRINT("Failed to open file %s\n", fname);
+		return false;
 	}
+	for (auto& patch : g_set_values)
+		fprintf(fp, PRINT_FORMAT_POINTER " " PRINT_FORMAT_POINTER "\n", patch.first, patch.second);
+	fclose(fp);
+	CA_PRINT("%ld values are saved to %s\n", (long)g_set_values.size(), fname);
+	return true;
 }
 
-static bool get_preset_value (address_t addr, void* buffer, size_t sz)
+bool load_set_values (const char* fname)
 {
-	size_t ptr_sz = g_ptr_bit >> 3;
-	struct temp_value* pval = g_set_values;
-	while (pval)
+	char line[256];
+	unsigned long count = 0;
+	FILE* fp = fopen(fname, "r");
+	if (!fp)
+	{
+		CA_PRINT("Failed to open file %s\n", fname);
+		return false;
+	}
+	while (fgets(line, sizeof(line), fp))
 	{
-		if (pval->addr >= addr && pval->addr + ptr_sz <= addr + sz)
+		char* next;
+		char* end;
+		address_t addr = strtoull(line, &next, 16);
+		address_t value;
+		if (next == line)
+			continue;	// blank or comment line
+		value = strtoull(next, &end, 16);
+		if (end == next)
 		{
-			if (ptr_sz == 8)
-				*(address_t*)((char*)buffer + (pval->addr - addr)) = pval->value;
-			else
-				*(unsigned int*)((char*)buffer + (pval->addr - addr)) = pval->value;
+			CA_PRINT("Ignore invalid line: %s", line);
+			continue;
 		}
-		pval = pval->next;
+		set_value(addr, value);
+		count++;
 	}
+	fclose(fp);
+	CA_PRINT("%ld values are loaded from %s\n", count, fname);
+	return true;
+}
+
+bool has_set_values (void)
+{
+	return !g_set_values.empty();
+}
+
+static bool preset_value_in_range(address_t addr, size_t sz)
+{
+	size_t ptr_sz = g_ptr_bit >> 3;
+
+	if (g_set_values.empty() || sz == 0)
+		return false;
+	// a range within a page touches at most two pages
+	if (sz <= SEG_PAGE_SZ
+		&& g_patched_pages.find(addr >> SEG_PAGE_SHIFT) == g_patched_pages.end()
+		&& g_patched_pages.find((addr + sz - 1) >> SEG_PAGE_SHIFT) == g_patched_pages.end())
+		return false;
+	auto itr = g_set_values.lower_bound(addr >= ptr_sz ? addr - ptr_sz + 1 : 0);
+	return itr != g_set_values.end() && itr->first < addr + sz;
+}
+
+// Apply patched words that are within the buffer
+static void get_preset_value (address_t addr, void* buffer, size_t sz)
+{
+	size_t ptr_sz = g_ptr_bit >> 3;
+	for (auto itr = g_set_values.lower_bound(addr);
+		itr != g_set_values.end() && itr->first + ptr_sz <= addr + sz; ++itr)
+	{
+		if (ptr_sz == 8)
+			*(address_t*)((char*)buffer + (itr->first - addr)) = itr->second;
+		else
+			*(unsigned int*)((char*)buffer + (itr->first - addr)) = itr->second;
+	}
+}
+
+// Copy from the mmapped core, which the caller has checked to
+// cover the range
+static inline bool
+copy_mapped_memory(struct ca_segment* segment, address_t addr, void* buffer, size_t sz)
+{
+	size_t ptr_sz = g_ptr_bit >> 3;
+	char* mapped_addr = (char*)(segment->m_faddr + (addr - segment->m_vaddr));
+
+	if (g_core_compressed && !pin_core_range(mapped_addr, sz))
+		return false;
+#if !defined(sun)
+	if (sz == ptr_sz)	// fast path for pointer/ref
+	{
+		if (ptr_sz == 8)
+			*(address_t*)buffer = *(address_t*)mapped_addr;
+		else
+			*(unsigned int*)buffer = *(unsigned int*)mapped_addr;
+	}
+	else
+#endif
+		memcpy(buffer, mapped_addr, sz);
+	if (g_core_compressed)
+		unpin_core_range(mapped_addr, sz);
 	return true;
 }
 
@@ -503,28 +1338,14 @@ static bool get_preset_value (address_t addr, void* buffer, size_t sz)
 //////////////////////////////////////////////////////////////
 bool read_memory_wrapper (struct ca_segment* segment, address_t addr, void* buffer, size_t sz)
 {
-	size_t ptr_sz = g_ptr_bit >> 3;
 	bool rc = false;
 	if (g_debug_core && g_segment_count)
 	{
-		char* mapped_addr;
 		static struct ca_segment* last_seg  = NULL;
 		// use caller provided segment
 		if (segment && addr >= segment->m_vaddr && addr+sz <= segment->m_vaddr+segment->m_fsize)
 		{
-			mapped_addr = (char*)(segment->m_faddr + (addr - segment->m_vaddr));
-#if !defined(sun)
-			if (sz == ptr_sz)	// fast path for pointer/ref
-			{
-				if (ptr_sz == 8)
-					*(address_t*)buffer = *(address_t*)mapped_addr;
-				else
-					*(unsigned int*)buffer = *(unsigned int*)mapped_addr;
-			}
-			else
-#endif
-				memcpy(buffer, mapped_addr, sz);
-			rc = true;
+			rc = copy_mapped_memory(segment, addr, buffer, sz);
 		}
 		// Otherwise, find the belonging segment and cache it
 		else if (!last_seg || addr < last_seg->m_vaddr || addr+sz > last_seg->m_vaddr+last_seg->m_fsize)
@@ -532,23 +1353,12 @@ bool read_memory_wrapper (struct ca_segment* segment, address_t addr, void* buff
 
 		if (!rc && last_seg && addr >= last_seg->m_vaddr && addr+sz <= last_seg->m_vaddr+last_seg->m_fsize)
 		{
-			mapped_addr = (char*)(last_seg->m_faddr + (addr - last_seg->m_vaddr));
-#if !defined(sun)
-			if (sz == ptr_sz)	// fast path for pointer/ref
-			{
-				if (ptr_sz == 8)
-					*(address_t*)buffer = *(address_t*)mapped_addr;
-				else
-					*(unsigned int*)buffer = *(unsigned int*)mapped_addr;
-			}
-			else
-#endif
-				memcpy(buffer, mapped_addr, sz);
-			rc = true;
+			rc = copy_mapped_memory(last_seg, addr, buffer, sz);
 		}
 #if defined(__MACH__)
 		if (!rc)
 		{
+			char* mapped_addr;
 			// MacOS's heap data structure crosses segments' boundary
 			segment = get_segment(addr, 1);
 			if (segment && addr + sz > segment->m_vaddr + segment->m_vsize && segment->m_vsize == segment->m_fsize)
@@ -569,12 +1379,77 @@ bool read_memory_wrapper (struct ca_segment* segment, address_t addr, void* buff
 	else
 		rc = inferior_memory_read(addr, buffer, sz);
 	// if user preset values within the range, use it
-	if (rc && g_set_values)
+	if (rc && preset_value_in_range(addr, sz))
 		get_preset_value(addr, buffer, sz);
 
 	return rc;
 }
 
+//////////////////////////////////////////////////////////////
+// Set the view to target's memory [addr, addr+sz)
+//	without copy if the range is within one mmapped segment
+//	of an uncompressed core and has no preset value. Otherwise, no more than
+//	MEMORY_VIEW_WINDOW bytes of the range are copied to the view's buffer up
+//	to the first unreadable word.
+// Return false if nothing is readable.
+//////////////////////////////////////////////////////////////
+bool get_memory_view(address_t addr, size_t sz, struct ca_memory_view* view)
+{
+	size_t ptr_sz = g_ptr_bit >> 3;
+	size_t offset;
+
+	view->m_vaddr = addr;
+	view->m_data = NULL;
+	view->m_size = 0;
+	if (sz == 0)
+		return false;
+
+	// a compressed core's data is not stable without a pin
+	if (g_debug_core && g_segment_count && !g_core_compressed
+		&& !preset_value_in_range(addr, sz))
+	{
+		struct ca_segment* segment = get_segment(addr, 1);
+		if (segment && segment->m_faddr && addr + sz <= segment->m_vaddr + segment->m_fsize)
+		{
+			view->m_data = segment->m_faddr + (addr - segment->m_vaddr);
+			view->m_size = sz;
+			return true;
+		}
+	}
+
+	// the slow path, a compressed core is pinned a window at a time
+	if (sz > MEMORY_VIEW_WINDOW)
+		sz = MEMORY_VIEW_WINDOW;
+	if (view->m_capacity < sz)
+	{
+		char* buffer = (char*) realloc(view->m_buffer, sz);
+		if (!buffer)
+		{
+			CA_PRINT("Out of Memory\n");
+			return false;
+		}
+		view->m_buffer = buffer;
+		view->m_capacity = sz;
+	}
+	view->m_data = view->m_buffer;
+	// an unreadable word fails fast, callers skip it and resume after it
+	offset = sz < ptr_sz ? sz : ptr_sz;
+	if (!read_memory_wrapper(NULL, addr, view->m_buffer, offset))
+		return false;
+	if (offset == sz || read_memory_wrapper(NULL, addr, view->m_buffer, sz))
+	{
+		view->m_size = sz;
+		return true;
+	}
+	for (; offset + ptr_sz <= sz; offset += ptr_sz)
+	{
+		if (!read_memory_wrapper(NULL, addr + offset, view->m_buffer + offset, ptr_sz))
+			break;
+	}
+	view->m_size = offset;
+	return offset > 0;
+}
+
 //////////////////////////////////////////////////////////////
 // virtual address to mmaped-file address
 //////////////////////////////////////////////////////////////
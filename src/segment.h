@@ -9,6 +9,7 @@
 #define SEGMENT_H_
 
 #include "ref.h"
+#include "ptr_bitmap.h"
 
 struct ca_thread
 {
@@ -29,7 +30,8 @@ struct ca_segment
 	unsigned int m_write:1;
 	unsigned int m_exec:1;
 	unsigned int m_reserved:28;
-	unsigned int* m_ptr_bitvec;		// bit vector of addressable pointers
+	struct ptr_bitmap* m_ptr_bitmap;	// compressed bit vector of addressable pointers
+	unsigned int* m_page_bitvec;	// bit vector of pages with data, core file only
 	struct ca_thread m_thread;
 	const char*   m_module_name;
 };
@@ -48,8 +50,43 @@ extern bool test_segments(bool verbose);
 
 extern struct ca_segment* get_segment(address_t addr, size_t len);
 
+extern bool build_segment_index(void);
+
+extern bool segment_index_ready(void);
+
 extern bool set_addressable_bit_vec(struct ca_segment*);
 
+/*
+ * Bit vectors set after pin_bit_vecs() are not evicted until
+ * unpin_bit_vecs(), so that workers may read them without a lock.
+ * The budget may be exceeded in the meantime.
+ */
+extern void pin_bit_vecs(void);
+
+extern void unpin_bit_vecs(void);
+
+extern bool bit_vecs_over_budget(void);
+
+// Set the memory budget of bit vectors in MB, or show it if mb is 0
+extern void set_bit_vec_budget(size_t mb);
+
+// The mmapped core file, whose holes are skipped without being read
+extern void set_core_file(int fd, const char* base, size_t size);
+
+// Size and modification time of the core file, false if it is not known
+extern bool get_core_file_stat(size_t* size, long long* mtime);
+
+/*
+ * Pages of a core file's segment which are file holes or all zeros are
+ * not populated. The populated pages are known after the bit vector of
+ * the segment is set, all pages are considered populated otherwise.
+ * Offsets are relative to the segment start and return m_fsize if
+ * there is no such page.
+ */
+extern size_t next_populated_offset(const struct ca_segment*, size_t offset);
+
+extern size_t next_unpopulated_offset(const struct ca_segment*, size_t offset);
+
 extern bool read_memory_wrapper (struct ca_segment*, address_t, void*, size_t);
 
 template<typename T>
@@ -60,12 +97,59 @@ bool ca_read_variable(address_t addr, T* val_pointer, struct ca_segment* segment
 
 extern void* core_to_mmap_addr(address_t vaddr);
 
+/*
+ * A read-only view of target's memory [m_vaddr, m_vaddr + m_size)
+ * 	m_data points into the mmapped core file if possible, otherwise to
+ * 	the view's own copy of the readable part of the requested range
+ */
+struct ca_memory_view
+{
+	address_t   m_vaddr;
+	const char* m_data;
+	size_t      m_size;
+	char*       m_buffer;	// copy of target's memory, owned by the view
+	size_t      m_capacity;
+
+	ca_memory_view() : m_vaddr(0), m_data(NULL), m_size(0), m_buffer(NULL), m_capacity(0) {}
+	~ca_memory_view() { free(m_buffer); }
+	ca_memory_view(const ca_memory_view&) = delete;
+	ca_memory_view& operator=(const ca_memory_view&) = delete;
+
+	// the pointer-size word at offset
+	address_t ptr_at(size_t offset, size_t ptr_sz) const
+	{
+		if (ptr_sz == 8)
+		{
+			unsigned long long val;
+			memcpy(&val, m_data + offset, sizeof(val));
+			return (address_t)val;
+		}
+		else
+		{
+			unsigned int val;
+			memcpy(&val, m_data + offset, sizeof(val));
+			return val;
+		}
+	}
+};
+
+// A copied view is no longer than this, callers step through a range by m_size
+#define MEMORY_VIEW_WINDOW (1ul << 20)
+
+extern bool get_memory_view(address_t addr, size_t sz, struct ca_memory_view* view);
+
 extern void set_value (address_t addr, address_t value);
 
 extern void unset_value (address_t addr);
 
 extern void print_set_values (void);
 
+extern bool save_set_values (const char* fname);
+
+extern bool load_set_values (const char* fname);
+
+extern bool has_set_values (void);
+
 extern struct ca_segment* g_segments;
 extern unsigned int g_segment_count;
 
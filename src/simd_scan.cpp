@@ -0,0 +1,831 @@
+/*
+ * simd_scan.cpp
+ *		Vectorized classification of target's memory words as
+ *		candidate pointers, raw scan of words for values, and
+ *		detection of strings
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include <algorithm>
+#include <vector>
+
+#include "simd_scan.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CA_X86_SIMD
+#include <immintrin.h>
+#endif
+
+/***************************************************************************
+* The range table
+*	the vector kernel tests every word against every range in the table,
+*	therefore the table is kept small
+***************************************************************************/
+#define MAX_SIMD_RANGES 16
+
+struct ptr_range
+{
+	address_t start;
+	address_t end;		// exclusive
+};
+
+static struct ptr_range g_simd_ranges[MAX_SIMD_RANGES];
+static unsigned int g_simd_range_count = 0;
+static bool g_simd_ranges_exact = false;	// the table covers all segments
+static address_t g_addr_lo = 0;			// bounds of the whole address space
+static address_t g_addr_hi = 0;
+static bool g_simd_ranges_ready = false;
+
+enum simd_level
+{
+	SIMD_NONE,
+	SIMD_SSE2,
+	SIMD_AVX2,
+	SIMD_AVX512
+};
+static enum simd_level g_simd_level = SIMD_NONE;
+
+// The best instruction set of the CPU, probed once
+static enum simd_level cpu_simd_level(void)
+{
+#ifdef CA_X86_SIMD
+	static const enum simd_level level = []() {
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx512f"))
+			return SIMD_AVX512;
+		else if (__builtin_cpu_supports("avx2"))
+			return SIMD_AVX2;
+		else if (__builtin_cpu_supports("sse2"))
+			return SIMD_SSE2;
+		return SIMD_NONE;
+	}();
+	return level;
+#else
+	return SIMD_NONE;
+#endif
+}
+
+static bool larger_range(const struct ptr_range& a, const struct ptr_range& b)
+{
+	return a.end - a.start > b.end - b.start;
+}
+
+void build_ptr_range_table(void)
+{
+	std::vector<struct ptr_range> ranges;
+	unsigned int i;
+
+	g_simd_range_count = 0;
+	g_simd_ranges_exact = false;
+	g_addr_lo = g_addr_hi = 0;
+	// coalesce adjacent segments
+	for (i = 0; i < g_segment_count; i++)
+	{
+		struct ca_segment* segment = &g_segments[i];
+		struct ptr_range range;
+		if (segment->m_vsize == 0)
+			continue;
+		range.start = segment->m_vaddr;
+		range.end = segment->m_vaddr + segment->m_vsize;
+		// zero is never a pointer
+		if (range.start == 0)
+			range.start = 1;
+		if (range.end < range.start)
+			range.end = ~(address_t)0;
+		if (!ranges.empty() && ranges.back().end == range.start)
+			ranges.back().end = range.end;
+		else if (range.end > range.start)
+			ranges.push_back(range);
+	}
+	if (!ranges.empty())
+	{
+		g_addr_lo = ranges.front().start;
+		g_addr_hi = ranges.back().end;
+		if (ranges.size() <= MAX_SIMD_RANGES)
+			g_simd_ranges_exact = true;
+		else
+		{
+			// keep the largest ones, heaps are most likely to be referenced
+			std::partial_sort(ranges.begin(), ranges.begin() + MAX_SIMD_RANGES,
+					ranges.end(), larger_range);
+			ranges.resize(MAX_SIMD_RANGES);
+		}
+		g_simd_range_count = ranges.size();
+		std::copy(ranges.begin(), ranges.end(), g_simd_ranges);
+	}
+
+	g_simd_level = cpu_simd_level();
+	g_simd_ranges_ready = true;
+}
+
+void invalidate_ptr_range_table(void)
+{
+	g_simd_ranges_ready = false;
+}
+
+bool ptr_range_table_ready(void)
+{
+	return g_simd_ranges_ready;
+}
+
+static inline address_t read_word(const char* p, size_t ptr_sz)
+{
+	// memcpy for the data in sparcv9 core file, which aligns on 4-byte only
+	if (ptr_sz == 8)
+	{
+		unsigned long long val;
+		memcpy(&val, p, sizeof(val));
+		return (address_t) val;
+	}
+	else
+	{
+		unsigned int val;
+		memcpy(&val, p, sizeof(val));
+		return val;
+	}
+}
+
+static inline bool is_addressable(address_t val, const struct ca_segment* own)
+{
+	if (val == 0)
+		return false;
+	// there is a good chance that a valid ptr points to its own segment where the ptr is
+	if (val >= own->m_vaddr && val < own->m_vaddr + own->m_vsize)
+		return true;
+	return get_segment(val, 1) != NULL;
+}
+
+static void
+classify_scalar(const char* data, size_t first, size_t nwords, size_t ptr_sz,
+		unsigned int* bitvec, const struct ca_segment* own)
+{
+	size_t i;
+	for (i = first; i < nwords; i++)
+	{
+		if (is_addressable(read_word(data + i * ptr_sz, ptr_sz), own))
+			bitvec[i >> 5] |= 1u << (i & 0x1F);
+	}
+}
+
+#ifdef CA_X86_SIMD
+/***************************************************************************
+* Vector kernels
+*	each block of 32 words produces one word of the bit vector.
+*	x86 has only signed compares, values and bounds are biased by the sign
+*	bit so that signed compares order them as unsigned.
+*	A word that misses the table but falls in [lo, hi) is left to
+*	get_segment() unless the table is exact.
+***************************************************************************/
+static unsigned int
+resolve_residual(const char* block, size_t ptr_sz, unsigned int residual)
+{
+	unsigned int hits = 0;
+	while (residual)
+	{
+		unsigned int i = __builtin_ctz(residual);
+		residual &= residual - 1;
+		if (get_segment(read_word(block + i * ptr_sz, ptr_sz), 1))
+			hits |= 1u << i;
+	}
+	return hits;
+}
+
+// the table plus the segment of the data itself
+static unsigned int
+get_kernel_ranges(struct ptr_range* ranges, const struct ca_segment* own)
+{
+	unsigned int n = g_simd_range_count;
+	std::copy(g_simd_ranges, g_simd_ranges + n, ranges);
+	if (!g_simd_ranges_exact && own->m_vsize > 0)
+	{
+		ranges[n].start = own->m_vaddr ? own->m_vaddr : 1;
+		ranges[n].end = own->m_vaddr + own->m_vsize;
+		n++;
+	}
+	return n;
+}
+
+__attribute__((target("avx2")))
+static void
+classify64_avx2(const char* data, size_t nblocks, unsigned int* bitvec, const struct ca_segment* own)
+{
+	struct ptr_range ranges[MAX_SIMD_RANGES + 1];
+	__m256i starts[MAX_SIMD_RANGES + 1];
+	__m256i ends[MAX_SIMD_RANGES + 1];
+	const __m256i bias = _mm256_set1_epi64x((long long)0x8000000000000000ull);
+	unsigned int n = get_kernel_ranges(ranges, own);
+	unsigned int k;
+	size_t b;
+
+	for (k = 0; k < n; k++)
+	{
+		starts[k] = _mm256_set1_epi64x((long long)(ranges[k].start ^ 0x8000000000000000ull));
+		ends[k] = _mm256_set1_epi64x((long long)(ranges[k].end ^ 0x8000000000000000ull));
+	}
+	const __m256i lo = _mm256_set1_epi64x((long long)(g_addr_lo ^ 0x8000000000000000ull));
+	const __m256i hi = _mm256_set1_epi64x((long long)(g_addr_hi ^ 0x8000000000000000ull));
+
+	for (b = 0; b < nblocks; b++)
+	{
+		const char* block = data + b * 32 * 8;
+		unsigned int hits = 0;
+		unsigned int cands = 0;
+		unsigned int j;
+		for (j = 0; j < 32; j += 4)
+		{
+			__m256i x = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(block + j * 8)), bias);
+			__m256i in = _mm256_setzero_si256();
+			for (k = 0; k < n; k++)
+				in = _mm256_or_si256(in, _mm256_andnot_si256(_mm256_cmpgt_epi64(starts[k], x),
+						_mm256_cmpgt_epi64(ends[k], x)));
+			hits |= (unsigned int)_mm256_movemask_pd(_mm256_castsi256_pd(in)) << j;
+			if (!g_simd_ranges_exact)
+			{
+				__m256i cand = _mm256_andnot_si256(_mm256_cmpgt_epi64(lo, x), _mm256_cmpgt_epi64(hi, x));
+				cands |= (unsigned int)_mm256_movemask_pd(_mm256_castsi256_pd(cand)) << j;
+			}
+		}
+		if (cands & ~hits)
+			hits |= resolve_residual(block, 8, cands & ~hits);
+		bitvec[b] = hits;
+	}
+}
+
+__attribute__((target("avx2")))
+static void
+classify32_avx2(const char* data, size_t nblocks, unsigned int* bitvec, const struct ca_segment* own)
+{
+	struct ptr_range ranges[MAX_SIMD_RANGES + 1];
+	__m256i starts[MAX_SIMD_RANGES + 1];
+	__m256i ends[MAX_SIMD_RANGES + 1];
+	const __m256i bias = _mm256_set1_epi32((int)0x80000000u);
+	unsigned int n = get_kernel_ranges(ranges, own);
+	unsigned int k;
+	size_t b;
+
+	// a 32-bit target's address space ends at 4GB at most
+	for (k = 0; k < n; k++)
+	{
+		address_t end = ranges[k].end > 0xffffffffu ? 0xffffffffu : ranges[k].end;
+		starts[k] = _mm256_set1_epi32((int)((unsigned int)ranges[k].start ^ 0x80000000u));
+		ends[k] = _mm256_set1_epi32((int)((unsigned int)end ^ 0x80000000u));
+	}
+	address_t addr_hi = g_addr_hi > 0xffffffffu ? 0xffffffffu : g_addr_hi;
+	const __m256i lo = _mm256_set1_epi32((int)((unsigned int)g_addr_lo ^ 0x80000000u));
+	const __m256i hi = _mm256_set1_epi32((int)((unsigned int)addr_hi ^ 0x80000000u));
+
+	for (b = 0; b < nblocks; b++)
+	{
+		const char* block = data + b * 32 * 4;
+		unsigned int hits = 0;
+		unsigned int cands = 0;
+		unsigned int j;
+		for (j = 0; j < 32; j += 8)
+		{
+			__m256i x = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(block + j * 4)), bias);
+			__m256i in = _mm256_setzero_si256();
+			for (k = 0; k < n; k++)
+				in = _mm256_or_si256(in, _mm256_andnot_si256(_mm256_cmpgt_epi32(starts[k], x),
+						_mm256_cmpgt_epi32(ends[k], x)));
+			hits |= (unsigned int)_mm256_movemask_ps(_mm256_castsi256_ps(in)) << j;
+			if (!g_simd_ranges_exact)
+			{
+				__m256i cand = _mm256_andnot_si256(_mm256_cmpgt_epi32(lo, x), _mm256_cmpgt_epi32(hi, x));
+				cands |= (unsigned int)_mm256_movemask_ps(_mm256_castsi256_ps(cand)) << j;
+			}
+		}
+		if (cands & ~hits)
+			hits |= resolve_residual(block, 4, cands & ~hits);
+		bitvec[b] = hits;
+	}
+}
+
+// SSE2 has no 64-bit compare, build it from 32-bit ones.
+// Both halves are biased so that dword compares are unsigned
+__attribute__((target("sse2")))
+static inline __m128i
+cmpgt64_sse2(__m128i a, __m128i b)
+{
+	__m128i gt = _mm_cmpgt_epi32(a, b);
+	__m128i eq = _mm_cmpeq_epi32(a, b);
+	__m128i hi_gt = _mm_shuffle_epi32(gt, _MM_SHUFFLE(3, 3, 1, 1));
+	__m128i hi_eq = _mm_shuffle_epi32(eq, _MM_SHUFFLE(3, 3, 1, 1));
+	__m128i lo_gt = _mm_shuffle_epi32(gt, _MM_SHUFFLE(2, 2, 0, 0));
+	return _mm_or_si128(hi_gt, _mm_and_si128(hi_eq, lo_gt));
+}
+
+__attribute__((target("sse2")))
+static void
+classify64_sse2(const char* data, size_t nblocks, unsigned int* bitvec, const struct ca_segment* own)
+{
+	struct ptr_range ranges[MAX_SIMD_RANGES + 1];
+	__m128i starts[MAX_SIMD_RANGES + 1];
+	__m128i ends[MAX_SIMD_RANGES + 1];
+	const unsigned long long bias64 = 0x8000000080000000ull;
+	const __m128i bias = _mm_set1_epi32((int)0x80000000u);
+	unsigned int n = get_kernel_ranges(ranges, own);
+	unsigned int k;
+	size_t b;
+
+	for (k = 0; k < n; k++)
+	{
+		starts[k] = _mm_set1_epi64x((long long)(ranges[k].start ^ bias64));
+		ends[k] = _mm_set1_epi64x((long long)(ranges[k].end ^ bias64));
+	}
+	const __m128i lo = _mm_set1_epi64x((long long)(g_addr_lo ^ bias64));
+	const __m128i hi = _mm_set1_epi64x((long long)(g_addr_hi ^ bias64));
+
+	for (b = 0; b < nblocks; b++)
+	{
+		const char* block = data + b * 32 * 8;
+		unsigned int hits = 0;
+		unsigned int cands = 0;
+		unsigned int j;
+		for (j = 0; j < 32; j += 2)
+		{
+			__m128i x = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(block + j * 8)), bias);
+			__m128i in = _mm_setzero_si128();
+			for (k = 0; k < n; k++)
+				in = _mm_or_si128(in, _mm_andnot_si128(cmpgt64_sse2(starts[k], x),
+						cmpgt64_sse2(ends[k], x)));
+			hits |= (unsigned int)_mm_movemask_pd(_mm_castsi128_pd(in)) << j;
+			if (!g_simd_ranges_exact)
+			{
+				__m128i cand = _mm_andnot_si128(cmpgt64_sse2(lo, x), cmpgt64_sse2(hi, x));
+				cands |= (unsigned int)_mm_movemask_pd(_mm_castsi128_pd(cand)) << j;
+			}
+		}
+		if (cands & ~hits)
+			hits |= resolve_residual(block, 8, cands & ~hits);
+		bitvec[b] = hits;
+	}
+}
+
+__attribute__((target("sse2")))
+static void
+classify32_sse2(const char* data, size_t nblocks, unsigned int* bitvec, const struct ca_segment* own)
+{
+	struct ptr_range ranges[MAX_SIMD_RANGES + 1];
+	__m128i starts[MAX_SIMD_RANGES + 1];
+	__m128i ends[MAX_SIMD_RANGES + 1];
+	const __m128i bias = _mm_set1_epi32((int)0x80000000u);
+	unsigned int n = get_kernel_ranges(ranges, own);
+	unsigned int k;
+	size_t b;
+
+	for (k = 0; k < n; k++)
+	{
+		address_t end = ranges[k].end > 0xffffffffu ? 0xffffffffu : ranges[k].end;
+		starts[k] = _mm_set1_epi32((int)((unsigned int)ranges[k].start ^ 0x80000000u));
+		ends[k] = _mm_set1_epi32((int)((unsigned int)end ^ 0x80000000u));
+	}
+	address_t addr_hi = g_addr_hi > 0xffffffffu ? 0xffffffffu : g_addr_hi;
+	const __m128i lo = _mm_set1_epi32((int)((unsigned int)g_addr_lo ^ 0x80000000u));
+	const __m128i hi = _mm_set1_epi32((int)((unsigned int)addr_hi ^ 0x80000000u));
+
+	for (b = 0; b < nblocks; b++)
+	{
+		const char* block = data + b * 32 * 4;
+		unsigned int hits = 0;
+		unsigned int cands = 0;
+		unsigned int j;
+		for (j = 0; j < 32; j += 4)
+		{
+			__m128i x = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(block + j * 4)), bias);
+			__m128i in = _mm_setzero_si128();
+			for (k = 0; k < n; k++)
+				in = _mm_or_si128(in, _mm_andnot_si128(_mm_cmpgt_epi32(starts[k], x),
+						_mm_cmpgt_epi32(ends[k], x)));
+			hits |= (unsigned int)_mm_movemask_ps(_mm_castsi128_ps(in)) << j;
+			if (!g_simd_ranges_exact)
+			{
+				__m128i cand = _mm_andnot_si128(_mm_cmpgt_epi32(lo, x), _mm_cmpgt_epi32(hi, x));
+				cands |= (unsigned int)_mm_movemask_ps(_mm_castsi128_ps(cand)) << j;
+			}
+		}
+		if (cands & ~hits)
+			hits |= resolve_residual(block, 4, cands & ~hits);
+		bitvec[b] = hits;
+	}
+}
+#endif
+
+void classify_ptr_words(const char* data, size_t nwords, size_t ptr_sz,
+			unsigned int* bitvec, const struct ca_segment* own)
+{
+	size_t nblocks = 0;
+
+#ifdef CA_X86_SIMD
+	if (g_simd_ranges_ready && g_simd_range_count > 0 && g_simd_level != SIMD_NONE)
+	{
+		nblocks = nwords >> 5;
+		if (ptr_sz == 8 && g_simd_level >= SIMD_AVX2)
+			classify64_avx2(data, nblocks, bitvec, own);
+		else if (ptr_sz == 8)
+			classify64_sse2(data, nblocks, bitvec, own);
+		else if (g_simd_level >= SIMD_AVX2)
+			classify32_avx2(data, nblocks, bitvec, own);
+		else
+			classify32_sse2(data, nblocks, bitvec, own);
+	}
+#endif
+	// the remainder that doesn't fill a word of the bit vector
+	classify_scalar(data, nblocks << 5, nwords, ptr_sz, bitvec, own);
+}
+
+/***************************************************************************
+* Raw value scan
+*	words are compared with a few ranges of arbitrary values. Bounds are
+*	inclusive so that a range may end at the top of the word. A vector of
+*	words is compared at a time, and only a vector with a hit is looked
+*	into by its mask.
+***************************************************************************/
+struct value_bound
+{
+	address_t first;
+	address_t last;		// inclusive
+};
+
+// Bounds of ranges that a word of ptr_sz bytes may fall in
+static unsigned int
+get_value_bounds(const address_t* lows, const address_t* highs, unsigned int nranges,
+		size_t ptr_sz, struct value_bound* bounds)
+{
+	address_t word_max = ptr_sz == 8 ? ~(address_t)0 : (address_t)0xffffffffu;
+	unsigned int n = 0, k;
+
+	for (k = 0; k < nranges && k < MAX_SCAN_RANGES; k++)
+	{
+		if (lows[k] >= highs[k] || lows[k] > word_max)
+			continue;
+		bounds[n].first = lows[k];
+		bounds[n].last = highs[k] - 1 < word_max ? highs[k] - 1 : word_max;
+		n++;
+	}
+	return n;
+}
+
+static size_t
+scan_ranges_scalar(const char* data, size_t first, size_t nwords, size_t ptr_sz,
+		const struct value_bound* bounds, unsigned int n)
+{
+	size_t i;
+	unsigned int k;
+	for (i = first; i < nwords; i++)
+	{
+		address_t val = read_word(data + i * ptr_sz, ptr_sz);
+		for (k = 0; k < n; k++)
+		{
+			if (val >= bounds[k].first && val <= bounds[k].last)
+				return i;
+		}
+	}
+	return nwords;
+}
+
+#ifdef CA_X86_SIMD
+/*
+ * Kernels return the first word that hits, or the first word left
+ * untested which is the last partial vector
+ */
+__attribute__((target("avx512f")))
+static size_t
+scan64_avx512(const char* data, size_t nwords, const struct value_bound* bounds, unsigned int n)
+{
+	__m512i firsts[MAX_SCAN_RANGES];
+	__m512i lasts[MAX_SCAN_RANGES];
+	unsigned int k;
+	size_t i;
+
+	for (k = 0; k < n; k++)
+	{
+		firsts[k] = _mm512_set1_epi64((long long)bounds[k].first);
+		lasts[k] = _mm512_set1_epi64((long long)bounds[k].last);
+	}
+	for (i = 0; i + 8 <= nwords; i += 8)
+	{
+		__m512i x = _mm512_loadu_si512((const void*)(data + i * 8));
+		__mmask8 hits = 0;
+		for (k = 0; k < n; k++)
+			hits |= _mm512_mask_cmple_epu64_mask(_mm512_cmpge_epu64_mask(x, firsts[k]), x, lasts[k]);
+		if (hits)
+			return i + __builtin_ctz(hits);
+	}
+	return i;
+}
+
+__attribute__((target("avx512f")))
+static size_t
+scan32_avx512(const char* data, size_t nwords, const struct value_bound* bounds, unsigned int n)
+{
+	__m512i firsts[MAX_SCAN_RANGES];
+	__m512i lasts[MAX_SCAN_RANGES];
+	unsigned int k;
+	size_t i;
+
+	for (k = 0; k < n; k++)
+	{
+		firsts[k] = _mm512_set1_epi32((int)(unsigned int)bounds[k].first);
+		lasts[k] = _mm512_set1_epi32((int)(unsigned int)bounds[k].last);
+	}
+	for (i = 0; i + 16 <= nwords; i += 16)
+	{
+		__m512i x = _mm512_loadu_si512((const void*)(data + i * 4));
+		__mmask16 hits = 0;
+		for (k = 0; k < n; k++)
+			hits |= _mm512_mask_cmple_epu32_mask(_mm512_cmpge_epu32_mask(x, firsts[k]), x, lasts[k]);
+		if (hits)
+			return i + __builtin_ctz(hits);
+	}
+	return i;
+}
+
+// a word misses all ranges if it is below the first or above the last of each
+__attribute__((target("avx2")))
+static size_t
+scan64_avx2(const char* data, size_t nwords, const struct value_bound* bounds, unsigned int n)
+{
+	__m256i firsts[MAX_SCAN_RANGES];
+	__m256i lasts[MAX_SCAN_RANGES];
+	const __m256i bias = _mm256_set1_epi64x((long long)0x8000000000000000ull);
+	unsigned int k;
+	size_t i;
+
+	for (k = 0; k < n; k++)
+	{
+		firsts[k] = _mm256_set1_epi64x((long long)(bounds[k].first ^ 0x8000000000000000ull));
+		lasts[k] = _mm256_set1_epi64x((long long)(bounds[k].last ^ 0x8000000000000000ull));
+	}
+	for (i = 0; i + 4 <= nwords; i += 4)
+	{
+		__m256i x = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(data + i * 8)), bias);
+		__m256i miss = _mm256_set1_epi64x(-1);
+		unsigned int hits;
+		for (k = 0; k < n; k++)
+			miss = _mm256_and_si256(miss, _mm256_or_si256(_mm256_cmpgt_epi64(firsts[k], x),
+					_mm256_cmpgt_epi64(x, lasts[k])));
+		hits = ~(unsigned int)_mm256_movemask_pd(_mm256_castsi256_pd(miss)) & 0xf;
+		if (hits)
+			return i + __builtin_ctz(hits);
+	}
+	return i;
+}
+
+__attribute__((target("avx2")))
+static size_t
+scan32_avx2(const char* data, size_t nwords, const struct value_bound* bounds, unsigned int n)
+{
+	__m256i firsts[MAX_SCAN_RANGES];
+	__m256i lasts[MAX_SCAN_RANGES];
+	const __m256i bias = _mm256_set1_epi32((int)0x80000000u);
+	unsigned int k;
+	size_t i;
+
+	for (k = 0; k < n; k++)
+	{
+		firsts[k] = _mm256_set1_epi32((int)((unsigned int)bounds[k].first ^ 0x80000000u));
+		lasts[k] = _mm256_set1_epi32((int)((unsigned int)bounds[k].last ^ 0x80000000u));
+	}
+	for (i = 0; i + 8 <= nwords; i += 8)
+	{
+		__m256i x = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(data + i * 4)), bias);
+		__m256i miss = _mm256_set1_epi32(-1);
+		unsigned int hits;
+		for (k = 0; k < n; k++)
+			miss = _mm256_and_si256(miss, _mm256_or_si256(_mm256_cmpgt_epi32(firsts[k], x),
+					_mm256_cmpgt_epi32(x, lasts[k])));
+		hits = ~(unsigned int)_mm256_movemask_ps(_mm256_castsi256_ps(miss)) & 0xff;
+		if (hits)
+			return i + __builtin_ctz(hits);
+	}
+	return i;
+}
+
+__attribute__((target("sse2")))
+static size_t
+scan64_sse2(const char* data, size_t nwords, const struct value_bound* bounds, unsigned int n)
+{
+	__m128i firsts[MAX_SCAN_RANGES];
+	__m128i lasts[MAX_SCAN_RANGES];
+	const unsigned long long bias64 = 0x8000000080000000ull;
+	const __m128i bias = _mm_set1_epi32((int)0x80000000u);
+	unsigned int k;
+	size_t i;
+
+	for (k = 0; k < n; k++)
+	{
+		firsts[k] = _mm_set1_epi64x((long long)(bounds[k].first ^ bias64));
+		lasts[k] = _mm_set1_epi64x((long long)(bounds[k].last ^ bias64));
+	}
+	for (i = 0; i + 2 <= nwords; i += 2)
+	{
+		__m128i x = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(data + i * 8)), bias);
+		__m128i miss = _mm_set1_epi32(-1);
+		unsigned int hits;
+		for (k = 0; k < n; k++)
+			miss = _mm_and_si128(miss, _mm_or_si128(cmpgt64_sse2(firsts[k], x),
+					cmpgt64_sse2(x, lasts[k])));
+		hits = ~(unsigned int)_mm_movemask_pd(_mm_castsi128_pd(miss)) & 0x3;
+		if (hits)
+			return i + __builtin_ctz(hits);
+	}
+	return i;
+}
+
+__attribute__((target("sse2")))
+static size_t
+scan32_sse2(const char* data, size_t nwords, const struct value_bound* bounds, unsigned int n)
+{
+	__m128i firsts[MAX_SCAN_RANGES];
+	__m128i lasts[MAX_SCAN_RANGES];
+	const __m128i bias = _mm_set1_epi32((int)0x80000000u);
+	unsigned int k;
+	size_t i;
+
+	for (k = 0; k < n; k++)
+	{
+		firsts[k] = _mm_set1_epi32((int)((unsigned int)bounds[k].first ^ 0x80000000u));
+		lasts[k] = _mm_set1_epi32((int)((unsigned int)bounds[k].last ^ 0x80000000u));
+	}
+	for (i = 0; i + 4 <= nwords; i += 4)
+	{
+		__m128i x = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(data + i * 4)), bias);
+		__m128i miss = _mm_set1_epi32(-1);
+		unsigned int hits;
+		for (k = 0; k < n; k++)
+			miss = _mm_and_si128(miss, _mm_or_si128(_mm_cmpgt_epi32(firsts[k], x),
+					_mm_cmpgt_epi32(x, lasts[k])));
+		hits = ~(unsigned int)_mm_movemask_ps(_mm_castsi128_ps(miss)) & 0xf;
+		if (hits)
+			return i + __builtin_ctz(hits);
+	}
+	return i;
+}
+#endif
+
+size_t find_words_in_ranges(const char* data, size_t nwords, size_t ptr_sz,
+			const address_t* lows, const address_t* highs, unsigned int nranges)
+{
+	struct value_bound bounds[MAX_SCAN_RANGES];
+	unsigned int n = get_value_bounds(lows, highs, nranges, ptr_sz, bounds);
+	size_t i = 0;
+
+	if (n == 0)
+		return nwords;
+#ifdef CA_X86_SIMD
+	switch (cpu_simd_level())
+	{
+	case SIMD_AVX512:
+		i = ptr_sz == 8 ? scan64_avx512(data, nwords, bounds, n) : scan32_avx512(data, nwords, bounds, n);
+		break;
+	case SIMD_AVX2:
+		i = ptr_sz == 8 ? scan64_avx2(data, nwords, bounds, n) : scan32_avx2(data, nwords, bounds, n);
+		break;
+	case SIMD_SSE2:
+		i = ptr_sz == 8 ? scan64_sse2(data, nwords, bounds, n) : scan32_sse2(data, nwords, bounds, n);
+		break;
+	default:
+		break;
+	}
+#endif
+	// the word at i, if it is a hit, is confirmed by the scalar loop
+	return scan_ranges_scalar(data, i, nwords, ptr_sz, bounds, n);
+}
+
+/***************************************************************************
+* String detection
+*	bytes are tested a vector at a time for printable characters, i.e.
+*	[0x20, 0x7e] as isprint() of the C locale, and for zeros. Runs of
+*	them are then found in the bit vectors.
+***************************************************************************/
+static void
+classify_bytes_scalar(const unsigned char* data, size_t first, size_t nbytes,
+		unsigned int* printable, unsigned int* zeros)
+{
+	size_t i;
+	for (i = first; i < nbytes; i++)
+	{
+		unsigned int bit = 1u << (i & 0x1F);
+		if ((i & 0x1F) == 0)
+			printable[i >> 5] = zeros[i >> 5] = 0;
+		if (data[i] >= 0x20 && data[i] < 0x7f)
+			printable[i >> 5] |= bit;
+		else if (data[i] == 0)
+			zeros[i >> 5] |= bit;
+	}
+}
+
+#ifdef CA_X86_SIMD
+// signed compares leave out bytes of 0x80 and above as negative
+__attribute__((target("avx2")))
+static void
+classify_bytes_avx2(const char* data, size_t nblocks, unsigned int* printable, unsigned int* zeros)
+{
+	const __m256i below = _mm256_set1_epi8(0x1f);
+	const __m256i above = _mm256_set1_epi8(0x7f);
+	const __m256i zero = _mm256_setzero_si256();
+	size_t b;
+
+	for (b = 0; b < nblocks; b++)
+	{
+		__m256i x = _mm256_loadu_si256((const __m256i*)(data + b * 32));
+		__m256i p = _mm256_and_si256(_mm256_cmpgt_epi8(x, below), _mm256_cmpgt_epi8(above, x));
+		printable[b] = (unsigned int)_mm256_movemask_epi8(p);
+		zeros[b] = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, zero));
+	}
+}
+
+__attribute__((target("sse2")))
+static void
+classify_bytes_sse2(const char* data, size_t nblocks, unsigned int* printable, unsigned int* zeros)
+{
+	const __m128i below = _mm_set1_epi8(0x1f);
+	const __m128i above = _mm_set1_epi8(0x7f);
+	const __m128i zero = _mm_setzero_si128();
+	size_t b;
+
+	for (b = 0; b < nblocks; b++)
+	{
+		__m128i x0 = _mm_loadu_si128((const __m128i*)(data + b * 32));
+		__m128i x1 = _mm_loadu_si128((const __m128i*)(data + b * 32 + 16));
+		__m128i p0 = _mm_and_si128(_mm_cmpgt_epi8(x0, below), _mm_cmpgt_epi8(above, x0));
+		__m128i p1 = _mm_and_si128(_mm_cmpgt_epi8(x1, below), _mm_cmpgt_epi8(above, x1));
+		printable[b] = (unsigned int)_mm_movemask_epi8(p0) | (unsigned int)_mm_movemask_epi8(p1) << 16;
+		zeros[b] = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(x0, zero))
+				| (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(x1, zero)) << 16;
+	}
+}
+#endif
+
+// Set the bits of "out" that are in a run of at least min_len bits of "bits"
+static void
+mark_long_runs(const unsigned int* bits, size_t nbits, size_t min_len, unsigned int* out)
+{
+	size_t i, k, run_start = 0;
+	bool in_run = false;
+
+	memset(out, 0, ((nbits + 31) >> 5) * sizeof(unsigned int));
+	for (i = 0; i <= nbits; i++)
+	{
+		bool set;
+		// skip a word without any bit if no run is open
+		if (!in_run && i < nbits && (i & 0x1F) == 0 && bits[i >> 5] == 0)
+		{
+			i += 31;
+			continue;
+		}
+		set = i < nbits && (bits[i >> 5] >> (i & 0x1F) & 1);
+		if (set && !in_run)
+		{
+			run_start = i;
+			in_run = true;
+		}
+		else if (!set && in_run)
+		{
+			in_run = false;
+			if (i - run_start >= min_len)
+			{
+				for (k = run_start; k < i; k++)
+					out[k >> 5] |= 1u << (k & 0x1F);
+			}
+		}
+	}
+}
+
+void find_string_bytes(const char* data, size_t nbytes, size_t min_chars,
+			unsigned int* ascii, unsigned int* utf16)
+{
+	size_t nvec = (nbytes + 31) >> 5;
+	std::vector<unsigned int> printable(nvec), zeros(nvec);
+	size_t nblocks = 0;
+	size_t i;
+
+#ifdef CA_X86_SIMD
+	switch (cpu_simd_level())
+	{
+	case SIMD_AVX512:
+	case SIMD_AVX2:
+		nblocks = nbytes >> 5;
+		classify_bytes_avx2(data, nblocks, printable.data(), zeros.data());
+		break;
+	case SIMD_SSE2:
+		nblocks = nbytes >> 5;
+		classify_bytes_sse2(data, nblocks, printable.data(), zeros.data());
+		break;
+	default:
+		break;
+	}
+#endif
+	classify_bytes_scalar((const unsigned char*)data, nblocks << 5, nbytes,
+			printable.data(), zeros.data());
+	mark_long_runs(printable.data(), nbytes, min_chars, ascii);
+
+	// a UTF-16 character is a printable byte followed by a zero, both
+	// bytes of it are set so that a string is a run of bits
+	for (i = 0; i < nvec; i++)
+	{
+		unsigned int units = printable[i] & (zeros[i] >> 1) & 0x55555555u;
+		printable[i] = units | (units << 1);
+	}
+	mark_long_runs(printable.data(), nbytes, min_chars * 2, utf16);
+}
@@ -0,0 +1,59 @@
+/*
+ * simd_scan.h
+ *		Vectorized classification of target's memory words as
+ *		candidate pointers, raw scan of words for values, and
+ *		detection of strings
+ *
+ *  Created on: Oct 17, 2026
+ */
+#ifndef SIMD_SCAN_H_
+#define SIMD_SCAN_H_
+
+#include "segment.h"
+
+/*
+ * The range table is a compact copy of the target's address space
+ *   adjacent segments are coalesced, and only the largest ranges are
+ *   tested by the vector kernel. Words that miss the table but may still
+ *   hit a small range are resolved by get_segment()
+ * It is built on the main thread before any worker uses it.
+ */
+extern void build_ptr_range_table(void);
+
+extern void invalidate_ptr_range_table(void);
+
+extern bool ptr_range_table_ready(void);
+
+/*
+ * Classify "nwords" words of "ptr_sz" bytes at "data", and set the bits of
+ *   those pointing into the target's address space. bit 0 of bitvec[0]
+ *   corresponds to the first word.
+ * "own" is the segment that the data belongs to, it is checked first
+ *   since a pointer tends to point to its own segment
+ */
+extern void classify_ptr_words(const char* data, size_t nwords, size_t ptr_sz,
+				unsigned int* bitvec, const struct ca_segment* own);
+
+// Ranges that a raw value scan compares in one pass
+#define MAX_SCAN_RANGES 8
+
+/*
+ * Return the index of the first of "nwords" words of "ptr_sz" bytes at
+ *   "data" that is in one of "nranges" ranges [lows[i], highs[i]), or
+ *   "nwords" if none. Only the first MAX_SCAN_RANGES ranges are used.
+ * It uses the best instruction set of the CPU and may be called by workers
+ */
+extern size_t find_words_in_ranges(const char* data, size_t nwords, size_t ptr_sz,
+				const address_t* lows, const address_t* highs, unsigned int nranges);
+
+/*
+ * Set the bits of bytes of "nbytes" bytes at "data" that are in a run of
+ *   at least "min_chars" printable characters in "ascii", and of UTF-16
+ *   characters in "utf16". bit 0 of ascii[0] and utf16[0] corresponds to
+ *   the first byte, which is assumed to be aligned on 2 bytes.
+ * Both vectors have (nbytes + 31) / 32 words. It may be called by workers
+ */
+extern void find_string_bytes(const char* data, size_t nbytes, size_t min_chars,
+				unsigned int* ascii, unsigned int* utf16);
+
+#endif /* SIMD_SCAN_H_ */
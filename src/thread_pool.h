@@ -0,0 +1,186 @@
+/*
+ * thread_pool.h
+ *		A process-wide pool of worker threads for scanning the target's
+ *		memory in parallel
+ *
+ *  Created on: Oct 17, 2026
+ */
+#ifndef THREAD_POOL_H_
+#define THREAD_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#ifndef WIN32
+#include <signal.h>
+#endif
+
+/*
+ * Workers must never call into the debugger, print, or touch the heap
+ * manager; they only read the mmapped target memory and write to buffers
+ * owned by the submitter.
+ */
+class ca_thread_pool
+{
+public:
+	static ca_thread_pool& instance()
+	{
+		static ca_thread_pool pool;
+		return pool;
+	}
+
+	// number of worker threads, the submitting thread is not counted
+	unsigned int size() const { return m_workers.size(); }
+
+	/*
+	 * Queue a background task. It runs after all tasks of parallel_for,
+	 * a long one should do a slice of its work and submit itself again
+	 * so that queries are not held up behind it.
+	 */
+	void submit(std::function<void()> task)
+	{
+		push_task(std::move(task), false);
+	}
+
+	/*
+	 * Call fn(0) ... fn(count-1) on the workers and the calling thread.
+	 * Return after all calls are done. Indexes are handed out in increasing
+	 * order. Helpers that are still queued when the caller runs out of work
+	 * become no-op, so nested use from a worker can't deadlock.
+	 */
+	void parallel_for(size_t count, const std::function<void(size_t)>& fn)
+	{
+		struct group_state
+		{
+			std::atomic<size_t> next;
+			std::mutex lock;
+			std::condition_variable cond;
+			unsigned int running;
+			bool closed;
+		};
+		std::shared_ptr<group_state> state = std::make_shared<group_state>();
+		state->next = 0;
+		state->running = 0;
+		state->closed = false;
+
+		size_t nhelpers = count > 1 ? count - 1 : 0;
+		if (nhelpers > m_workers.size())
+			nhelpers = m_workers.size();
+		for (size_t i = 0; i < nhelpers; i++)
+		{
+			push_task([state, count, &fn]() {
+				{
+					std::lock_guard<std::mutex> guard(state->lock);
+					if (state->closed)
+						return;
+					state->running++;
+				}
+				for (size_t k = state->next++; k < count; k = state->next++)
+					fn(k);
+				std::lock_guard<std::mutex> guard(state->lock);
+				if (--state->running == 0)
+					state->cond.notify_all();
+			}, true);
+		}
+		for (size_t k = state->next++; k < count; k = state->next++)
+			fn(k);
+
+		std::unique_lock<std::mutex> guard(state->lock);
+		state->closed = true;
+		while (state->running)
+			state->cond.wait(guard);
+	}
+
+private:
+	ca_thread_pool() : m_stop(false)
+	{
+		unsigned int nthreads = std::thread::hardware_concurrency();
+		if (nthreads > MAX_WORKERS)
+			nthreads = MAX_WORKERS;
+		// the submitting thread always takes a share of the work
+		if (nthreads > 0)
+			nthreads--;
+#ifndef WIN32
+		// Debugger's signal handlers are meant for the main thread only,
+		// workers inherit a mask that blocks all of them
+		sigset_t all_signals, old_signals;
+		sigfillset(&all_signals);
+		pthread_sigmask(SIG_BLOCK, &all_signals, &old_signals);
+#endif
+		for (unsigned int i = 0; i < nthreads; i++)
+			m_workers.push_back(std::thread(&ca_thread_pool::worker_main, this));
+#ifndef WIN32
+		pthread_sigmask(SIG_SETMASK, &old_signals, NULL);
+#endif
+	}
+
+	// Queued tasks are dropped, background tasks that submit themselves
+	// again would otherwise keep the process from exiting
+	~ca_thread_pool()
+	{
+		{
+			std::lock_guard<std::mutex> guard(m_lock);
+			m_stop = true;
+			m_tasks.clear();
+		}
+		m_cond.notify_all();
+		for (auto& worker : m_workers)
+			worker.join();
+	}
+
+	// helpers of parallel_for are queued ahead of background tasks
+	void push_task(std::function<void()> task, bool urgent)
+	{
+		if (m_workers.empty())
+		{
+			task();
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> guard(m_lock);
+			// a helper of parallel_for is not needed, its caller does the work
+			if (m_stop)
+				return;
+			if (urgent)
+				m_tasks.push_front(std::move(task));
+			else
+				m_tasks.push_back(std::move(task));
+		}
+		m_cond.notify_one();
+	}
+
+	void worker_main()
+	{
+		while (1)
+		{
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> guard(m_lock);
+				while (!m_stop && m_tasks.empty())
+					m_cond.wait(guard);
+				if (m_stop)
+					return;
+				task = std::move(m_tasks.front());
+				m_tasks.pop_front();
+			}
+			task();
+		}
+	}
+
+	static const unsigned int MAX_WORKERS = 64;
+
+	std::vector<std::thread> m_workers;
+	std::deque<std::function<void()>> m_tasks;
+	std::mutex m_lock;
+	std::condition_variable m_cond;
+	bool m_stop;
+};
+
+#define CA_THREAD_POOL (ca_thread_pool::instance())
+
+#endif /* THREAD_POOL_H_ */
@@ -9,6 +9,7 @@
 
 #include "x_type.h"
 #include <list>
+#include <vector>
 
 #define CA_VERSION_MAJOR 2
 #define CA_VERSION_MINOR 22
@@ -57,6 +58,9 @@ extern bool known_stack_sym(const struct object_reference* ref, address_t* sym_a
 extern bool known_heap_block(const struct object_reference* ref);
 extern bool global_text_ref(const struct object_reference* ref);
 
+// Resolve symbols of refs in a batch, before they are printed one by one
+extern void symbolize_refs(const std::vector<struct object_reference*>& refs);
+
 extern address_t get_var_addr_by_name(const char*, bool);
 
 extern void print_func_locals (void);
@@ -68,6 +72,16 @@ extern void print_build_ids(void);
 
 extern bool get_vtable_from_exp(const char*, std::list<struct object_range*>&, char*, size_t, size_t*);
 
+// Address range of a "vtable for <name>" symbol
+struct vtable_range
+{
+    address_t low;
+    address_t high;
+    const char* name;
+};
+// Vtables of all modules sorted by address, kept until modules are changed
+extern const std::vector<struct vtable_range>& get_vtable_index(void);
+
 extern bool user_request_break(void);
 
 extern bool g_debug_core;
@@ -22,6 +22,8 @@ then
 fi
 
 cp -uv $build_folder/gdb-$gdb_version/gdb/Makefile.in $PROJECT_FOLDER/gdbplus/gdb-$gdb_version/gdb/
+cp -uv $build_folder/gdb-$gdb_version/gdb/compressed_core.c $PROJECT_FOLDER/gdbplus/gdb-$gdb_version/gdb/
+cp -uv $build_folder/gdb-$gdb_version/gdb/compressed_core.h $PROJECT_FOLDER/gdbplus/gdb-$gdb_version/gdb/
 cp -uv $build_folder/gdb-$gdb_version/gdb/decode.c $PROJECT_FOLDER/gdbplus/gdb-$gdb_version/gdb/
 cp -uv $build_folder/gdb-$gdb_version/gdb/decode.h $PROJECT_FOLDER/gdbplus/gdb-$gdb_version/gdb/
 cp -uv $build_folder/gdb-$gdb_version/gdb/gdb_dep.c $PROJECT_FOLDER/gdbplus/gdb-$gdb_version/gdb/
@@ -38,13 +40,20 @@ cp -uv $build_folder/gdb-$gdb_version/gdb/heap_tcmalloc.c $PROJECT_FOLDER/gdbplu
 cp -uv $build_folder/gdb-$gdb_version/gdb/heap_tcmalloc.h $PROJECT_FOLDER/gdbplus/gdb-$gdb_version/gdb/
 cp -uv $build_folder/gdb-$gdb_version/gdb/heapcmd.c $PROJECT_FOLDER/gdbplus/gdb-$gdb_version/gdb/
 cp -uv $build_folder/gdb-$gdb_version/gdb/i386-decode.c $PROJECT_FOLDER/gdbplus/gdb-$gdb_version/gdb/
+cp -uv $build_folder/gdb-$gdb_version/gdb/ptr_bitmap.c $PROJECT_FOLDER/gdbplus/gdb-$gdb_version/gdb/
+cp -uv $build_folder/gdb-$gdb_version/gdb/ptr_bitmap.h $PROJECT_FOLDER/gdbplus/gdb-$gdb_version/gdb/
 cp -uv $build_folder/gdb-$gdb_version/gdb/ref.h $PROJECT_FOLDER/gdbplus/gdb-$gdb_version/gdb/
+cp -uv $build_folder/gdb-$gdb_version/gdb/ref_index.c $PROJECT_FOLDER/gdbplus/gdb-$gdb_version/gdb/
+cp -uv $build_folder/gdb-$gdb_version/gdb/ref_index.h $PROJECT_FOLDER/gdbplus/gdb-$gdb_version/gdb/
 cp -uv $build_folder/gdb-$gdb_version/gdb/regcache.c $PROJECT_FOLDER/gdbplus/gdb-$gdb_version/gdb/
 cp -uv $build_folder/gdb-$gdb_version/gdb/regcache.h $PROJECT_FOLDER/gdbplus/gdb-$gdb_version/gdb/
 cp -uv $build_folder/gdb-$gdb_version/gdb/search.c $PROJECT_FOLDER/gdbplus/gdb-$gdb_version/gdb/
 cp -uv $build_folder/gdb-$gdb_version/gdb/search.h $PROJECT_FOLDER/gdbplus/gdb-$gdb_version/gdb/
 cp -uv $build_folder/gdb-$gdb_version/gdb/segment.c $PROJECT_FOLDER/gdbplus/gdb-$gdb_version/gdb/
 cp -uv $build_folder/gdb-$gdb_version/gdb/segment.h $PROJECT_FOLDER/gdbplus/gdb-$gdb_version/gdb/
+cp -uv $build_folder/gdb-$gdb_version/gdb/simd_scan.c $PROJECT_FOLDER/gdbplus/gdb-$gdb_version/gdb/
+cp -uv $build_folder/gdb-$gdb_version/gdb/simd_scan.h $PROJECT_FOLDER/gdbplus/gdb-$gdb_version/gdb/
+cp -uv $build_folder/gdb-$gdb_version/gdb/thread_pool.h $PROJECT_FOLDER/gdbplus/gdb-$gdb_version/gdb/
 cp -uv $build_folder/gdb-$gdb_version/gdb/x_dep.h $PROJECT_FOLDER/gdbplus/gdb-$gdb_version/gdb/
 cp -uv $build_folder/gdb-$gdb_version/gdb/x_type.h $PROJECT_FOLDER/gdbplus/gdb-$gdb_version/gdb/
 cp -uv $build_folder/gdb-$gdb_version/gdb/value.c $PROJECT_FOLDER/gdbplus/gdb-$gdb_version/gdb/
@@ -1,5 +1,6 @@
 import gdb
 import os
+import re
 import sys
 
 class Block:
@@ -127,6 +128,12 @@ def check_ref():
 		raise Exception('Test Failed')
 	print("[ca_test]\tFound the global reference: var \"hidden_object\" " \
 		"at 0x%x" % (var_addr))
+	# Batch search answers each object as a single search does
+	batch = gdb.ref_batch([obj_addr, (obj_addr, 1)], gdb.ENUM_MODULE_TEXT | gdb.ENUM_MODULE_DATA)
+	if len(batch) != 2 or any(len(refs) != 1 or refs[0].address != var_addr for refs in batch):
+		print("[ca_test] Batch search failed to find the global reference to object at address 0x%x" \
+			% (obj_addr))
+		raise Exception('Test Failed')
 	# Search in heap
 	refs = gdb.ref(obj_addr, 1, gdb.ENUM_HEAP)
 	if (refs == None or not refs[0].heap_inuse):
@@ -138,6 +145,89 @@ def check_ref():
 	print("[ca_test]\tFound heap reference: addr=0x%x size=%u to object at address 0x%x" \
 		% (refs[0].heap_addr, refs[0].heap_size, obj_addr))
 
+def ref_addresses(obj_addr, scope):
+	refs = gdb.ref(obj_addr, 1, scope)
+	if refs == None:
+		return []
+	return sorted([ref.address for ref in refs])
+
+# Test reference index, searches answered by the index equal the scan's
+def check_ref_index():
+	print("[ca_test] Checking reference index ...")
+	obj_addr = int(gdb.parse_and_eval("hidden_object"))
+	scopes = [gdb.ENUM_MODULE_TEXT | gdb.ENUM_MODULE_DATA, gdb.ENUM_HEAP]
+	scans = [ref_addresses(obj_addr, scope) for scope in scopes]
+	output = gdb.execute('ref /index', to_string=True)
+	if 'Reference index has' not in output:
+		print("[ca_test] Failed to build reference index: %s" % (output))
+		raise Exception('Test Failed')
+	try:
+		for scope, scan in zip(scopes, scans):
+			indexed = ref_addresses(obj_addr, scope)
+			if indexed != scan:
+				print("[ca_test] Reference index returns different references to object at address 0x%x" \
+					% (obj_addr))
+				print("[ca_test] \texpected:  %s" % (', '.join('0x%x' % a for a in scan)))
+				print("[ca_test] \tgot:       %s" % (', '.join('0x%x' % a for a in indexed)))
+				raise Exception('Test Failed')
+	finally:
+		gdb.execute('ref /index off')
+	print("[ca_test]\tReference index found the same %d references as the scan" \
+		% (sum(len(scan) for scan in scans)))
+
+# Test pseudo values are saved and loaded
+def check_assign():
+	print("[ca_test] Checking assign /save and /load ...")
+	ulong_type = gdb.lookup_type('long')
+	var_addr = int(gdb.parse_and_eval("&hidden_object").cast(ulong_type))
+	value = 0x1234
+	patch = "0x%x: 0x%x" % (var_addr, value)
+	fname = "ca_test_values.txt"
+	try:
+		gdb.execute('assign 0x%x 0x%x' % (var_addr, value))
+		gdb.execute('assign /save ' + fname)
+		gdb.execute('unassign 0x%x' % (var_addr))
+		if patch in gdb.execute('assign', to_string=True):
+			print("[ca_test] Failed to unassign the value at 0x%x" % (var_addr))
+			raise Exception('Test Failed')
+		gdb.execute('assign /load ' + fname)
+		if patch not in gdb.execute('assign', to_string=True):
+			print("[ca_test] Failed to load the value at 0x%x from %s" % (var_addr, fname))
+			raise Exception('Test Failed')
+	finally:
+		gdb.execute('unassign 0x%x' % (var_addr))
+		if os.path.isfile(fname):
+			os.unlink(fname)
+	print("[ca_test]\tLoaded the saved value 0x%x at 0x%x" % (value, var_addr))
+
+# Test census of C++ objects by their vtables
+def check_census(class_name, object_count):
+	print("[ca_test] Checking obj /census ...")
+	output = gdb.execute('obj /census', to_string=True)
+	match = re.search(r'\] %s: (\d+) objects' % (class_name), output)
+	if not match or int(match.group(1)) != object_count:
+		print("[ca_test] Expecting %d \"%s\" objects in census" % (object_count, class_name))
+		print(output)
+		raise Exception('Test Failed')
+	print("[ca_test]\tCensus counted %d \"%s\" objects" % (object_count, class_name))
+
+# Test memory pattern summary of a known buffer of heap pointers
+def check_pattern_summary(object_count):
+	print("[ca_test] Checking pattern /summary ...")
+	output = gdb.execute('pattern /summary &derived_objects[0] &derived_objects[%d]' % (object_count), \
+				to_string=True)
+	match = re.search(r'pointer to heap\s+(\d+) words', output)
+	if not match or int(match.group(1)) != object_count:
+		print("[ca_test] Expecting %d pointers to heap in \"derived_objects\"" % (object_count))
+		print(output)
+		raise Exception('Test Failed')
+	match = re.search(r'Total (\d+) heap blocks are referenced', output)
+	if not match or int(match.group(1)) != object_count:
+		print("[ca_test] Expecting %d heap blocks referenced by \"derived_objects\"" % (object_count))
+		print(output)
+		raise Exception('Test Failed')
+	print("[ca_test]\tFound %d pointers to heap in \"derived_objects\"" % (object_count))
+
 def check_heap_commands():
 	print("[ca_test] Execute command 'heap /u regions'")
 	gdb.execute('heap /u regions')
@@ -150,7 +240,7 @@ def check_misc_commands():
 	print("[ca_test] Execute command 'segment'")
 	gdb.execute('segment')
 
-def run_tests():
+def run_tests(core):
 	gdb.execute('heap')
 	# Retrieve global variables defined in mallocTest
 	count = gdb.parse_and_eval("num_regions")
@@ -164,6 +254,11 @@ def run_tests():
 	check_heap_walk(user_blks)
 	check_cplusplus_object("Derived", object_count)
 	check_ref()
+	if core:
+		check_ref_index()
+	check_assign()
+	check_census("Derived", object_count)
+	check_pattern_summary(object_count * 2)
 	check_heap_commands()
 	check_misc_commands()
 
@@ -182,14 +277,14 @@ try:
 	gdb.execute('break last_call')
 	gdb.execute ('set confirm off')
 	gdb.execute('run')
-	run_tests()
+	run_tests(False)
 
 	print("[ca_test] ==== Test Against Core Dump ====")
 	core_name = 'core.' + str(gdb.inferiors()[0].pid)
 	gdb.execute ('gcore ' + core_name)
 	gdb.execute ('kill')
 	gdb.execute ('core ' + core_name)
-	run_tests()
+	run_tests(True)
 
 	print("[ca_test] Pass")
 except Exception as e: